@@ -0,0 +1,198 @@
+"""
+根据阿里云物模型（TSL）导出文件生成C++头文件
+
+读取 tsl/model.json（控制台“物模型 -> 导出物模型”得到的完整模型），
+生成 src/ThingModelTsl.h：属性标识符、类型、取值范围、小数位数、读写权限，
+以及事件/服务的方法名和主题后缀。ThingModel.h和属性设置表通过这些常量取类型和范围，
+设备代码与云端模型不一致时（属性改名、删除、类型变化、只读属性被设置）编译失败。
+
+PlatformIO在每次构建前自动运行（platformio.ini中的extra_scripts），
+内容没有变化时不改写文件，避免触发全量重编译。也可以单独运行：
+    python scripts/gen_thing_model.py
+"""
+
+import json
+import os
+import re
+import sys
+
+TSL_PATH = os.path.join("tsl", "model.json")
+OUT_PATH = os.path.join("src", "ThingModelTsl.h")
+
+# TSL数据类型 -> PropertyType
+TYPE_MAP = {
+    "float": "PROP_FLOAT",
+    "double": "PROP_FLOAT",
+    "int": "PROP_INT",
+    "enum": "PROP_INT",
+    "bool": "PROP_BOOL",
+    "text": "PROP_TEXT",
+    "date": "PROP_TEXT",
+}
+
+# 物模型自带的属性事件和属性服务，已有固定的主题，不单独生成
+BUILTIN_EVENTS = {"post"}
+BUILTIN_SERVICES = {"set", "get"}
+
+
+def macro_name(identifier):
+    """fireAlarm -> FIRE_ALARM"""
+    snake = re.sub(r"(?<=[a-z0-9])([A-Z])", r"_\1", identifier)
+    return re.sub(r"[^A-Za-z0-9]", "_", snake).upper()
+
+
+def c_float(text):
+    value = float(text)
+    if value == int(value):
+        return "%d.0f" % int(value)
+    return "%sf" % repr(value)
+
+
+def precision_of(step):
+    """step "0.1" -> 1，"0.01" -> 2，整数步长 -> 0"""
+    if step is None:
+        return 0
+    text = str(step)
+    if "." not in text:
+        return 0
+    return len(text.split(".", 1)[1].rstrip("0"))
+
+
+def fail(message):
+    sys.stderr.write("gen_thing_model: %s\n" % message)
+    sys.exit(1)
+
+
+def property_lines(prop):
+    ident = prop.get("identifier")
+    if not ident or not re.match(r"^[A-Za-z_][A-Za-z0-9_]*$", ident):
+        fail("属性标识符不能作为C++名称: %r" % ident)
+
+    data_type = prop.get("dataType", {})
+    kind = data_type.get("type")
+    if kind not in TYPE_MAP:
+        fail("属性%s的类型%s不支持" % (ident, kind))
+    specs = data_type.get("specs") or {}
+
+    if kind in ("float", "double", "int"):
+        lo, hi = specs.get("min", "0"), specs.get("max", "0")
+    elif kind == "bool":
+        lo, hi = "0", "1"
+    elif kind == "enum":
+        keys = sorted(int(k) for k in specs.keys()) or [0]
+        lo, hi = str(keys[0]), str(keys[-1])
+    else:
+        lo, hi = "0", specs.get("length", "0")
+
+    precision = precision_of(specs.get("step")) if kind in ("float", "double") else 0
+    writable = "true" if prop.get("accessMode", "r") == "rw" else "false"
+    name = prop.get("name", "")
+
+    return [
+        "// %s（%s）" % (name, kind),
+        "struct %s {" % ident,
+        "    static constexpr const char *ID = TSL_PROP_%s;" % macro_name(ident),
+        "    static const uint8_t TYPE = %s;" % TYPE_MAP[kind],
+        "    static const uint8_t PRECISION = %d;" % precision,
+        "    static const bool WRITABLE = %s;" % writable,
+        "    static constexpr float MIN = %s;" % c_float(lo),
+        "    static constexpr float MAX = %s;" % c_float(hi),
+        "};",
+    ]
+
+
+def generate(model, source):
+    props = model.get("properties", [])
+    events = [e for e in model.get("events", []) if e.get("identifier") not in BUILTIN_EVENTS]
+    services = [s for s in model.get("services", []) if s.get("identifier") not in BUILTIN_SERVICES]
+
+    seen = set()
+    for prop in props:
+        ident = prop.get("identifier")
+        if ident in seen:
+            fail("属性%s重复" % ident)
+        seen.add(ident)
+
+    out = [
+        "// 由scripts/gen_thing_model.py根据%s生成，不要手工修改" % source.replace(os.sep, "/"),
+        "#ifndef THING_MODEL_TSL_H",
+        "#define THING_MODEL_TSL_H",
+        "",
+        "// 只能由ThingModel.h包含（依赖PropertyType）",
+        "",
+        '#define TSL_PRODUCT_KEY "%s"' % model.get("profile", {}).get("productKey", ""),
+        "",
+        "// 属性标识符（宏形式，便于拼接到报文模板中）",
+    ]
+    for prop in props:
+        out.append('#define TSL_PROP_%s "%s"' % (macro_name(prop["identifier"]), prop["identifier"]))
+
+    out += [
+        "",
+        "// 方法名",
+        '#define TSL_METHOD_PROPERTY_POST "thing.event.property.post"',
+        '#define TSL_METHOD_PROPERTY_SET  "thing.service.property.set"',
+    ]
+
+    if events:
+        out += ["", "// 事件：方法名和主题后缀（/sys/${pk}/${dn}/之后的部分）"]
+        for event in events:
+            ident, macro = event["identifier"], macro_name(event["identifier"])
+            out.append('#define TSL_EVENT_%s "thing.event.%s.post"' % (macro, ident))
+            out.append('#define TSL_EVENT_%s_TOPIC "thing/event/%s/post"' % (macro, ident))
+
+    if services:
+        out += ["", "// 服务：方法名和主题后缀"]
+        for service in services:
+            ident, macro = service["identifier"], macro_name(service["identifier"])
+            out.append('#define TSL_SERVICE_%s "thing.service.%s"' % (macro, ident))
+            out.append('#define TSL_SERVICE_%s_TOPIC "thing/service/%s"' % (macro, ident))
+
+    out += [
+        "",
+        "// 每个属性一个结构体：类型、范围、小数位数（由step推出）、是否可由云端设置",
+        "namespace tsl {",
+        "",
+        "static const size_t PROPERTY_COUNT = %d;" % len(props),
+        "",
+    ]
+    for prop in props:
+        out += property_lines(prop)
+        out.append("")
+    out += [
+        "} // namespace tsl",
+        "",
+        "#endif // THING_MODEL_TSL_H",
+        "",
+    ]
+    return "\n".join(out)
+
+
+def run(project_dir):
+    tsl_path = os.path.join(project_dir, TSL_PATH)
+    out_path = os.path.join(project_dir, OUT_PATH)
+    try:
+        with open(tsl_path, "r", encoding="utf-8") as f:
+            model = json.load(f)
+    except (IOError, ValueError) as e:
+        fail("读取%s失败: %s" % (tsl_path, e))
+
+    text = generate(model, TSL_PATH)
+
+    old = None
+    if os.path.exists(out_path):
+        with open(out_path, "r", encoding="utf-8") as f:
+            old = f.read()
+    if old != text:
+        with open(out_path, "w", encoding="utf-8", newline="\n") as f:
+            f.write(text)
+        print("gen_thing_model: 已更新%s" % OUT_PATH)
+
+
+try:
+    # PlatformIO extra_script
+    Import("env")  # noqa: F821
+    run(env.subst("$PROJECT_DIR"))  # noqa: F821
+except NameError:
+    if __name__ == "__main__":
+        run(os.path.join(os.path.dirname(os.path.abspath(__file__)), os.pardir))
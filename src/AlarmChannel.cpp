@@ -0,0 +1,169 @@
+#include "AlarmChannel.h"
+#include <math.h>
+
+const uint8_t AlarmChannel::MAX_PENDING;
+const size_t AlarmChannel::PAYLOAD_MAX;
+
+// 构造函数
+AlarmChannel::AlarmChannel(const Kind *kinds, uint8_t kindCount, uint32_t timeoutMs, uint32_t maxTimeoutMs)
+    : _kinds(kinds), _kindCount(kindCount), _nextId(1), _nextSeq(0),
+      _timeoutMs(timeoutMs), _maxTimeoutMs(maxTimeoutMs) {
+    memset(_events, 0, sizeof(_events));
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+// 某种报警在队列中最新的一条事件
+AlarmChannel::Event *AlarmChannel::latest(uint8_t kind) {
+    Event *last = nullptr;
+    for (uint8_t i = 0; i < MAX_PENDING; i++) {
+        Event &e = _events[i];
+        if (e.used && e.kind == kind && (last == nullptr || e.seq > last->seq)) last = &e;
+    }
+    return last;
+}
+
+void AlarmChannel::raise(uint8_t kind, bool active, const Snapshot &snapshot, uint64_t timeMs, unsigned long now) {
+    if (kind >= _kindCount) return;
+
+    // 再次触发时，前面那条解除还从没发出过：撤掉解除，也不再补一条触发，
+    // 平台上的状态停在之前的触发；发出过的解除平台可能已经收到，照常排队
+    if (active) {
+        Event *last = latest(kind);
+        if (last != nullptr && !last->active && !last->attempted) {
+            last->used = false;
+            _stats.coalesced++;
+            return;
+        }
+    }
+
+    // 找空位，队列满时丢弃最早的事件（后面的状态变化已经覆盖了它）
+    Event *slot = nullptr;
+    for (uint8_t i = 0; i < MAX_PENDING; i++) {
+        Event &e = _events[i];
+        if (!e.used) {
+            slot = &e;
+            break;
+        }
+        if (slot == nullptr || e.seq < slot->seq) slot = &e;
+    }
+    if (slot->used) _stats.dropped++;
+
+    slot->used = true;
+    slot->sent = false;
+    slot->attempted = false;
+    slot->kind = kind;
+    slot->active = active;
+    slot->snapshot = snapshot;
+    slot->timeMs = timeMs;
+    slot->detectedAt = now;
+    slot->timeoutMs = _timeoutMs;
+    slot->id = _nextId++;
+    slot->seq = _nextSeq++;
+    _stats.raised++;
+}
+
+// {"id":"1","version":"1.0","method":"thing.event.fireAlarm.post",
+//  "params":{"value":{"state":1,"flame":87,"threshold":50,"temperature":31.2},"time":1700000000000}}
+size_t AlarmChannel::write(const Event &event, char *buf, size_t size) const {
+    const Kind &kind = _kinds[event.kind];
+    JsonOut out(buf, size);
+    out.raw("{\"id\":\"");
+    out.uinteger(event.id);
+    out.raw("\",\"version\":\"1.0\",\"method\":");
+    out.str(kind.method);
+    out.raw(",\"params\":{\"value\":{\"state\":");
+    out.raw(event.active ? '1' : '0');
+    out.raw(',');
+    out.str(kind.valueName);
+    out.raw(':');
+    out.integer(event.snapshot.value);
+    out.raw(",\"threshold\":");
+    out.integer(event.snapshot.threshold);
+    if (isfinite(event.snapshot.temperature)) {
+        out.raw(",\"temperature\":");
+        out.fixed(event.snapshot.temperature, 1);
+    }
+    out.raw('}');
+    if (event.timeMs) {
+        out.raw(",\"time\":");
+        out.uinteger64(event.timeMs);
+    }
+    out.raw("}}");
+    return out.length();
+}
+
+void AlarmChannel::service(bool online, unsigned long now, Sender send) {
+    if (!online) return;
+
+    // 按入队顺序发送，同一报警的触发和解除不会颠倒
+    uint32_t lastSeq = 0;
+    bool first = true;
+    for (;;) {
+        Event *next = nullptr;
+        for (uint8_t i = 0; i < MAX_PENDING; i++) {
+            Event &e = _events[i];
+            if (!e.used || (!first && e.seq <= lastSeq)) continue;
+            if (next == nullptr || e.seq < next->seq) next = &e;
+        }
+        if (next == nullptr) break;
+        first = false;
+        lastSeq = next->seq;
+
+        bool retry = next->sent;
+        if (retry && now - next->sentAt < next->timeoutMs) continue;
+
+        char buf[PAYLOAD_MAX];
+        size_t len = write(*next, buf, sizeof(buf));
+        if (len >= sizeof(buf)) {
+            next->used = false;
+            continue;
+        }
+        // 发送失败（缓冲区满等）时停下，下次loop()再试，保持顺序
+        if (!send(next->kind, (const uint8_t *)buf, len)) break;
+
+        if (retry) {
+            _stats.retransmits++;
+            next->timeoutMs = next->timeoutMs * 2 > _maxTimeoutMs ? _maxTimeoutMs : next->timeoutMs * 2;
+        }
+        next->sent = true;
+        next->attempted = true;
+        next->sentAt = now;
+    }
+}
+
+bool AlarmChannel::acknowledge(uint32_t id, int code, unsigned long now) {
+    for (uint8_t i = 0; i < MAX_PENDING; i++) {
+        Event &e = _events[i];
+        if (!e.used || !e.sent || e.id != id) continue;
+
+        // 非200说明报文本身有问题，重发也不会成功
+        e.used = false;
+        if (code != 200) {
+            _stats.rejected++;
+            return true;
+        }
+
+        uint32_t latency = now - e.detectedAt;
+        _stats.acked++;
+        _stats.lastLatencyMs = latency;
+        _stats.latencySumMs += latency;
+        if (latency > _stats.maxLatencyMs) _stats.maxLatencyMs = latency;
+        return true;
+    }
+    return false;
+}
+
+void AlarmChannel::requeue() {
+    for (uint8_t i = 0; i < MAX_PENDING; i++) {
+        _events[i].sent = false;
+        _events[i].timeoutMs = _timeoutMs;
+    }
+}
+
+uint8_t AlarmChannel::pending() const {
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < MAX_PENDING; i++) {
+        if (_events[i].used) n++;
+    }
+    return n;
+}
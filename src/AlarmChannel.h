@@ -0,0 +1,94 @@
+#ifndef ALARM_CHANNEL_H
+#define ALARM_CHANNEL_H
+
+#include <Arduino.h>
+#include "PropertyCodec.h"
+
+// 报警事件通道
+// 报警触发和解除时各生成一条thing.event.<报警>.post事件（带时间戳和当时的传感器读数），
+// 在loop()中立即发送，不等属性上报周期；没有收到post_reply就按倍增间隔一直重发，直到确认。
+// 从检测到报警到收到平台确认的时间按毫秒统计，作为端到端报警时延。
+// 同一报警还没发出过的解除遇到新的触发时两条一起撤掉（平台看来报警一直持续），
+// 断网期间反复触发、解除不会占满队列；触发事件本身从不合并。
+// 只在loop任务中使用。
+class AlarmChannel {
+public:
+    // 报警种类描述
+    struct Kind {
+        const char *method;       // 事件方法名，例如thing.event.fireAlarm.post
+        const char *valueName;    // 触发报警的传感器读数在事件中的标识符
+    };
+
+    // 报警时的传感器读数
+    struct Snapshot {
+        int32_t value;            // 触发报警的读数
+        int32_t threshold;
+        float temperature;
+    };
+
+    // 发送回调，kind为Kind表下标
+    typedef bool (*Sender)(uint8_t kind, const uint8_t *payload, size_t length);
+
+    static const uint8_t MAX_PENDING = 8;
+    static const size_t PAYLOAD_MAX = 256;
+
+    struct Stats {
+        uint32_t raised;          // 生成的事件数
+        uint32_t acked;
+        uint32_t rejected;        // 平台返回非200
+        uint32_t retransmits;
+        uint32_t dropped;         // 队列满时丢弃的最早事件
+        uint32_t coalesced;       // 合并掉的解除/触发对
+        uint32_t lastLatencyMs;   // 检测到确认
+        uint32_t maxLatencyMs;
+        uint32_t latencySumMs;
+    };
+
+private:
+    struct Event {
+        bool used;
+        bool sent;
+        bool attempted;           // 发出过（requeue()后也保持，平台可能已经收到）
+        uint8_t kind;
+        bool active;
+        Snapshot snapshot;
+        uint64_t timeMs;          // UTC毫秒，0表示未同步（不带time字段，由平台填入接收时间）
+        unsigned long detectedAt;
+        unsigned long sentAt;
+        uint32_t timeoutMs;
+        uint32_t id;
+        uint32_t seq;             // 入队顺序
+    };
+
+    const Kind *_kinds;
+    uint8_t _kindCount;
+    Event _events[MAX_PENDING];
+    uint32_t _nextId;
+    uint32_t _nextSeq;
+    uint32_t _timeoutMs;
+    uint32_t _maxTimeoutMs;
+    Stats _stats;
+
+    size_t write(const Event &event, char *buf, size_t size) const;
+    Event *latest(uint8_t kind);
+
+public:
+    AlarmChannel(const Kind *kinds, uint8_t kindCount, uint32_t timeoutMs, uint32_t maxTimeoutMs);
+
+    // 报警状态变化时调用
+    void raise(uint8_t kind, bool active, const Snapshot &snapshot, uint64_t timeMs, unsigned long now);
+
+    // 在loop()中调用：按入队顺序发送新事件，重发超时的事件
+    void service(bool online, unsigned long now, Sender send);
+
+    // 收到事件的post_reply时调用，返回true表示匹配到了
+    bool acknowledge(uint32_t id, int code, unsigned long now);
+
+    // 断线后已发出的事件不会再有应答，重新连接后立即重发
+    void requeue();
+
+    uint8_t pending() const;
+    const Stats &stats() const { return _stats; }
+};
+
+#endif // ALARM_CHANNEL_H
@@ -0,0 +1,30 @@
+#include "AlarmLatch.h"
+
+// 构造函数
+AlarmLatch::AlarmLatch(int32_t hysteresis, uint32_t holdMs)
+    : _hysteresis(hysteresis), _holdMs(holdMs), _active(false), _clearing(false), _clearSince(0) {
+}
+
+// 触发不延迟；解除要等读数低于回差下限并保持holdMs，期间再次超过下限就重新计时
+bool AlarmLatch::update(int32_t value, int32_t threshold, unsigned long now) {
+    if (value > threshold) {
+        _active = true;
+        _clearing = false;
+        return true;
+    }
+    if (!_active) return false;
+
+    if (value > threshold - _hysteresis) {
+        _clearing = false;
+        return true;
+    }
+    if (!_clearing) {
+        _clearing = true;
+        _clearSince = now;
+    }
+    if (now - _clearSince >= _holdMs) {
+        _active = false;
+        _clearing = false;
+    }
+    return _active;
+}
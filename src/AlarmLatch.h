@@ -0,0 +1,26 @@
+#ifndef ALARM_LATCH_H
+#define ALARM_LATCH_H
+
+#include <Arduino.h>
+
+// 报警状态判定（带回差和解除保持时间）
+// 读数超过阈值立即触发；解除要求读数回落到阈值减回差以下，并且连续保持holdMs。
+// 读数在阈值附近抖动时不会反复触发、解除，报警事件和执行器动作最多每holdMs一对。
+class AlarmLatch {
+private:
+    int32_t _hysteresis;        // 解除时读数要比阈值低多少
+    uint32_t _holdMs;           // 解除条件需要连续保持的时间
+    bool _active;
+    bool _clearing;             // 正在等待解除
+    unsigned long _clearSince;
+
+public:
+    AlarmLatch(int32_t hysteresis, uint32_t holdMs);
+
+    // 每次采样后调用，返回报警是否处于触发状态
+    bool update(int32_t value, int32_t threshold, unsigned long now);
+
+    bool active() const { return _active; }
+};
+
+#endif // ALARM_LATCH_H
@@ -0,0 +1,45 @@
+#include "BootTimeline.h"
+#include "PropertyCodec.h"
+
+const uint8_t BootTimeline::MAX_MARKS;
+
+// 构造函数
+BootTimeline::BootTimeline() : _count(0) {
+}
+
+bool BootTimeline::has(const char *name) const {
+    for (uint8_t i = 0; i < _count; i++) {
+        if (strcmp(_names[i], name) == 0) return true;
+    }
+    return false;
+}
+
+bool BootTimeline::mark(const char *name) {
+    if (_count >= MAX_MARKS || has(name)) return false;
+    // micros()从应用启动开始计时（不含ROM和二级引导程序的时间）
+    _us[_count] = micros();
+    _names[_count] = name;
+    _count++;
+    return true;
+}
+
+void BootTimeline::print(Print &out) const {
+    out.print("启动时间线:");
+    for (uint8_t i = 0; i < _count; i++) {
+        out.printf("%s %s %lums", i ? "," : "", _names[i], (unsigned long)(_us[i] / 1000));
+    }
+    out.println();
+}
+
+size_t BootTimeline::write(char *buf, size_t size) const {
+    JsonOut out(buf, size);
+    out.raw('{');
+    for (uint8_t i = 0; i < _count; i++) {
+        if (i) out.raw(',');
+        out.str(_names[i]);
+        out.raw(':');
+        out.uinteger(_us[i] / 1000);
+    }
+    out.raw('}');
+    return out.length();
+}
@@ -0,0 +1,34 @@
+#ifndef BOOT_TIMELINE_H
+#define BOOT_TIMELINE_H
+
+#include <Arduino.h>
+
+// 启动时间线
+// 记录启动过程中各个里程碑（传感器就绪、报警生效、界面可用、WiFi/MQTT连上等）距上电的时间，
+// 同一个里程碑只记第一次，重连不会覆盖。名称必须是字符串常量。
+// 只在loop任务中使用（包括setup()和loop()中调用的回调）。
+class BootTimeline {
+public:
+    static const uint8_t MAX_MARKS = 16;
+
+private:
+    const char *_names[MAX_MARKS];
+    uint32_t _us[MAX_MARKS];
+    uint8_t _count;
+
+public:
+    BootTimeline();
+
+    // 记录里程碑，返回false表示已经记录过或已满
+    bool mark(const char *name);
+
+    bool has(const char *name) const;
+
+    // 输出到串口：启动时间线: setup 35ms, sensors 61ms, ...
+    void print(Print &out) const;
+
+    // 写JSON对象：{"setup":35,"sensors":61,...}（毫秒），返回需要的长度（不含'\0'）
+    size_t write(char *buf, size_t size) const;
+};
+
+#endif // BOOT_TIMELINE_H
@@ -0,0 +1,201 @@
+#include "BrokerResolver.h"
+#include <Preferences.h>
+#include <time.h>
+
+#define RESOLVER_NAMESPACE "dns"
+#define LOOKUP_RETRY_MS 30000              // 查询失败后30秒再试
+#define EPOCH_VALID 1600000000UL           // 早于此时间说明还没对时
+
+const uint8_t BrokerResolver::MAX_ENDPOINTS;
+
+// NVS中每个服务器一条记录，域名变了记录就作废
+struct StoredAddress {
+    uint32_t hostHash;
+    uint32_t ip;
+    uint32_t expires;                      // UTC秒，0表示保存时还没对时
+};
+
+// 构造函数
+BrokerResolver::BrokerResolver(uint32_t ttlS, uint8_t failoverAfter, uint32_t failbackMs)
+    : _count(0), _current(0), _ttlS(ttlS), _failoverAfter(failoverAfter), _failbackMs(failbackMs),
+      _established(false), _switched(false), _connectedAt(0) {
+    memset(_entries, 0, sizeof(_entries));
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+// FNV-1a
+uint32_t BrokerResolver::hostHash(const char *host) {
+    uint32_t h = 2166136261UL;
+    while (*host) {
+        h = (h ^ (uint8_t)*host++) * 16777619UL;
+    }
+    return h;
+}
+
+bool BrokerResolver::addEndpoint(const char *host, uint16_t port, bool tls, bool local) {
+    if (_count >= MAX_ENDPOINTS || host == nullptr || host[0] == '\0') return false;
+    Entry &entry = _entries[_count++];
+    entry.endpoint.host = host;
+    entry.endpoint.port = port;
+    entry.endpoint.tls = tls;
+    entry.endpoint.local = local;
+    entry.stale = true;
+    return true;
+}
+
+void BrokerResolver::begin() {
+    Preferences prefs;
+    if (!prefs.begin(RESOLVER_NAMESPACE, true)) return;
+
+    time_t epoch = time(nullptr);
+    unsigned long now = millis();
+    for (uint8_t i = 0; i < _count; i++) {
+        Entry &entry = _entries[i];
+        char key[4];
+        snprintf(key, sizeof(key), "e%u", i);
+        StoredAddress stored;
+        if (prefs.getBytes(key, &stored, sizeof(stored)) != sizeof(stored)) continue;
+        if (stored.hostHash != hostHash(entry.endpoint.host) || stored.ip == 0) continue;
+
+        // 过期或不知道是否过期的地址照样先用，同时重新解析
+        entry.ip = stored.ip;
+        if ((unsigned long)epoch > EPOCH_VALID && stored.expires > (uint32_t)epoch) {
+            entry.stale = false;
+            entry.expiresAt = now + (stored.expires - (uint32_t)epoch) * 1000UL;
+        }
+    }
+    prefs.end();
+}
+
+// tcpip任务中调用
+void BrokerResolver::dnsFound(const char *name, const ip_addr_t *addr, void *arg) {
+    (void)name;
+    Entry *entry = (Entry *)arg;
+    if (addr != nullptr && IP_IS_V4(addr)) {
+        entry->result = ip4_addr_get_u32(ip_2_ip4(addr));
+        entry->lookup = LOOKUP_DONE;
+    } else {
+        entry->lookup = LOOKUP_FAILED;
+    }
+}
+
+// 与WiFiGenericClass::hostByName()相同，直接调用lwIP的异步查询，但不等待结果
+void BrokerResolver::startLookup(Entry &entry, unsigned long now) {
+    ip_addr_t addr;
+    entry.lookupStart = now;
+    entry.lookup = LOOKUP_PENDING;
+    err_t err = dns_gethostbyname(entry.endpoint.host, &addr, dnsFound, &entry);
+    if (err == ERR_OK) {
+        // 命中lwIP缓存或本身就是IP字符串
+        dnsFound(entry.endpoint.host, &addr, &entry);
+    } else if (err != ERR_INPROGRESS) {
+        entry.lookup = LOOKUP_FAILED;
+    }
+}
+
+void BrokerResolver::finishLookup(uint8_t index, unsigned long now, time_t epoch) {
+    Entry &entry = _entries[index];
+    bool ok = entry.lookup == LOOKUP_DONE;
+    entry.lookup = LOOKUP_IDLE;
+    _stats.lastLookupMs = now - entry.lookupStart;
+    if (!ok) {
+        _stats.lookupFailures++;
+        entry.nextLookup = now + LOOKUP_RETRY_MS;
+        return;
+    }
+
+    _stats.lookups++;
+    uint32_t ip = entry.result;
+    bool changed = ip != entry.ip;
+    entry.ip = ip;
+    entry.stale = false;
+    entry.expiresAt = now + _ttlS * 1000UL;
+
+    // 地址变化或已对时（能写入有效期）时才写NVS
+    bool timed = (unsigned long)epoch > EPOCH_VALID;
+    if (!changed && !timed) return;
+    StoredAddress stored = {hostHash(entry.endpoint.host), ip, timed ? (uint32_t)epoch + _ttlS : 0};
+    char key[4];
+    snprintf(key, sizeof(key), "e%u", index);
+    Preferences prefs;
+    if (prefs.begin(RESOLVER_NAMESPACE, false)) {
+        prefs.putBytes(key, &stored, sizeof(stored));
+        prefs.end();
+    }
+}
+
+void BrokerResolver::loop(bool networkUp) {
+    unsigned long now = millis();
+    time_t epoch = time(nullptr);
+    for (uint8_t i = 0; i < _count; i++) {
+        Entry &entry = _entries[i];
+        switch (entry.lookup) {
+        case LOOKUP_DONE:
+        case LOOKUP_FAILED:
+            finishLookup(i, now, epoch);
+            break;
+        case LOOKUP_PENDING:
+            // 不设超时：lwIP对每个查询都会回调（失败或超时时addr为NULL）。
+            // 回调参数就是本条目，提前放弃再重新查询的话，迟到的旧回调会覆盖新查询的状态
+            break;
+        case LOOKUP_IDLE:
+            if (!networkUp || (long)(now - entry.nextLookup) < 0) break;
+            if (!entry.stale && entry.ip != 0 && (long)(now - entry.expiresAt) < 0) break;
+            startLookup(entry, now);
+            break;
+        }
+    }
+}
+
+const BrokerResolver::Endpoint &BrokerResolver::select(IPAddress &ip) {
+    Entry &entry = _entries[_current];
+    ip = IPAddress(entry.ip);
+    if (entry.ip != 0) _stats.cachedConnects++;
+    _established = false;
+    return entry.endpoint;
+}
+
+// 切到下一个服务器；toCloud时回到第一个
+void BrokerResolver::advance(bool toCloud) {
+    _entries[_current].failures = 0;
+    _current = toCloud ? 0 : (_current + 1) % _count;
+}
+
+void BrokerResolver::connected() {
+    _entries[_current].failures = 0;
+    _established = true;
+    _connectedAt = millis();
+}
+
+bool BrokerResolver::failed() {
+    if (_count == 0) return false;
+    if (_switched) {
+        _switched = false;
+        return true;
+    }
+    // 连上之后断开的不算这个服务器连不上
+    if (_established) {
+        _established = false;
+        return false;
+    }
+
+    Entry &entry = _entries[_current];
+    // 缓存的地址可能已经失效，下次loop()重新解析
+    entry.stale = true;
+    entry.nextLookup = millis();
+    if (++entry.failures < _failoverAfter || _count < 2) return false;
+
+    advance(false);
+    _stats.failovers++;
+    return true;
+}
+
+bool BrokerResolver::shouldFailback() {
+    if (!_established || !_entries[_current].endpoint.local) return false;
+    if (millis() - _connectedAt < _failbackMs) return false;
+    _established = false;
+    _switched = true;
+    advance(true);
+    _stats.failbacks++;
+    return true;
+}
@@ -0,0 +1,102 @@
+#ifndef BROKER_RESOLVER_H
+#define BROKER_RESOLVER_H
+
+#include <Arduino.h>
+#include <lwip/dns.h>
+
+// MQTT服务器地址解析与切换
+// 每个服务器（云端主域名、备用域名、局域网内的MQTT桥接服务器）的IP缓存在内存和NVS中，
+// 连接时直接按IP连，不再在connect()里同步查DNS；缓存过期后在loop()中异步重新解析，
+// 所有需要解析的服务器同时发起查询（lwIP异步DNS），不互相等待。
+// lwIP不提供DNS记录的TTL，有效期使用构造时给定的固定值；过期的地址在刷新完成前继续使用。
+// 当前服务器连续连接失败达到次数后切换到下一个；连在局域网服务器上一段时间后切回云端重试。
+// 只在loop任务中使用（DNS结果回调在tcpip任务中执行，只写本条目的结果字段；
+// 每个条目同时最多一个未完成的查询，回调到达前不会重新查询）。
+class BrokerResolver {
+public:
+    static const uint8_t MAX_ENDPOINTS = 4;
+
+    struct Endpoint {
+        const char *host;         // 域名或IP字符串（指针需一直有效）
+        uint16_t port;
+        bool tls;
+        bool local;               // 局域网服务器，只在云端不可用时使用
+    };
+
+    struct Stats {
+        uint32_t lookups;         // 完成的DNS查询
+        uint32_t lookupFailures;
+        uint32_t cachedConnects;  // 用缓存IP发起的连接
+        uint32_t failovers;
+        uint32_t failbacks;
+        uint32_t lastLookupMs;    // 最近一次查询耗时
+    };
+
+private:
+    enum Lookup : uint8_t {
+        LOOKUP_IDLE,
+        LOOKUP_PENDING,
+        LOOKUP_DONE,
+        LOOKUP_FAILED
+    };
+
+    struct Entry {
+        Endpoint endpoint;
+        uint32_t ip;              // 0表示还没有解析结果
+        bool stale;               // 需要重新解析
+        unsigned long expiresAt;  // millis()
+        unsigned long nextLookup; // 查询失败后的重试时间
+        unsigned long lookupStart;
+        uint8_t failures;         // 当前服务器连续连接失败次数
+        volatile Lookup lookup;
+        volatile uint32_t result;
+    };
+
+    Entry _entries[MAX_ENDPOINTS];
+    uint8_t _count;
+    uint8_t _current;
+    uint32_t _ttlS;
+    uint8_t _failoverAfter;
+    uint32_t _failbackMs;
+    bool _established;            // 当前服务器这次连接是否成功过
+    bool _switched;               // 主动切回云端，随后的断开不算失败
+    unsigned long _connectedAt;
+    Stats _stats;
+
+    static void dnsFound(const char *name, const ip_addr_t *addr, void *arg);
+    static uint32_t hostHash(const char *host);
+    void startLookup(Entry &entry, unsigned long now);
+    void finishLookup(uint8_t index, unsigned long now, time_t epoch);
+    void advance(bool toCloud);
+
+public:
+    // ttlS为地址缓存有效期，failoverAfter为切换前连续失败次数，failbackMs为连在局域网服务器上多久后切回云端
+    BrokerResolver(uint32_t ttlS, uint8_t failoverAfter, uint32_t failbackMs);
+
+    // 按优先级添加服务器：云端主域名在前，局域网服务器最后
+    bool addEndpoint(const char *host, uint16_t port, bool tls, bool local);
+
+    // 从NVS读取上次的解析结果（在addEndpoint之后调用）
+    void begin();
+
+    // 在loop()中调用：收取DNS结果，为过期的服务器发起查询
+    void loop(bool networkUp);
+
+    // 每次连接前调用，返回本次要连的服务器；ip为0时没有缓存，由传输层按域名连接
+    const Endpoint &select(IPAddress &ip);
+
+    // 连接成功后调用
+    void connected();
+
+    // 连接失败或断开后调用，返回true表示已切换服务器，应立即重试
+    bool failed();
+
+    // 连在局域网服务器上超过failbackMs时返回true并切回云端，调用者断开当前连接
+    bool shouldFailback();
+
+    const Endpoint &current() const { return _entries[_current].endpoint; }
+    uint8_t currentIndex() const { return _current; }
+    const Stats &stats() const { return _stats; }
+};
+
+#endif // BROKER_RESOLVER_H
@@ -0,0 +1,107 @@
+#include "ChangeTracker.h"
+#include <math.h>
+
+// 构造函数
+ChangeTracker::ChangeTracker(uint32_t fullSyncMs)
+    : _known(0), _fullSyncMs(fullSyncMs), _lastFullSync(0), _fullSyncPending(true),
+      _fullSyncSent(0) {
+    memset(&_sent, 0, sizeof(_sent));
+    memset(_sentAt, 0, sizeof(_sentAt));
+}
+
+void ChangeTracker::reset() {
+    _known = 0;
+    requestFullSync();
+}
+
+void ChangeTracker::requestFullSync() {
+    _fullSyncPending = true;
+    _fullSyncSent = 0;
+}
+
+// 与上次上报的值相比是否超过死区
+bool ChangeTracker::changed(size_t index, const PropertyFrame &frame) const {
+    const PropertyDesc &desc = THING_PROPERTIES[index];
+    const uint8_t *now = (const uint8_t *)&frame + desc.offset;
+    const uint8_t *last = (const uint8_t *)&_sent + desc.offset;
+    float deadband = THING_REPORT_POLICY[index].deadband;
+
+    switch (desc.type) {
+        case PROP_FLOAT: {
+            float a = *(const float *)now;
+            float b = *(const float *)last;
+            if (isnan(a)) return false;   // 读取失败不算变化
+            if (isnan(b)) return true;
+            float diff = fabsf(a - b);
+            return deadband > 0 ? diff >= deadband : diff > 0;
+        }
+        case PROP_INT: {
+            int32_t diff = *(const int32_t *)now - *(const int32_t *)last;
+            if (diff < 0) diff = -diff;
+            return deadband > 0 ? diff >= deadband : diff != 0;
+        }
+        case PROP_BOOL:
+            return *(const bool *)now != *(const bool *)last;
+    }
+    return false;
+}
+
+// 按策略选出要上报的属性
+// 全量同步期间，本轮还没发出的属性都要上报，已发出的照常按策略选；
+// 离线时阈值和执行器状态发不出去，同步会一直未完成，但已进批次的传感器读数不会每次都重复全量上报
+PropertyMask ChangeTracker::select(const PropertyFrame &frame, unsigned long now) {
+    if (!_fullSyncPending && _fullSyncMs > 0 && now - _lastFullSync >= _fullSyncMs) {
+        requestFullSync();
+    }
+    PropertyMask unsynced = _fullSyncPending ? PROPERTY_MASK_ALL & ~_fullSyncSent : 0;
+
+    PropertyMask mask = 0;
+    for (size_t i = 0; i < THING_PROPERTY_COUNT; i++) {
+        PropertyMask bit = 1UL << i;
+        if (!(_known & bit) || (unsynced & bit)) {
+            mask |= bit;
+            continue;
+        }
+
+        const ReportPolicy &policy = THING_REPORT_POLICY[i];
+        unsigned long elapsed = now - _sentAt[i];
+        if (elapsed < policy.minIntervalMs) continue;
+
+        if (changed(i, frame) ||
+            (policy.maxIntervalMs > 0 && elapsed >= policy.maxIntervalMs)) {
+            mask |= bit;
+        }
+    }
+    return mask;
+}
+
+// 记录已上报的值
+void ChangeTracker::commit(const PropertyFrame &frame, PropertyMask mask, unsigned long now) {
+    for (size_t i = 0; i < THING_PROPERTY_COUNT; i++) {
+        PropertyMask bit = 1UL << i;
+        if (!(mask & bit)) continue;
+
+        const PropertyDesc &desc = THING_PROPERTIES[i];
+        size_t size = desc.type == PROP_FLOAT ? sizeof(float)
+                    : desc.type == PROP_INT ? sizeof(int32_t) : sizeof(bool);
+        memcpy((uint8_t *)&_sent + desc.offset, (const uint8_t *)&frame + desc.offset, size);
+        _sentAt[i] = now;
+        _known |= bit;
+    }
+
+    if (_fullSyncPending) {
+        _fullSyncSent |= mask;
+        if (_fullSyncSent == PROPERTY_MASK_ALL) {
+            _lastFullSync = now;
+            _fullSyncPending = false;
+        }
+    }
+}
+
+PropertyMask ChangeTracker::onChangeOnly() {
+    PropertyMask mask = 0;
+    for (size_t i = 0; i < THING_PROPERTY_COUNT; i++) {
+        if (THING_REPORT_POLICY[i].maxIntervalMs == 0) mask |= 1UL << i;
+    }
+    return mask;
+}
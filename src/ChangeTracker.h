@@ -0,0 +1,41 @@
+#ifndef CHANGE_TRACKER_H
+#define CHANGE_TRACKER_H
+
+#include <Arduino.h>
+#include "ThingModel.h"
+
+// 属性变化跟踪
+// 记录每个属性最后一次成功上报的值和时间，按THING_REPORT_POLICY选出本次需要上报的属性；
+// 另外每隔fullSyncMs上报一次全部属性，作为丢包或云端状态不一致时的兜底。
+class ChangeTracker {
+private:
+    PropertyFrame _sent;                         // 上次上报的值
+    unsigned long _sentAt[THING_PROPERTY_COUNT]; // 上次上报的时间
+    PropertyMask _known;                         // 已经上报过的属性
+    uint32_t _fullSyncMs;
+    unsigned long _lastFullSync;
+    bool _fullSyncPending;
+    PropertyMask _fullSyncSent;                  // 本轮全量同步已发出的属性
+
+    bool changed(size_t index, const PropertyFrame &frame) const;
+
+public:
+    explicit ChangeTracker(uint32_t fullSyncMs);
+
+    // 选出本次要上报的属性，返回0表示无需上报
+    PropertyMask select(const PropertyFrame &frame, unsigned long now);
+
+    // 上报成功后记录，mask为实际发出的属性；一次select()的结果可以分几次commit()
+    void commit(const PropertyFrame &frame, PropertyMask mask, unsigned long now);
+
+    // 只在变化时上报的属性（策略中maxIntervalMs为0，即阈值和执行器状态）
+    static PropertyMask onChangeOnly();
+
+    // 忘记已上报的值，下一次select()返回全部属性（重新连接后调用）
+    void reset();
+
+    // 立即开始一轮新的全量同步（已在进行的从头算起）
+    void requestFullSync();
+};
+
+#endif // CHANGE_TRACKER_H
@@ -0,0 +1,82 @@
+#include "DeferredLog.h"
+#include <stdarg.h>
+
+// 单行日志的最大长度
+static const size_t LOG_LINE_MAX = 192;
+
+// 构造函数
+DeferredLog::DeferredLog(char *buf, size_t size)
+    : _buf(buf), _size(size), _head(0), _used(0), _dropped(0) {
+}
+
+// 整行写入环形缓冲，放不下就整行丢弃，避免输出半行
+void DeferredLog::put(const char *text, size_t len) {
+    if (len == 0) return;
+    if (_size - _used < len) {
+        _dropped++;
+        return;
+    }
+    size_t tail = (_head + _used) % _size;
+    size_t first = _size - tail;
+    if (first > len) first = len;
+    memcpy(_buf + tail, text, first);
+    memcpy(_buf, text + first, len - first);
+    _used += len;
+}
+
+void DeferredLog::printf(const char *format, ...) {
+    char line[LOG_LINE_MAX];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(line, sizeof(line) - 1, format, args);
+    va_end(args);
+    if (len < 0) return;
+    if ((size_t)len > sizeof(line) - 2) len = sizeof(line) - 2;
+    line[len++] = '\n';
+    put(line, len);
+}
+
+void DeferredLog::line(const char *prefix, const char *data, size_t len, size_t maxLen) {
+    char line[LOG_LINE_MAX];
+    size_t pos = 0;
+    size_t prefixLen = strlen(prefix);
+    if (prefixLen > sizeof(line) - 4) prefixLen = sizeof(line) - 4;
+    memcpy(line, prefix, prefixLen);
+    pos = prefixLen;
+
+    size_t take = len < maxLen ? len : maxLen;
+    // 留出"..."和换行的位置
+    if (take > sizeof(line) - pos - 4) take = sizeof(line) - pos - 4;
+    memcpy(line + pos, data, take);
+    pos += take;
+    if (take < len) {
+        memcpy(line + pos, "...", 3);
+        pos += 3;
+    }
+    line[pos++] = '\n';
+    put(line, pos);
+}
+
+void DeferredLog::flush(Print &out, size_t maxBytes) {
+    if (_dropped > 0 && _size - _used >= 32) {
+        // 报告丢弃的条数
+        char note[32];
+        int n = snprintf(note, sizeof(note), "[log] 丢弃%lu条\n", (unsigned long)_dropped);
+        _dropped = 0;
+        put(note, n);
+    }
+    while (_used > 0 && maxBytes > 0) {
+        size_t chunk = _size - _head;
+        if (chunk > _used) chunk = _used;
+        if (chunk > maxBytes) chunk = maxBytes;
+        // 串口发送缓冲不够时留到下次，不阻塞
+        int room = out.availableForWrite();
+        if (room <= 0) break;
+        if (chunk > (size_t)room) chunk = room;
+        out.write((const uint8_t *)(_buf + _head), chunk);
+        _head = (_head + chunk) % _size;
+        _used -= chunk;
+        maxBytes -= chunk;
+    }
+    if (_used == 0) _head = 0;
+}
@@ -0,0 +1,35 @@
+#ifndef DEFERRED_LOG_H
+#define DEFERRED_LOG_H
+
+#include <Arduino.h>
+
+// 延后输出的日志
+// 消息回调等需要尽快返回的地方只把日志写进环形缓冲，loop()空闲时再分批写到串口，
+// 串口阻塞不会拖慢消息处理。缓冲满时丢弃新日志并计数。
+// 只在loop任务中使用（MQTT回调也在loop()里分发），不加锁。
+class DeferredLog {
+private:
+    char *_buf;
+    size_t _size;
+    size_t _head;       // 下一个要输出的位置
+    size_t _used;
+    uint32_t _dropped;
+
+    void put(const char *text, size_t len);
+
+public:
+    DeferredLog(char *buf, size_t size);
+
+    // 记录一行（自动加换行），超过一行的部分截断
+    void printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+    // 记录一行，data可以不以'\0'结尾，最多取maxLen字节
+    void line(const char *prefix, const char *data, size_t len, size_t maxLen);
+
+    // 在loop()中调用，最多输出maxBytes字节
+    void flush(Print &out, size_t maxBytes);
+
+    uint32_t dropped() const { return _dropped; }
+};
+
+#endif // DEFERRED_LOG_H
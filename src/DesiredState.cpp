@@ -0,0 +1,144 @@
+#include "DesiredState.h"
+#include <Preferences.h>
+#include "PropertyCodec.h"
+
+#define DESIRED_NAMESPACE "shadow"
+
+const uint8_t DesiredState::MAX_PROPERTIES;
+
+// 构造函数
+DesiredState::DesiredState(const PropertyRegistry &registry, uint32_t timeoutMs)
+    : _registry(registry), _savedMask(0), _timeoutMs(timeoutMs), _requestId(0),
+      _requestedAt(0), _waiting(false), _loading(false) {
+    memset(_versions, 0, sizeof(_versions));
+    memset(_saved, 0, sizeof(_saved));
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+// NVS键名最长15字符，属性名放不下，用属性名的FNV-1a哈希命名：v1a2b3c4d为版本号，p1a2b3c4d为值。
+// 不用设置表下标，表中增删或调整属性顺序后保存的值仍然对应原来的属性
+void DesiredState::keyFor(char *key, size_t size, char prefix, const char *name) {
+    uint32_t h = 2166136261UL;
+    while (*name) {
+        h = (h ^ (uint8_t)*name++) * 16777619UL;
+    }
+    snprintf(key, size, "%c%08lx", prefix, (unsigned long)h);
+}
+
+void DesiredState::store(char prefix, size_t index, uint32_t value) {
+    char key[12];
+    keyFor(key, sizeof(key), prefix, _registry.at(index).name);
+    Preferences prefs;
+    if (!prefs.begin(DESIRED_NAMESPACE, false)) return;
+    prefs.putUInt(key, value);
+    prefs.end();
+}
+
+void DesiredState::begin() {
+    Preferences prefs;
+    if (!prefs.begin(DESIRED_NAMESPACE, true)) return;
+
+    size_t count = _registry.count() < MAX_PROPERTIES ? _registry.count() : MAX_PROPERTIES;
+    _loading = true;
+    for (size_t i = 0; i < count; i++) {
+        const SettableProperty &prop = _registry.at(i);
+        char key[12];
+        keyFor(key, sizeof(key), 'v', prop.name);
+        _versions[i] = prefs.getUInt(key, 0);
+
+        if (!(prop.flags & SETTABLE_RETAINED)) continue;
+        keyFor(key, sizeof(key), 'p', prop.name);
+        if (!prefs.isKey(key)) continue;
+
+        _saved[i] = prefs.getUInt(key, 0);
+        _savedMask |= 1UL << i;
+        PropertyValue value;
+        memcpy(&value, &_saved[i], sizeof(value));
+        _registry.applyValue(prop, value);
+    }
+    _loading = false;
+    prefs.end();
+}
+
+// {"id":"1","version":"1.0","method":"thing.property.desired.get","params":["lightState",...]}
+size_t DesiredState::writeRequest(char *buf, size_t size, uint32_t id) {
+    JsonOut out(buf, size);
+    out.raw("{\"id\":\"");
+    out.uinteger(id);
+    out.raw("\",\"version\":\"1.0\",\"method\":\"thing.property.desired.get\",\"params\":[");
+    bool first = true;
+    for (size_t i = 0; i < _registry.count() && i < MAX_PROPERTIES; i++) {
+        const SettableProperty &prop = _registry.at(i);
+        if (prop.flags & SETTABLE_COMMAND) continue;
+        if (!first) out.raw(',');
+        first = false;
+        out.str(prop.name);
+    }
+    out.raw("]}");
+    return out.length();
+}
+
+void DesiredState::requested(uint32_t id, unsigned long now) {
+    _requestId = id;
+    _requestedAt = now;
+    _waiting = true;
+    _stats.requests++;
+}
+
+// data: {"fanState":{"value":1,"version":3},...}，没有设置过期望值的属性不出现或value为null
+uint8_t DesiredState::applyReply(uint32_t id, int code, JsonObjectConst data) {
+    if (!_waiting || id != _requestId) return 0;
+    _waiting = false;
+    _stats.replies++;
+    if (code != 200) return 0;
+
+    uint8_t applied = 0;
+    for (JsonPairConst kv : data) {
+        JsonString key = kv.key();
+        const SettableProperty *prop = _registry.find(key.c_str(), key.size());
+        if (prop == nullptr || (prop->flags & SETTABLE_COMMAND)) continue;
+        size_t index = _registry.indexOf(*prop);
+        if (index >= MAX_PROPERTIES) continue;
+
+        JsonVariantConst desired = kv.value();
+        uint32_t version = desired["version"] | 0;
+        if (desired["value"].isNull()) continue;
+        if (version <= _versions[index]) {
+            _stats.stale++;
+            continue;
+        }
+
+        PropertyRegistry::Result result = _registry.apply(*prop, desired["value"]);
+        if (result == PropertyRegistry::SET_OK || result == PropertyRegistry::SET_CLAMPED) {
+            applied++;
+            _stats.applied++;
+        }
+        // 类型不对的期望值也记下版本，避免每次重连都重试
+        _versions[index] = version;
+        store('v', index, version);
+    }
+    return applied;
+}
+
+bool DesiredState::waiting(unsigned long now) {
+    if (_waiting && now - _requestedAt >= _timeoutMs) {
+        _waiting = false;
+        _stats.timeouts++;
+    }
+    return _waiting;
+}
+
+void DesiredState::remember(size_t index, PropertyValue value) {
+    if (_loading || index >= MAX_PROPERTIES) return;
+    if (!(_registry.at(index).flags & SETTABLE_RETAINED)) return;
+
+    uint32_t bits = 0;
+    memcpy(&bits, &value, sizeof(value));
+    // bool只占1字节，其余位清零后比较
+    if (_registry.at(index).type == PROP_BOOL) bits &= 0xFF;
+    if ((_savedMask & (1UL << index)) && _saved[index] == bits) return;
+
+    _saved[index] = bits;
+    _savedMask |= 1UL << index;
+    store('p', index, bits);
+}
@@ -0,0 +1,65 @@
+#ifndef DESIRED_STATE_H
+#define DESIRED_STATE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "PropertyRegistry.h"
+
+// 期望属性值同步（设备影子）
+// 每次连上MQTT后发一条thing.property.desired.get，一次取回全部可设置属性的期望值，
+// 只应用版本号比上次应用过的更新的值（版本号保存在NVS），离线期间在云端设置的期望值在重连后生效，
+// 已经应用过的旧期望值不会覆盖之后通过property/set或RRPC做的修改。
+// 标记为SETTABLE_RETAINED的属性（阈值）每次设置后保存到NVS，启动时恢复，不再回到编译时的默认值。
+// 只在loop任务中使用。
+class DesiredState {
+public:
+    static const uint8_t MAX_PROPERTIES = 32;
+
+    struct Stats {
+        uint32_t requests;
+        uint32_t replies;
+        uint32_t applied;         // 应用的期望值个数
+        uint32_t stale;           // 版本不比已应用的新，跳过
+        uint32_t timeouts;
+    };
+
+private:
+    const PropertyRegistry &_registry;
+    uint32_t _versions[MAX_PROPERTIES];     // 已应用的期望值版本
+    uint32_t _saved[MAX_PROPERTIES];        // NVS中保存的值（PropertyValue的位）
+    uint32_t _savedMask;
+    uint32_t _timeoutMs;
+    uint32_t _requestId;
+    unsigned long _requestedAt;
+    bool _waiting;
+    bool _loading;                          // 启动恢复期间不回写NVS
+    Stats _stats;
+
+    static void keyFor(char *key, size_t size, char prefix, const char *name);
+    void store(char prefix, size_t index, uint32_t value);
+
+public:
+    DesiredState(const PropertyRegistry &registry, uint32_t timeoutMs);
+
+    // 读取NVS中保存的版本号和属性值，恢复SETTABLE_RETAINED属性（在registry.begin()之后调用）
+    void begin();
+
+    // 写desired.get请求，返回需要的长度（不含'\0'），返回值>=size表示缓冲区不够
+    size_t writeRequest(char *buf, size_t size, uint32_t id);
+
+    // 请求已发出，开始等待应答
+    void requested(uint32_t id, unsigned long now);
+
+    // 处理desired/get_reply，返回应用的属性个数
+    uint8_t applyReply(uint32_t id, int code, JsonObjectConst data);
+
+    // 是否还在等待应答（超时后返回false），等待期间可设置属性不单独上报
+    bool waiting(unsigned long now);
+
+    // 属性设置成功后调用（PropertyRegistry::AppliedHook），保存需要保留的属性
+    void remember(size_t index, PropertyValue value);
+
+    const Stats &stats() const { return _stats; }
+};
+
+#endif // DESIRED_STATE_H
@@ -0,0 +1,119 @@
+#include "DeviceIdentity.h"
+#include "ThingModel.h"
+#include <Preferences.h>
+#include <mbedtls/md.h>
+
+#define IDENTITY_NAMESPACE "aliyun"
+
+const uint8_t DeviceIdentity::KEY_MAX;
+const uint8_t DeviceIdentity::TOPIC_MAX;
+
+// 构造函数
+DeviceIdentity::DeviceIdentity() : _fromNvs(false), _secureMode(3) {
+    _productKey[0] = _deviceName[0] = _deviceSecret[0] = _region[0] = '\0';
+    _host[0] = _clientId[0] = _username[0] = _password[0] = '\0';
+    memset(_topics, 0, sizeof(_topics));
+}
+
+// 读一项，NVS中没有时用默认值
+static bool loadKey(Preferences &prefs, const char *key, char *out, size_t size, const char *fallback) {
+    if (prefs.isKey(key) && prefs.getString(key, out, size) > 1) {
+        return true;
+    }
+    strncpy(out, fallback, size - 1);
+    out[size - 1] = '\0';
+    return false;
+}
+
+bool DeviceIdentity::begin(const char *defaultProductKey, const char *defaultDeviceName,
+                           const char *defaultDeviceSecret, const char *defaultRegion) {
+    Preferences prefs;
+    bool opened = prefs.begin(IDENTITY_NAMESPACE, true);
+    _fromNvs = opened;
+    _fromNvs &= loadKey(prefs, "pk", _productKey, sizeof(_productKey), defaultProductKey);
+    _fromNvs &= loadKey(prefs, "dn", _deviceName, sizeof(_deviceName), defaultDeviceName);
+    _fromNvs &= loadKey(prefs, "ds", _deviceSecret, sizeof(_deviceSecret), defaultDeviceSecret);
+    loadKey(prefs, "region", _region, sizeof(_region), defaultRegion);
+    if (opened) prefs.end();
+
+    buildNames();
+    return _fromNvs;
+}
+
+bool DeviceIdentity::store(const char *productKey, const char *deviceName,
+                           const char *deviceSecret, const char *region) {
+    Preferences prefs;
+    if (!prefs.begin(IDENTITY_NAMESPACE, false)) return false;
+    bool ok = prefs.putString("pk", productKey) > 0 &&
+              prefs.putString("dn", deviceName) > 0 &&
+              prefs.putString("ds", deviceSecret) > 0 &&
+              prefs.putString("region", region) > 0;
+    prefs.end();
+    return ok;
+}
+
+// 拼出服务器域名和主题
+void DeviceIdentity::buildNames() {
+    static const char *const SUFFIX[TOPIC_COUNT] = {
+        "thing/event/property/post",
+        "thing/event/property/post_reply",
+        "thing/service/property/set",
+        "thing/service/property/set_reply",
+        "thing/event/property/history/post",
+        "thing/event/property/history/post_reply",
+        "thing/model/up_raw",
+        "thing/model/up_raw_reply",
+        TSL_EVENT_FIRE_ALARM_TOPIC,
+        TSL_EVENT_SMOKE_ALARM_TOPIC,
+        "thing/event/+/post_reply",
+        "rrpc/request/+",
+        "rrpc/response/",
+        "thing/property/desired/get",
+        "thing/property/desired/get_reply",
+        nullptr  // 自定义主题，没有/sys前缀
+    };
+
+    snprintf(_host, sizeof(_host), "%s.iot-as-mqtt.%s.aliyuncs.com", _productKey, _region);
+    for (uint8_t i = 0; i < TOPIC_COUNT; i++) {
+        if (SUFFIX[i]) {
+            snprintf(_topics[i], TOPIC_MAX, "/sys/%s/%s/%s", _productKey, _deviceName, SUFFIX[i]);
+        }
+    }
+    snprintf(_topics[TOPIC_USER_UPDATE], TOPIC_MAX, "/%s/%s/user/update", _productKey, _deviceName);
+}
+
+// 按阿里云规则生成连接参数：
+//   clientId = pk.dn|securemode=N,signmethod=hmacsha256[,timestamp=T]|
+//   username = dn&pk
+//   password = hex(HMAC-SHA256(DeviceSecret, "clientId<pk.dn>deviceName<dn>productKey<pk>[timestamp<T>]"))
+bool DeviceIdentity::sign(uint64_t timestampMs) {
+    char timestamp[21] = "";
+    if (timestampMs) {
+        snprintf(timestamp, sizeof(timestamp), "%llu", (unsigned long long)timestampMs);
+    }
+
+    char content[256];
+    int contentLen = snprintf(content, sizeof(content), "clientId%s.%sdeviceName%sproductKey%s%s%s",
+                              _productKey, _deviceName, _deviceName, _productKey,
+                              timestampMs ? "timestamp" : "", timestamp);
+    if (contentLen <= 0 || contentLen >= (int)sizeof(content)) return false;
+
+    uint8_t mac[32];
+    const mbedtls_md_info_t *info = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+    if (mbedtls_md_hmac(info, (const uint8_t *)_deviceSecret, strlen(_deviceSecret),
+                        (const uint8_t *)content, contentLen, mac) != 0) {
+        return false;
+    }
+
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+    for (uint8_t i = 0; i < sizeof(mac); i++) {
+        _password[i * 2] = HEX_DIGITS[mac[i] >> 4];
+        _password[i * 2 + 1] = HEX_DIGITS[mac[i] & 0x0F];
+    }
+    _password[64] = '\0';
+
+    snprintf(_clientId, sizeof(_clientId), "%s.%s|securemode=%u,signmethod=hmacsha256%s%s|",
+             _productKey, _deviceName, _secureMode, timestampMs ? ",timestamp=" : "", timestamp);
+    snprintf(_username, sizeof(_username), "%s&%s", _deviceName, _productKey);
+    return true;
+}
@@ -0,0 +1,82 @@
+#ifndef DEVICE_IDENTITY_H
+#define DEVICE_IDENTITY_H
+
+#include <Arduino.h>
+
+// 阿里云设备身份
+// 三元组（ProductKey/DeviceName/DeviceSecret）和地域从NVS读取，同一份固件可以烧录到所有设备，
+// 每台设备只需写入自己的NVS（命名空间"aliyun"，键pk/dn/ds/region，可用nvs_partition_gen批量生成）。
+// NVS中没有时退回编译时的默认值。
+// 每次连接前调用sign()现场生成clientId/username/password（HMAC-SHA256，mbedTLS走S3的SHA硬件加速），
+// 所有主题和服务器域名也在运行时拼出，指针在对象生命周期内保持有效。
+class DeviceIdentity {
+public:
+    enum Topic {
+        TOPIC_PROP_POST,
+        TOPIC_PROP_POST_REPLY,
+        TOPIC_PROP_SET,
+        TOPIC_PROP_SET_REPLY,
+        TOPIC_HISTORY_POST,
+        TOPIC_HISTORY_POST_REPLY,
+        TOPIC_RAW_UP,
+        TOPIC_RAW_UP_REPLY,
+        TOPIC_EVENT_FIRE_ALARM,
+        TOPIC_EVENT_SMOKE_ALARM,
+        TOPIC_EVENT_POST_REPLY,     // 所有事件（含属性上报）的post_reply，订阅用通配符
+        TOPIC_RRPC_REQUEST,         // RRPC请求，订阅用通配符，最后一级是messageId
+        TOPIC_RRPC_RESPONSE,        // RRPC应答主题前缀，后面接messageId
+        TOPIC_DESIRED_GET,
+        TOPIC_DESIRED_GET_REPLY,
+        TOPIC_USER_UPDATE,
+        TOPIC_COUNT
+    };
+
+    static const uint8_t KEY_MAX = 64;
+    static const uint8_t TOPIC_MAX = 128;
+
+private:
+    char _productKey[KEY_MAX];
+    char _deviceName[KEY_MAX];
+    char _deviceSecret[KEY_MAX];
+    char _region[32];
+    char _host[128];
+    char _topics[TOPIC_COUNT][TOPIC_MAX];
+
+    // sign()生成的连接参数
+    char _clientId[192];
+    char _username[2 * KEY_MAX + 2];
+    char _password[65];
+
+    bool _fromNvs;
+    uint8_t _secureMode;
+
+    void buildNames();
+
+public:
+    DeviceIdentity();
+
+    // 从NVS加载三元组，缺少的项使用默认值；返回true表示全部来自NVS
+    bool begin(const char *defaultProductKey, const char *defaultDeviceName,
+               const char *defaultDeviceSecret, const char *defaultRegion);
+
+    // 写入NVS（产线烧录或串口配置用），下次启动生效
+    static bool store(const char *productKey, const char *deviceName,
+                      const char *deviceSecret, const char *region);
+
+    // securemode：2为TLS直连，3为TCP直连
+    void setSecureMode(uint8_t mode) { _secureMode = mode; }
+
+    // 生成连接参数，timestampMs为0时不带时间戳
+    bool sign(uint64_t timestampMs);
+
+    const char *productKey() const { return _productKey; }
+    const char *deviceName() const { return _deviceName; }
+    const char *host() const { return _host; }
+    const char *topic(Topic topic) const { return _topics[topic]; }
+    const char *clientId() const { return _clientId; }
+    const char *username() const { return _username; }
+    const char *password() const { return _password; }
+    bool fromNvs() const { return _fromNvs; }
+};
+
+#endif // DEVICE_IDENTITY_H
@@ -0,0 +1,65 @@
+#include "DisplayGovernor.h"
+
+// 构造函数
+DisplayGovernor::DisplayGovernor(uint8_t targetFps, uint32_t loadBudgetUs, uint8_t minFps)
+    : _loadBudgetUs(loadBudgetUs), _maxGapUs(minFps ? 1000000UL / minFps : 0),
+      _lastFrameStartUs(0), _lastDrawnUs(0), _frameStartUs(0), _lastLoopUs(0), _inFrame(false) {
+    memset(&_metrics, 0, sizeof(_metrics));
+    setTargetFps(targetFps);
+}
+
+// 设置帧率上限，0表示不限制
+void DisplayGovernor::setTargetFps(uint8_t fps) {
+    _frameIntervalUs = fps ? 1000000UL / fps : 0;
+}
+
+// 测量控制循环周期
+void DisplayGovernor::loopTick() {
+    uint32_t now = micros();
+    if (_lastLoopUs != 0) {
+        uint32_t period = now - _lastLoopUs;
+        // 滑动平均，权重1/8
+        _metrics.loopUs = _metrics.loopUs ? _metrics.loopUs - (_metrics.loopUs >> 3) + (period >> 3) : period;
+    }
+    _lastLoopUs = now;
+}
+
+// 决定本次是否绘制
+bool DisplayGovernor::beginFrame(bool force) {
+    uint32_t now = micros();
+
+    if (!force) {
+        // 未到下一帧时间，不算丢帧
+        if (now - _lastFrameStartUs < _frameIntervalUs) {
+            return false;
+        }
+
+        // 控制循环负载过高，跳过这一帧把时间让给传感和网络；但距上次绘制太久时照常绘制
+        bool starved = _maxGapUs && now - _lastDrawnUs >= _maxGapUs;
+        if (_loadBudgetUs && _metrics.loopUs > _loadBudgetUs && !starved) {
+            _metrics.dropped++;
+            _lastFrameStartUs = now;
+            return false;
+        }
+    }
+
+    _frameStartUs = now;
+    _lastFrameStartUs = now;
+    _lastDrawnUs = now;
+    _inFrame = true;
+    return true;
+}
+
+// 记录帧耗时
+void DisplayGovernor::endFrame() {
+    if (!_inFrame) return;
+    _inFrame = false;
+
+    uint32_t elapsed = micros() - _frameStartUs;
+    _metrics.lastFrameUs = elapsed;
+    _metrics.avgFrameUs = _metrics.frames ? _metrics.avgFrameUs - (_metrics.avgFrameUs >> 3) + (elapsed >> 3) : elapsed;
+    if (elapsed > _metrics.maxFrameUs) {
+        _metrics.maxFrameUs = elapsed;
+    }
+    _metrics.frames++;
+}
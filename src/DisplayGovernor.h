@@ -0,0 +1,55 @@
+#ifndef DISPLAY_GOVERNOR_H
+#define DISPLAY_GOVERNOR_H
+
+#include <Arduino.h>
+
+// OLED刷新调速器
+// 限制最大帧率，控制循环负载过高时自动跳帧，并统计帧耗时和丢帧数。
+// 跳帧有下限：距上次绘制超过最小帧率对应的间隔时照常绘制，持续高负载时界面也不会停住。
+class DisplayGovernor {
+public:
+    // 显示性能指标
+    struct Metrics {
+        uint32_t lastFrameUs;   // 最近一帧耗时（微秒）
+        uint32_t avgFrameUs;    // 平均帧耗时（指数滑动平均）
+        uint32_t maxFrameUs;    // 最大帧耗时
+        uint32_t frames;        // 已绘制帧数
+        uint32_t dropped;       // 因负载过高跳过的帧数
+        uint32_t loopUs;        // 控制循环周期（指数滑动平均）
+    };
+
+private:
+    uint32_t _frameIntervalUs;  // 最小帧间隔
+    uint32_t _loadBudgetUs;     // 循环周期超过该值视为高负载
+    uint32_t _maxGapUs;         // 高负载时最长多久必须绘制一帧
+    uint32_t _lastFrameStartUs; // 上一帧开始时间（含跳过的帧）
+    uint32_t _lastDrawnUs;      // 上一次实际绘制的时间
+    uint32_t _frameStartUs;     // 当前帧开始时间
+    uint32_t _lastLoopUs;       // 上次循环开始时间
+    bool _inFrame;
+    Metrics _metrics;
+
+public:
+    // 构造函数，targetFps为帧率上限，loadBudgetUs为负载阈值，minFps为高负载时的最低帧率
+    DisplayGovernor(uint8_t targetFps, uint32_t loadBudgetUs, uint8_t minFps = 1);
+
+    // 设置帧率上限
+    void setTargetFps(uint8_t fps);
+
+    // 每次进入loop()时调用，测量控制循环周期
+    void loopTick();
+
+    // 询问本次是否绘制，force用于页面切换等必须立即刷新的场合
+    bool beginFrame(bool force = false);
+
+    // 绘制结束，记录帧耗时
+    void endFrame();
+
+    // 读取指标
+    const Metrics &metrics() const { return _metrics; }
+
+    // 清零最大值统计（每个上报周期调用一次）
+    void resetPeak() { _metrics.maxFrameUs = 0; }
+};
+
+#endif // DISPLAY_GOVERNOR_H
@@ -0,0 +1,64 @@
+#include "DisplayPower.h"
+
+// 构造函数
+DisplayPower::DisplayPower(U8G2 &display, unsigned long dimAfterMs, unsigned long offAfterMs,
+                           uint8_t normalContrast, uint8_t dimContrast)
+    : _display(display), _dimAfterMs(dimAfterMs), _offAfterMs(offAfterMs),
+      _normalContrast(normalContrast), _dimContrast(dimContrast),
+      _lastActivity(0), _state(POWER_ACTIVE), _hold(false) {
+}
+
+// 初始化
+void DisplayPower::begin() {
+    _lastActivity = millis();
+    _state = POWER_OFF;         // 强制下发一次亮度和唤醒命令
+    setState(POWER_ACTIVE);
+}
+
+// 切换状态，只在状态变化时发送命令
+void DisplayPower::setState(State state) {
+    if (state == _state) return;
+
+    if (state == POWER_OFF) {
+        _display.setPowerSave(1);
+    } else {
+        if (_state == POWER_OFF) {
+            _display.setPowerSave(0);
+        }
+        _display.setContrast(state == POWER_DIMMED ? _dimContrast : _normalContrast);
+    }
+    _state = state;
+}
+
+// 用户活动
+bool DisplayPower::wake() {
+    bool wasOff = (_state == POWER_OFF);
+    _lastActivity = millis();
+    setState(POWER_ACTIVE);
+    return wasOff;
+}
+
+// 保持点亮
+bool DisplayPower::hold(bool hold) {
+    bool wasOff = false;
+    if (hold && !_hold) {
+        wasOff = wake();
+    } else if (!hold && _hold) {
+        // 保持结束后重新开始计时
+        _lastActivity = millis();
+    }
+    _hold = hold;
+    return wasOff;
+}
+
+// 处理超时
+void DisplayPower::update() {
+    if (_hold) return;
+
+    unsigned long idle = millis() - _lastActivity;
+    if (_offAfterMs && idle >= _offAfterMs) {
+        setState(POWER_OFF);
+    } else if (_dimAfterMs && idle >= _dimAfterMs) {
+        setState(POWER_DIMMED);
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef DISPLAY_POWER_H
+#define DISPLAY_POWER_H
+
+#include <Arduino.h>
+#include <U8g2lib.h>
+
+// OLED电源管理
+// 无操作一段时间后先降低亮度，再进入SSD1306省电模式（关闭显示、停止刷新）；
+// 按键或报警时立即唤醒。显示RAM在省电模式下保持不变。
+class DisplayPower {
+public:
+    enum State {
+        POWER_ACTIVE,   // 正常亮度
+        POWER_DIMMED,   // 降低亮度
+        POWER_OFF       // 省电模式，不刷新
+    };
+
+private:
+    U8G2 &_display;
+    unsigned long _dimAfterMs;      // 无操作多久后降低亮度
+    unsigned long _offAfterMs;      // 无操作多久后关闭显示
+    uint8_t _normalContrast;
+    uint8_t _dimContrast;
+    unsigned long _lastActivity;
+    State _state;
+    bool _hold;                     // 保持点亮（报警、查寝期间）
+
+    void setState(State state);
+
+public:
+    DisplayPower(U8G2 &display, unsigned long dimAfterMs, unsigned long offAfterMs,
+                 uint8_t normalContrast = 0xCF, uint8_t dimContrast = 0x01);
+
+    // 显示屏初始化之后调用
+    void begin();
+
+    // 记录一次用户活动并恢复正常亮度，返回之前是否处于关闭状态
+    bool wake();
+
+    // 设置保持点亮，hold为true时不会降低亮度或关闭；返回是否从关闭状态唤醒
+    bool hold(bool hold);
+
+    // 在loop()中调用，处理超时
+    void update();
+
+    // 是否允许刷新显示
+    bool renderAllowed() const { return _state != POWER_OFF; }
+    State state() const { return _state; }
+};
+
+#endif // DISPLAY_POWER_H
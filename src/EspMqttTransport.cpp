@@ -0,0 +1,220 @@
+#include "EspMqttTransport.h"
+
+#ifdef MQTT_USE_ESP_MQTT
+
+#include <esp_idf_version.h>
+
+// 错误码沿用PubSubClient::state()的含义，上层日志无需区分后端
+#define ESP_MQTT_ERR_CONNECTION_LOST  -3
+#define ESP_MQTT_ERR_CONNECT_FAILED   -2
+#define ESP_MQTT_ERR_DISCONNECTED     -1
+
+// 构造函数
+EspMqttTransport::EspMqttTransport(uint16_t bufferSize, uint16_t keepAlive, uint8_t inboxDepth)
+    : _client(nullptr), _inbox(nullptr), _callback(nullptr), _host(nullptr), _serverName(nullptr),
+      _address(), _caCert(nullptr), _port(0),
+      _bufferSize(bufferSize), _keepAlive(keepAlive), _inboxDepth(inboxDepth),
+      _connected(false), _connecting(false), _lastError(ESP_MQTT_ERR_DISCONNECTED),
+      _partial(nullptr), _partialTopicLen(0), _partialLen(0) {
+}
+
+// 设置服务器和回调，创建接收队列
+void EspMqttTransport::begin(const char *host, uint16_t port, MessageCallback callback) {
+    _host = host;
+    _serverName = host;
+    _port = port;
+    _callback = callback;
+    if (!_inbox) {
+        _inbox = xQueueCreate(_inboxDepth, sizeof(Inbound));
+    }
+}
+
+// 更换服务器（IP直接写成点分字符串，esp-mqtt不再查DNS）
+// IDF4的esp-mqtt不能单独指定校验证书用的域名，TLS时仍按域名连接
+void EspMqttTransport::setServer(const char *host, const IPAddress &ip, uint16_t port) {
+    _serverName = host;
+#if ESP_IDF_VERSION_MAJOR >= 5
+    bool useIp = (uint32_t)ip != 0;
+#else
+    bool useIp = (uint32_t)ip != 0 && _caCert == nullptr;
+#endif
+    if (useIp) {
+        snprintf(_address, sizeof(_address), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+        _host = _address;
+    } else {
+        _host = host;
+    }
+    _port = port;
+}
+
+// 填写esp-mqtt配置（IDF5把配置改成了嵌套结构）
+void EspMqttTransport::fillConfig(esp_mqtt_client_config_t &cfg, const char *clientId,
+                                  const char *username, const char *password) {
+    memset(&cfg, 0, sizeof(cfg));
+#if ESP_IDF_VERSION_MAJOR >= 5
+    cfg.broker.address.hostname = _host;
+    cfg.broker.address.port = _port;
+    cfg.broker.address.transport = _caCert ? MQTT_TRANSPORT_OVER_SSL : MQTT_TRANSPORT_OVER_TCP;
+    if (_caCert) {
+        cfg.broker.verification.certificate = _caCert;
+        cfg.broker.verification.common_name = _serverName;   // 按IP连接时仍校验域名
+    }
+    cfg.credentials.client_id = clientId;
+    cfg.credentials.username = username;
+    cfg.credentials.authentication.password = password;
+    cfg.session.keepalive = _keepAlive;
+    cfg.network.disable_auto_reconnect = true;   // 重连由MqttConnection按退避控制
+    cfg.buffer.size = _bufferSize;
+    cfg.buffer.out_size = _bufferSize;
+#else
+    cfg.host = _host;
+    cfg.port = _port;
+    cfg.transport = _caCert ? MQTT_TRANSPORT_OVER_SSL : MQTT_TRANSPORT_OVER_TCP;
+    cfg.cert_pem = _caCert;
+    cfg.client_id = clientId;
+    cfg.username = username;
+    cfg.password = password;
+    cfg.keepalive = _keepAlive;
+    cfg.disable_auto_reconnect = true;           // 重连由MqttConnection按退避控制
+    cfg.buffer_size = _bufferSize;
+    cfg.out_buffer_size = _bufferSize;
+#endif
+}
+
+// 发起连接，结果由事件回调更新
+MqttTransport::ConnectResult EspMqttTransport::connect(const char *clientId, const char *username, const char *password) {
+    esp_mqtt_client_config_t cfg;
+    fillConfig(cfg, clientId, username, password);
+
+    if (!_client) {
+        _client = esp_mqtt_client_init(&cfg);
+        if (!_client) {
+            _lastError = ESP_MQTT_ERR_CONNECT_FAILED;
+            return TRANSPORT_CONNECT_FAILED;
+        }
+        esp_mqtt_client_register_event(_client, (esp_mqtt_event_id_t)ESP_EVENT_ANY_ID, eventHandler, this);
+    } else {
+        // 上一次会话的任务可能还在，先停掉再用新参数启动
+        esp_mqtt_client_stop(_client);
+        esp_mqtt_set_config(_client, &cfg);
+    }
+
+    _connected = false;
+    _connecting = true;
+    if (esp_mqtt_client_start(_client) != ESP_OK) {
+        _connecting = false;
+        _lastError = ESP_MQTT_ERR_CONNECT_FAILED;
+        return TRANSPORT_CONNECT_FAILED;
+    }
+    return TRANSPORT_CONNECT_PENDING;
+}
+
+// 断开连接并停止MQTT任务
+void EspMqttTransport::disconnect() {
+    if (_client) {
+        esp_mqtt_client_stop(_client);
+    }
+    _connected = false;
+    _connecting = false;
+}
+
+// 把MQTT任务收到的消息交给回调
+void EspMqttTransport::loop() {
+    if (!_inbox) return;
+
+    Inbound msg;
+    while (xQueueReceive(_inbox, &msg, 0) == pdTRUE) {
+        if (_callback) {
+            char *topic = msg.data;
+            byte *payload = (byte *)msg.data + msg.topicLen + 1;
+            _callback(topic, payload, msg.payloadLen);
+        }
+        free(msg.data);
+    }
+}
+
+// 放入发送队列，不等待网络
+bool EspMqttTransport::publish(const char *topic, const uint8_t *payload, size_t length, uint8_t qos) {
+    if (!_client || !_connected) return false;
+    return esp_mqtt_client_enqueue(_client, topic, (const char *)payload, length, qos, 0, true) >= 0;
+}
+
+// 订阅主题
+bool EspMqttTransport::subscribe(const char *topic, uint8_t qos) {
+    if (!_client || !_connected) return false;
+    return esp_mqtt_client_subscribe(_client, topic, qos) >= 0;
+}
+
+// esp-mqtt事件入口（在MQTT任务中执行）
+void EspMqttTransport::eventHandler(void *arg, esp_event_base_t base, int32_t eventId, void *eventData) {
+    (void)base;
+    (void)eventId;
+    static_cast<EspMqttTransport *>(arg)->handleEvent((esp_mqtt_event_handle_t)eventData);
+}
+
+// 更新连接状态
+void EspMqttTransport::handleEvent(esp_mqtt_event_handle_t event) {
+    switch (event->event_id) {
+        case MQTT_EVENT_CONNECTED:
+            _lastError = 0;
+            _connected = true;
+            _connecting = false;
+            break;
+
+        case MQTT_EVENT_DISCONNECTED:
+            _lastError = _connected ? ESP_MQTT_ERR_CONNECTION_LOST : ESP_MQTT_ERR_CONNECT_FAILED;
+            _connected = false;
+            _connecting = false;
+            break;
+
+        case MQTT_EVENT_ERROR:
+            if (event->error_handle &&
+                event->error_handle->error_type == MQTT_ERROR_TYPE_CONNECTION_REFUSED) {
+                // 服务器拒绝，返回CONNACK里的错误码（1~5）
+                _lastError = event->error_handle->connect_return_code;
+            } else if (!_connected) {
+                _lastError = ESP_MQTT_ERR_CONNECT_FAILED;
+            }
+            break;
+
+        case MQTT_EVENT_DATA:
+            handleData(event);
+            break;
+
+        default:
+            break;
+    }
+}
+
+// 复制收到的消息，大消息会分多次事件到达，拼完整后再入队
+void EspMqttTransport::handleData(esp_mqtt_event_handle_t event) {
+    if (event->current_data_offset == 0) {
+        free(_partial);
+        _partialTopicLen = event->topic_len;
+        _partialLen = event->total_data_len;
+        // 布局：topic '\0' payload '\0'
+        _partial = (char *)malloc(_partialTopicLen + 1 + _partialLen + 1);
+        if (!_partial) return;
+        memcpy(_partial, event->topic, _partialTopicLen);
+        _partial[_partialTopicLen] = '\0';
+    }
+    if (!_partial) return;
+
+    uint32_t offset = event->current_data_offset;
+    if (offset + event->data_len > _partialLen) return;
+    memcpy(_partial + _partialTopicLen + 1 + offset, event->data, event->data_len);
+    if (offset + event->data_len < _partialLen) return;
+
+    _partial[_partialTopicLen + 1 + _partialLen] = '\0';
+    Inbound msg;
+    msg.topicLen = _partialTopicLen;
+    msg.payloadLen = _partialLen;
+    msg.data = _partial;
+    if (xQueueSend(_inbox, &msg, 0) != pdTRUE) {
+        // 主循环来不及处理，丢弃
+        free(_partial);
+    }
+    _partial = nullptr;
+}
+
+#endif // MQTT_USE_ESP_MQTT
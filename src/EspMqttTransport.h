@@ -0,0 +1,77 @@
+#ifndef ESP_MQTT_TRANSPORT_H
+#define ESP_MQTT_TRANSPORT_H
+
+#include <Arduino.h>
+#include "MqttTransport.h"
+
+// 基于ESP-IDF esp-mqtt的异步MQTT后端（编译时定义MQTT_USE_ESP_MQTT启用）
+// 协议收发在esp-mqtt自己的任务中进行，publish()只把消息放入它的发送队列（outbox）后立即返回，
+// 网络卡顿不会阻塞loop()。收到的消息在MQTT任务中复制进FreeRTOS队列，
+// 再由loop()取出并调用回调，因此回调仍在主循环中执行，与PubSubClient后端语义相同。
+// 设置了CA证书时走TLS（esp-tls校验服务器证书）；esp-mqtt没有提供TLS会话复用的配置，
+// 每次重连都是完整握手，需要会话复用时用默认的PubSubClient后端（TlsClient）。
+#ifdef MQTT_USE_ESP_MQTT
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <mqtt_client.h>
+
+class EspMqttTransport : public MqttTransport {
+private:
+    // 队列中的一条消息，topic和payload连续存放在data中，由loop()释放
+    struct Inbound {
+        uint16_t topicLen;
+        uint32_t payloadLen;
+        char *data;
+    };
+
+    esp_mqtt_client_handle_t _client;
+    QueueHandle_t _inbox;
+    MessageCallback _callback;
+    const char *_host;          // 实际连接的地址（域名或点分IP）
+    const char *_serverName;    // 服务器域名，TLS时用于SNI和证书校验
+    char _address[16];          // 按IP连接时的点分地址
+    const char *_caCert;        // PEM格式CA证书，nullptr表示TCP直连
+    uint16_t _port;
+    uint16_t _bufferSize;
+    uint16_t _keepAlive;
+    uint8_t _inboxDepth;
+
+    volatile bool _connected;
+    volatile bool _connecting;
+    volatile int _lastError;
+
+    // 分片消息的拼接缓冲（只在MQTT任务中访问）
+    char *_partial;
+    uint16_t _partialTopicLen;
+    uint32_t _partialLen;
+
+    static void eventHandler(void *arg, esp_event_base_t base, int32_t eventId, void *eventData);
+    void handleEvent(esp_mqtt_event_handle_t event);
+    void handleData(esp_mqtt_event_handle_t event);
+    void fillConfig(esp_mqtt_client_config_t &cfg, const char *clientId,
+                    const char *username, const char *password);
+
+public:
+    // bufferSize为收发缓冲区，inboxDepth为等待loop()处理的消息条数上限
+    EspMqttTransport(uint16_t bufferSize, uint16_t keepAlive = 60, uint8_t inboxDepth = 8);
+
+    // 设置CA证书（PEM，指针需长期有效）后走TLS，需在connect()之前调用
+    void setCaCert(const char *pem) { _caCert = pem; }
+
+    void begin(const char *host, uint16_t port, MessageCallback callback) override;
+    void setServer(const char *host, const IPAddress &ip, uint16_t port) override;
+    ConnectResult connect(const char *clientId, const char *username, const char *password) override;
+    bool connected() override { return _connected; }
+    bool connecting() override { return _connecting; }
+    void disconnect() override;
+    void loop() override;
+    bool publish(const char *topic, const uint8_t *payload, size_t length, uint8_t qos = 0) override;
+    using MqttTransport::publish;
+    bool subscribe(const char *topic, uint8_t qos = 0) override;
+    int state() override { return _lastError; }
+};
+
+#endif // MQTT_USE_ESP_MQTT
+
+#endif // ESP_MQTT_TRANSPORT_H
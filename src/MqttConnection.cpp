@@ -0,0 +1,137 @@
+#include "MqttConnection.h"
+
+// 构造函数
+MqttConnection::MqttConnection(MqttTransport &transport, uint32_t minBackoffMs, uint32_t maxBackoffMs,
+                               uint32_t connectTimeoutMs, uint32_t stableMs)
+    : _transport(transport), _clientId(nullptr), _username(nullptr), _password(nullptr),
+      _state(CONN_WAIT_NETWORK), _minBackoffMs(minBackoffMs), _maxBackoffMs(maxBackoffMs),
+      _backoffMs(0), _retryAt(0), _failures(0),
+      _connectTimeoutMs(connectTimeoutMs), _stableMs(stableMs), _connectStart(0), _connectedAt(0),
+      _lastError(0),
+      _onState(nullptr), _onConnected(nullptr), _onPrepare(nullptr) {
+}
+
+// 设置连接参数
+void MqttConnection::setCredentials(const char *clientId, const char *username, const char *password) {
+    _clientId = clientId;
+    _username = username;
+    _password = password;
+}
+
+// 切换状态并通知界面
+void MqttConnection::setState(State state) {
+    if (state == _state) return;
+    _state = state;
+    if (_onState) {
+        _onState(state, _lastError);
+    }
+}
+
+// 进行一次连接尝试
+void MqttConnection::attempt() {
+    setState(CONN_CONNECTING);
+    _connectStart = millis();
+
+    if (_onPrepare && !_onPrepare()) {
+        _lastError = 0;
+        scheduleRetry();
+        return;
+    }
+
+    switch (_transport.connect(_clientId, _username, _password)) {
+        case MqttTransport::TRANSPORT_CONNECT_OK:
+            established();
+            break;
+        case MqttTransport::TRANSPORT_CONNECT_PENDING:
+            // 异步后端，结果在loop()中检查
+            break;
+        case MqttTransport::TRANSPORT_CONNECT_FAILED:
+            _lastError = _transport.state();
+            scheduleRetry();
+            break;
+    }
+}
+
+// 连接建立（失败次数等连接稳定后再清零）
+void MqttConnection::established() {
+    _lastError = 0;
+    _connectedAt = millis();
+    setState(CONN_CONNECTED);
+    if (_onConnected) {
+        _onConnected();
+    }
+}
+
+// 安排下一次重试：指数退避，等待时间在[backoff/2, backoff]之间随机
+void MqttConnection::scheduleRetry() {
+    uint32_t backoff = _minBackoffMs;
+    for (uint16_t i = 0; i < _failures && backoff < _maxBackoffMs; i++) {
+        backoff *= 2;
+    }
+    if (backoff > _maxBackoffMs) backoff = _maxBackoffMs;
+
+    // 随机抖动，避免大量设备在同一时刻重连
+    _backoffMs = backoff / 2 + random(backoff / 2 + 1);
+    _retryAt = millis() + _backoffMs;
+    _failures++;
+    setState(CONN_BACKOFF);
+}
+
+// 跳过退避立即重试
+void MqttConnection::retryNow() {
+    if (_state == CONN_BACKOFF) {
+        _retryAt = millis();
+    }
+}
+
+// 状态机主循环
+void MqttConnection::loop(bool networkUp) {
+    if (!networkUp) {
+        if (_state == CONN_CONNECTED || _state == CONN_CONNECTING) {
+            _transport.disconnect();
+        }
+        setState(CONN_WAIT_NETWORK);
+        return;
+    }
+
+    switch (_state) {
+        case CONN_WAIT_NETWORK:
+            // 网络刚恢复，立即尝试（上一次被放弃的连接结束后）
+            if (!_transport.connecting()) {
+                attempt();
+            }
+            break;
+
+        case CONN_CONNECTED:
+            if (_transport.connected()) {
+                _transport.loop();
+                if (_failures > 0 && millis() - _connectedAt >= _stableMs) {
+                    _failures = 0;
+                    _backoffMs = 0;
+                }
+            } else {
+                // 连接断开，按退避重连
+                _lastError = _transport.state();
+                scheduleRetry();
+            }
+            break;
+
+        case CONN_BACKOFF:
+            if ((long)(millis() - _retryAt) >= 0 && !_transport.connecting()) {
+                attempt();
+            }
+            break;
+
+        case CONN_CONNECTING:
+            // 只有异步后端会停留在这里
+            if (_transport.connected()) {
+                established();
+            } else if (!_transport.connecting() ||
+                       millis() - _connectStart >= _connectTimeoutMs) {
+                _lastError = _transport.state();
+                _transport.disconnect();
+                scheduleRetry();
+            }
+            break;
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef MQTT_CONNECTION_H
+#define MQTT_CONNECTION_H
+
+#include <Arduino.h>
+#include "MqttTransport.h"
+
+// MQTT连接状态机
+// 在loop()中调用，每次最多进行一次连接尝试，失败后按指数退避加随机抖动安排下一次，
+// 状态机本身不循环重试也不延时。连接保持stableMs以上才清零失败次数，
+// 服务器接受连接后马上断开（反复闪断）时退避照样增长，不会每隔一两秒重连一次。
+// 传输层可以是同步的（connect()返回即有结果）或异步的（在CONNECTING状态等待结果，超时按失败处理）。
+// 超时放弃的连接在后端仍可能没有结束，connecting()为真期间不发起下一次尝试。
+class MqttConnection {
+public:
+    enum State {
+        CONN_WAIT_NETWORK,  // 等待WiFi
+        CONN_CONNECTING,    // 正在连接
+        CONN_CONNECTED,     // 已连接
+        CONN_BACKOFF        // 连接失败，等待重试
+    };
+
+    // 状态变化回调，error为MqttTransport::state()返回的错误码
+    typedef void (*StateCallback)(State state, int error);
+    // 连接成功回调（用于订阅主题）
+    typedef void (*ConnectedCallback)();
+    // 每次连接前回调（用于现场生成签名），返回false时本次按失败处理
+    typedef bool (*PrepareCallback)();
+
+private:
+    MqttTransport &_transport;
+    const char *_clientId;
+    const char *_username;
+    const char *_password;
+
+    State _state;
+    uint32_t _minBackoffMs;     // 首次重试等待时间
+    uint32_t _maxBackoffMs;     // 最大重试等待时间
+    uint32_t _backoffMs;        // 本次等待时间
+    unsigned long _retryAt;     // 下一次尝试的时间
+    uint16_t _failures;         // 连续失败次数
+    uint32_t _connectTimeoutMs; // 异步连接等待结果的最长时间
+    uint32_t _stableMs;         // 连接保持多久算稳定
+    unsigned long _connectStart;
+    unsigned long _connectedAt;
+    int _lastError;
+
+    StateCallback _onState;
+    ConnectedCallback _onConnected;
+    PrepareCallback _onPrepare;
+
+    void setState(State state);
+    void attempt();
+    void established();
+    void scheduleRetry();
+
+public:
+    MqttConnection(MqttTransport &transport, uint32_t minBackoffMs, uint32_t maxBackoffMs,
+                   uint32_t connectTimeoutMs = 15000, uint32_t stableMs = 30000);
+
+    // 设置连接参数（指针需在连接期间保持有效）
+    void setCredentials(const char *clientId, const char *username, const char *password);
+
+    void onStateChange(StateCallback callback) { _onState = callback; }
+    void onConnected(ConnectedCallback callback) { _onConnected = callback; }
+    void onPrepare(PrepareCallback callback) { _onPrepare = callback; }
+
+    // 在loop()中调用，networkUp为WiFi是否可用
+    void loop(bool networkUp);
+
+    // 网络刚恢复时调用，跳过当前退避立即重试
+    void retryNow();
+
+    bool connected() const { return _state == CONN_CONNECTED; }
+    State state() const { return _state; }
+    uint16_t failures() const { return _failures; }
+    int lastError() const { return _lastError; }
+    uint32_t backoffMs() const { return _backoffMs; }
+};
+
+#endif // MQTT_CONNECTION_H
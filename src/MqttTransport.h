@@ -0,0 +1,55 @@
+#ifndef MQTT_TRANSPORT_H
+#define MQTT_TRANSPORT_H
+
+#include <Arduino.h>
+
+// MQTT传输层接口
+// 上层（连接状态机、上报、回调）只依赖这个接口，可以选择同步的PubSubClient后端
+// 或在独立任务中运行的esp-mqtt异步后端。收到的消息总是在loop()中通过回调派发，
+// 主题和回调参数与PubSubClient保持一致。
+class MqttTransport {
+public:
+    // 收到消息回调（在调用loop()的任务中执行）
+    typedef void (*MessageCallback)(char *topic, byte *payload, unsigned int length);
+
+    // 连接请求结果
+    enum ConnectResult {
+        TRANSPORT_CONNECT_OK,       // 已连接
+        TRANSPORT_CONNECT_PENDING,  // 已发起，结果稍后通过connected()/connecting()获得
+        TRANSPORT_CONNECT_FAILED    // 连接失败
+    };
+
+    virtual ~MqttTransport() {}
+
+    // 设置服务器和消息回调
+    virtual void begin(const char *host, uint16_t port, MessageCallback callback) = 0;
+
+    // 更换服务器（下次connect()生效）；ip不为0时直接按IP连接，省掉连接时的DNS查询，
+    // host仍用于TLS的SNI和证书校验
+    virtual void setServer(const char *host, const IPAddress &ip, uint16_t port) = 0;
+
+    // 发起连接
+    virtual ConnectResult connect(const char *clientId, const char *username, const char *password) = 0;
+
+    // 连接状态
+    virtual bool connected() = 0;
+    virtual bool connecting() = 0;
+    virtual void disconnect() = 0;
+
+    // 在loop()中调用，处理协议并派发收到的消息
+    virtual void loop() = 0;
+
+    // 发布消息；异步后端只是放入发送队列，不等待网络
+    virtual bool publish(const char *topic, const uint8_t *payload, size_t length, uint8_t qos = 0) = 0;
+    bool publish(const char *topic, const char *payload, uint8_t qos = 0) {
+        return publish(topic, (const uint8_t *)payload, strlen(payload), qos);
+    }
+
+    // 订阅主题
+    virtual bool subscribe(const char *topic, uint8_t qos = 0) = 0;
+
+    // 最近一次错误码（PubSubClient::state()语义）
+    virtual int state() = 0;
+};
+
+#endif // MQTT_TRANSPORT_H
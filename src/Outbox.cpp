@@ -0,0 +1,279 @@
+#include "Outbox.h"
+#include <LittleFS.h>
+
+// 记录格式（内存和闪存相同）：魔数 主题长度 内容长度（各2字节，小端） 主题 内容
+#define OUTBOX_MAGIC        0x5AA5
+#define OUTBOX_HEADER_SIZE  6
+// 取出缓冲：写闪存时放整条记录（头+主题+内容），补发时放主题+'\0'+内容
+#define OUTBOX_SCRATCH_SIZE (Outbox::MAX_RECORD + OUTBOX_HEADER_SIZE)
+
+const size_t Outbox::MAX_RECORD;
+
+// 构造函数
+Outbox::Outbox(size_t ramBytes, size_t segmentBytes, size_t maxFlashBytes,
+               uint32_t spillAgeMs, uint32_t drainIntervalMs, const char *dir)
+    : _ring(nullptr), _ringSize(ramBytes), _ringHead(0), _ringUsed(0), _oldestAt(0),
+      _dir(dir), _segmentBytes(segmentBytes), _maxFlashBytes(maxFlashBytes), _flashBytes(0),
+      _headSeq(0), _tailSeq(0), _hasSegments(false), _fsReady(false),
+      _scratch(nullptr), _spillAgeMs(spillAgeMs), _drainIntervalMs(drainIntervalMs), _lastDrain(0),
+      _dropped(0) {
+}
+
+// 分配缓冲，扫描上次留下的分段
+bool Outbox::begin() {
+#ifdef BOARD_HAS_PSRAM
+    _ring = (uint8_t *)ps_malloc(_ringSize);
+    _scratch = (uint8_t *)ps_malloc(OUTBOX_SCRATCH_SIZE);
+#endif
+    // 没有PSRAM时退回内部RAM
+    if (_ring == nullptr) _ring = (uint8_t *)malloc(_ringSize);
+    if (_scratch == nullptr) _scratch = (uint8_t *)malloc(OUTBOX_SCRATCH_SIZE);
+    if (_ring == nullptr || _scratch == nullptr) {
+        return false;
+    }
+
+    if (!LittleFS.exists(_dir)) {
+        LittleFS.mkdir(_dir);
+    }
+    File dir = LittleFS.open(_dir);
+    if (!dir || !dir.isDirectory()) {
+        return true; // 只用内存，断电会丢
+    }
+    _fsReady = true;
+
+    // 分段文件名是十六进制编号，最小的最旧
+    File entry = dir.openNextFile();
+    while (entry) {
+        const char *name = entry.name();
+        const char *slash = strrchr(name, '/');
+        uint32_t seq = strtoul(slash ? slash + 1 : name, nullptr, 16);
+        if (!_hasSegments || seq < _headSeq) _headSeq = seq;
+        if (!_hasSegments || seq > _tailSeq) _tailSeq = seq;
+        _hasSegments = true;
+        _flashBytes += entry.size();
+        entry = dir.openNextFile();
+    }
+    return true;
+}
+
+void Outbox::segmentPath(uint32_t seq, char *path, size_t size) const {
+    snprintf(path, size, "%s/%08lx.log", _dir, (unsigned long)seq);
+}
+
+//----------------------------------------
+// 内存环形缓冲
+//----------------------------------------
+void Outbox::ringRead(size_t offset, uint8_t *dst, size_t len) const {
+    size_t pos = (_ringHead + offset) % _ringSize;
+    size_t first = _ringSize - pos;
+    if (first > len) first = len;
+    memcpy(dst, _ring + pos, first);
+    memcpy(dst + first, _ring, len - first);
+}
+
+void Outbox::ringWrite(size_t offset, const uint8_t *src, size_t len) {
+    size_t pos = (_ringHead + offset) % _ringSize;
+    size_t first = _ringSize - pos;
+    if (first > len) first = len;
+    memcpy(_ring + pos, src, first);
+    memcpy(_ring, src + first, len - first);
+}
+
+// 读最旧记录的长度，调用者持有锁
+bool Outbox::ringPeek(size_t &topicLen, size_t &payloadLen) const {
+    if (_ringUsed < OUTBOX_HEADER_SIZE) return false;
+    uint8_t header[OUTBOX_HEADER_SIZE];
+    ringRead(0, header, sizeof(header));
+    topicLen = header[2] | (header[3] << 8);
+    payloadLen = header[4] | (header[5] << 8);
+    return true;
+}
+
+// 丢掉最旧记录，调用者持有锁
+void Outbox::ringDrop(size_t topicLen, size_t payloadLen) {
+    size_t len = OUTBOX_HEADER_SIZE + topicLen + payloadLen;
+    _ringHead = (_ringHead + len) % _ringSize;
+    _ringUsed -= len;
+    _oldestAt = millis();
+}
+
+// 暂存一条报文
+bool Outbox::push(const char *topic, const uint8_t *payload, size_t length) {
+    size_t topicLen = strlen(topic);
+    size_t total = OUTBOX_HEADER_SIZE + topicLen + length;
+    if (_ring == nullptr || topicLen + length > MAX_RECORD) return false;
+
+    bool ok = false;
+    if (_ringUsed + total <= _ringSize) {
+        uint8_t header[OUTBOX_HEADER_SIZE] = {
+            (uint8_t)(OUTBOX_MAGIC & 0xFF), (uint8_t)(OUTBOX_MAGIC >> 8),
+            (uint8_t)(topicLen & 0xFF), (uint8_t)(topicLen >> 8),
+            (uint8_t)(length & 0xFF), (uint8_t)(length >> 8)
+        };
+        if (_ringUsed == 0) _oldestAt = millis();
+        ringWrite(_ringUsed, header, sizeof(header));
+        ringWrite(_ringUsed + OUTBOX_HEADER_SIZE, (const uint8_t *)topic, topicLen);
+        ringWrite(_ringUsed + OUTBOX_HEADER_SIZE + topicLen, payload, length);
+        _ringUsed += total;
+        ok = true;
+    } else {
+        _dropped++;
+    }
+    return ok;
+}
+
+//----------------------------------------
+// 闪存分段
+//----------------------------------------
+// 把内存中的记录全部追加到最新分段
+bool Outbox::spill() {
+    if (!_fsReady) return false;
+
+    // 最新分段写满或正在被补发时，开一个新分段
+    char path[32];
+    if (_hasSegments) {
+        segmentPath(_tailSeq, path, sizeof(path));
+        File tail = LittleFS.open(path, "r");
+        bool rollover = !tail || tail.size() >= _segmentBytes || (_reader && _headSeq == _tailSeq);
+        if (tail) tail.close();
+        if (rollover) {
+            _tailSeq++;
+            segmentPath(_tailSeq, path, sizeof(path));
+        }
+    } else {
+        _headSeq = _tailSeq = _tailSeq + 1;
+        segmentPath(_tailSeq, path, sizeof(path));
+    }
+
+    File out = LittleFS.open(path, "a");
+    if (!out) return false;
+    _hasSegments = true;
+
+    bool ok = true;
+    size_t topicLen, payloadLen;
+    while (ringPeek(topicLen, payloadLen)) {
+        size_t len = OUTBOX_HEADER_SIZE + topicLen + payloadLen;
+        ringRead(0, _scratch, len);
+        if (out.write(_scratch, len) != len) {
+            ok = false; // 闪存写满，剩下的留在内存
+            break;
+        }
+        _flashBytes += len;
+        ringDrop(topicLen, payloadLen);
+    }
+    out.close();
+
+    trimFlash();
+    return ok;
+}
+
+// 超过闪存上限时丢弃最旧的分段（保留最新的）
+void Outbox::trimFlash() {
+    char path[32];
+    while (_hasSegments && _flashBytes > _maxFlashBytes && _headSeq < _tailSeq) {
+        if (_reader) _reader.close();
+        segmentPath(_headSeq, path, sizeof(path));
+        File f = LittleFS.open(path, "r");
+        size_t size = f ? f.size() : 0;
+        if (f) f.close();
+        LittleFS.remove(path);
+        _flashBytes = _flashBytes > size ? _flashBytes - size : 0;
+        _headSeq++;
+        _dropped++;
+    }
+}
+
+// 从最旧分段补发一条，返回false表示发送失败
+bool Outbox::drainFlash(Sender send) {
+    char path[32];
+    segmentPath(_headSeq, path, sizeof(path));
+
+    if (!_reader) {
+        _reader = LittleFS.open(path, "r");
+    }
+
+    uint8_t header[OUTBOX_HEADER_SIZE];
+    size_t start = _reader ? _reader.position() : 0;
+    size_t topicLen = 0, payloadLen = 0;
+    bool valid = _reader && _reader.read(header, sizeof(header)) == sizeof(header);
+    if (valid) {
+        topicLen = header[2] | (header[3] << 8);
+        payloadLen = header[4] | (header[5] << 8);
+        valid = (header[0] | (header[1] << 8)) == OUTBOX_MAGIC &&
+                topicLen + payloadLen <= MAX_RECORD &&
+                _reader.read(_scratch, topicLen) == topicLen &&
+                _reader.read(_scratch + topicLen + 1, payloadLen) == payloadLen;
+    }
+
+    if (!valid) {
+        // 分段读完（或断电时写了半条），删除后转到下一个分段
+        size_t size = _reader ? _reader.size() : 0;
+        if (_reader) _reader.close();
+        LittleFS.remove(path);
+        _flashBytes = _flashBytes > size ? _flashBytes - size : 0;
+        if (_headSeq == _tailSeq) {
+            _hasSegments = false;
+        } else {
+            _headSeq++;
+        }
+        return true;
+    }
+
+    _scratch[topicLen] = '\0';
+    if (!send((const char *)_scratch, _scratch + topicLen + 1, payloadLen)) {
+        _reader.seek(start); // 下次重发这一条
+        return false;
+    }
+    return true;
+}
+
+// 从内存补发一条
+bool Outbox::drainRing(Sender send) {
+    size_t topicLen, payloadLen;
+    bool has = ringPeek(topicLen, payloadLen);
+    if (has) {
+        ringRead(OUTBOX_HEADER_SIZE, _scratch, topicLen);
+        ringRead(OUTBOX_HEADER_SIZE + topicLen, _scratch + topicLen + 1, payloadLen);
+    }
+    if (!has) return true;
+
+    _scratch[topicLen] = '\0';
+    if (!send((const char *)_scratch, _scratch + topicLen + 1, payloadLen)) {
+        return false;
+    }
+
+    ringDrop(topicLen, payloadLen);
+    return true;
+}
+
+//----------------------------------------
+// 主循环
+//----------------------------------------
+void Outbox::service(bool online, unsigned long now, Sender send) {
+    if (_ring == nullptr) return;
+
+    // 内存用到一半，或断网时最旧的记录已经放了spillAgeMs，写入闪存
+    size_t used = _ringUsed;
+    unsigned long oldestAt = _oldestAt;
+    if (used > 0 && (used >= _ringSize / 2 || (!online && now - oldestAt >= _spillAgeMs))) {
+        spill();
+    }
+
+    if (!online || now - _lastDrain < _drainIntervalMs) return;
+    _lastDrain = now;
+
+    // 闪存里的比内存里的旧，先发闪存
+    if (_hasSegments) {
+        drainFlash(send);
+    } else {
+        drainRing(send);
+    }
+}
+
+bool Outbox::empty() {
+    return !_hasSegments && ramBytes() == 0;
+}
+
+size_t Outbox::ramBytes() {
+    return _ringUsed;
+}
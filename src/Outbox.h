@@ -0,0 +1,76 @@
+#ifndef OUTBOX_H
+#define OUTBOX_H
+
+#include <Arduino.h>
+#include <FS.h>
+
+// 断网暂存队列（store-and-forward）
+// 发不出去的报文先放进PSRAM环形缓冲；缓冲用到一半或最早一条放了太久时，
+// 整体追加到LittleFS上的分段文件里，重启后仍在。恢复连接后按从旧到新的顺序限速补发：
+// 先发闪存里的，再发内存里的。
+// push()只拷贝到内存，service()负责写闪存和补发。只在loop任务中使用。
+// 补发是“至少一次”：重启时正在补发的分段会从头再发一遍，history.post带时间戳，重复无害。
+class Outbox {
+public:
+    // 补发回调，返回true表示已交给MQTT
+    typedef bool (*Sender)(const char *topic, const uint8_t *payload, size_t length);
+
+    static const size_t MAX_RECORD = 4096;        // 单条报文（主题+内容）上限
+
+private:
+    // 内存环形缓冲
+    uint8_t *_ring;
+    size_t _ringSize;
+    size_t _ringHead;           // 最旧记录的位置
+    size_t _ringUsed;
+    unsigned long _oldestAt;    // 内存中最旧记录的加入时间
+
+    // 闪存分段文件
+    const char *_dir;
+    size_t _segmentBytes;       // 单个分段文件的大小上限
+    size_t _maxFlashBytes;      // 闪存占用上限，超过时丢弃最旧的分段
+    size_t _flashBytes;
+    uint32_t _headSeq;          // 最旧分段编号
+    uint32_t _tailSeq;          // 最新分段编号
+    bool _hasSegments;
+    File _reader;               // 正在补发的分段
+    bool _fsReady;
+
+    // 补发
+    uint8_t *_scratch;          // 取出一条记录用的连续缓冲
+    uint32_t _spillAgeMs;
+    uint32_t _drainIntervalMs;
+    unsigned long _lastDrain;
+
+    uint32_t _dropped;          // 因空间不足丢弃的记录（分段）数
+
+    void segmentPath(uint32_t seq, char *path, size_t size) const;
+    void ringRead(size_t offset, uint8_t *dst, size_t len) const;
+    void ringWrite(size_t offset, const uint8_t *src, size_t len);
+    bool ringPeek(size_t &topicLen, size_t &payloadLen) const;
+    void ringDrop(size_t topicLen, size_t payloadLen);
+    bool spill();
+    void trimFlash();
+    bool drainFlash(Sender send);
+    bool drainRing(Sender send);
+
+public:
+    Outbox(size_t ramBytes, size_t segmentBytes, size_t maxFlashBytes,
+           uint32_t spillAgeMs, uint32_t drainIntervalMs, const char *dir = "/outbox");
+
+    // 分配缓冲并扫描闪存中上次留下的分段，需在LittleFS挂载后调用
+    bool begin();
+
+    // 暂存一条报文（只写内存）
+    bool push(const char *topic, const uint8_t *payload, size_t length);
+
+    // 在loop()中调用：需要时写入闪存；online时按间隔补发一条
+    void service(bool online, unsigned long now, Sender send);
+
+    bool empty();
+    size_t ramBytes();
+    size_t flashBytes() const { return _flashBytes; }
+    uint32_t dropped() const { return _dropped; }
+};
+
+#endif // OUTBOX_H
@@ -0,0 +1,235 @@
+#include "PropertyCodec.h"
+#include <math.h>
+
+//----------------------------------------
+// JsonOut
+//----------------------------------------
+JsonOut::JsonOut(char *buf, size_t size) : _buf(buf), _size(buf ? size : 0), _len(0) {
+    if (_size > 0) _buf[0] = '\0';
+}
+
+// 写一个字符，保持'\0'结尾
+void JsonOut::raw(char c) {
+    if (_len + 1 < _size) {
+        _buf[_len] = c;
+        _buf[_len + 1] = '\0';
+    }
+    _len++;
+}
+
+void JsonOut::raw(const char *s) {
+    while (*s) raw(*s++);
+}
+
+void JsonOut::str(const char *s) {
+    raw('"');
+    while (*s) {
+        if (*s == '"' || *s == '\\') raw('\\');
+        raw(*s++);
+    }
+    raw('"');
+}
+
+void JsonOut::uinteger(uint32_t value) {
+    uinteger64(value);
+}
+
+void JsonOut::uinteger64(uint64_t value) {
+    char digits[20];
+    uint8_t n = 0;
+    do {
+        digits[n++] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    while (n) raw(digits[--n]);
+}
+
+void JsonOut::integer(int32_t value) {
+    if (value < 0) {
+        raw('-');
+        uinteger((uint32_t)0 - (uint32_t)value);
+    } else {
+        uinteger((uint32_t)value);
+    }
+}
+
+// 定点输出：先按精度放大取整，再拆成整数和小数部分，全程整数运算
+void JsonOut::fixed(float value, uint8_t precision) {
+    static const uint32_t SCALE[] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+    if (precision > 6) precision = 6;
+
+    float scaled = value * SCALE[precision];
+    bool negative = scaled < 0;
+    uint64_t units = (uint64_t)((negative ? -scaled : scaled) + 0.5f);
+    uint64_t whole = units / SCALE[precision];
+    uint32_t frac = (uint32_t)(units % SCALE[precision]);
+
+    if (negative && units != 0) raw('-');
+
+    char digits[20];
+    uint8_t n = 0;
+    do {
+        digits[n++] = '0' + whole % 10;
+        whole /= 10;
+    } while (whole);
+    while (n) raw(digits[--n]);
+
+    if (precision > 0) {
+        raw('.');
+        for (uint32_t div = SCALE[precision] / 10; div > 0; div /= 10) {
+            raw('0' + (frac / div) % 10);
+        }
+    }
+}
+
+//----------------------------------------
+// PropertyCodec
+//----------------------------------------
+// 判断属性值能否输出（先判断再写键名，避免留下半个键值对）
+static bool valueValid(const PropertyDesc &desc, const uint8_t *field) {
+    if (desc.type != PROP_FLOAT) return true;
+    // 超出定点范围或读取失败的值不上报
+    float value = *(const float *)field;
+    return isfinite(value) && fabsf(value) <= 1e12f;
+}
+
+// 写一个属性值
+static void writeValue(JsonOut &out, const PropertyDesc &desc, const uint8_t *field) {
+    switch (desc.type) {
+        case PROP_FLOAT:
+            out.fixed(*(const float *)field, desc.precision);
+            break;
+        case PROP_INT:
+            out.integer(*(const int32_t *)field);
+            break;
+        case PROP_BOOL:
+            out.raw(*(const bool *)field ? '1' : '0');
+            break;
+    }
+}
+
+void PropertyCodec::writeParams(JsonOut &out, const PropertyFrame &frame, PropertyMask mask) {
+    const uint8_t *base = (const uint8_t *)&frame;
+    bool first = true;
+
+    out.raw('{');
+    for (size_t i = 0; i < THING_PROPERTY_COUNT; i++) {
+        if (!(mask & (1UL << i))) continue;
+
+        const PropertyDesc &desc = THING_PROPERTIES[i];
+        const uint8_t *field = base + desc.offset;
+        if (!valueValid(desc, field)) continue;
+
+        if (!first) out.raw(',');
+        first = false;
+        out.str(desc.name);
+        out.raw(':');
+        writeValue(out, desc, field);
+    }
+    out.raw('}');
+}
+
+void PropertyCodec::writeTimedParams(JsonOut &out, const PropertyFrame &frame, PropertyMask mask, uint64_t timeMs) {
+    const uint8_t *base = (const uint8_t *)&frame;
+    bool first = true;
+
+    out.raw('{');
+    for (size_t i = 0; i < THING_PROPERTY_COUNT; i++) {
+        if (!(mask & (1UL << i))) continue;
+
+        const PropertyDesc &desc = THING_PROPERTIES[i];
+        const uint8_t *field = base + desc.offset;
+        if (!valueValid(desc, field)) continue;
+
+        if (!first) out.raw(',');
+        first = false;
+        out.str(desc.name);
+        out.raw(":{\"value\":");
+        writeValue(out, desc, field);
+        out.raw(",\"time\":");
+        out.uinteger64(timeMs);
+        out.raw('}');
+    }
+    out.raw('}');
+}
+
+size_t PropertyCodec::writePost(char *buf, size_t size, uint32_t id, const PropertyFrame &frame,
+                                PropertyMask mask, const char *method) {
+    JsonOut out(buf, size);
+    out.raw("{\"id\":\"");
+    out.uinteger(id);
+    out.raw("\",\"version\":\"1.0\",\"method\":");
+    out.str(method);
+    out.raw(",\"params\":");
+    writeParams(out, frame, mask);
+    out.raw('}');
+    return out.length();
+}
+
+//----------------------------------------
+// 透传二进制帧
+//----------------------------------------
+const uint8_t PropertyCodec::RAW_FRAME_POST;
+const uint8_t PropertyCodec::RAW_FRAME_POST_REPLY;
+const size_t PropertyCodec::RAW_HEADER_SIZE;
+
+static void putU32(uint8_t *p, uint32_t value) {
+    p[0] = value >> 24;
+    p[1] = value >> 16;
+    p[2] = value >> 8;
+    p[3] = value;
+}
+
+static const float RAW_SCALE[] = {1.0f, 10.0f, 100.0f, 1000.0f, 10000.0f, 100000.0f, 1000000.0f};
+
+size_t PropertyCodec::writeRawPost(uint8_t *buf, size_t size, uint32_t id, const PropertyFrame &frame,
+                                   PropertyMask mask) {
+    const uint8_t *base = (const uint8_t *)&frame;
+    uint8_t *values = buf + RAW_HEADER_SIZE;
+    size_t room = size > RAW_HEADER_SIZE ? size - RAW_HEADER_SIZE : 0;
+    size_t len = 0;
+
+    for (size_t i = 0; i < THING_PROPERTY_COUNT; i++) {
+        if (!(mask & (1UL << i))) continue;
+
+        const PropertyDesc &desc = THING_PROPERTIES[i];
+        const uint8_t *field = base + desc.offset;
+
+        if (desc.type == PROP_BOOL) {
+            if (len + 1 <= room) values[len] = *(const bool *)field ? 1 : 0;
+            len += 1;
+            continue;
+        }
+
+        int32_t value;
+        if (desc.type == PROP_FLOAT) {
+            // 不能表示为int32定点数的值和NaN一样不上报
+            float scaled = *(const float *)field * RAW_SCALE[desc.precision <= 6 ? desc.precision : 6];
+            if (!isfinite(scaled) || fabsf(scaled) >= 2147483520.0f) {
+                mask &= ~(1UL << i);
+                continue;
+            }
+            value = (int32_t)lroundf(scaled);
+        } else {
+            value = *(const int32_t *)field;
+        }
+        if (len + 4 <= room) putU32(values + len, (uint32_t)value);
+        len += 4;
+    }
+
+    // 头部最后写，mask中已去掉没有输出的属性
+    if (size >= RAW_HEADER_SIZE) {
+        buf[0] = RAW_FRAME_POST;
+        putU32(buf + 1, id);
+        buf[5] = THING_PROPERTY_COUNT;
+        putU32(buf + 6, mask);
+    }
+    return RAW_HEADER_SIZE + len;
+}
+
+bool PropertyCodec::parseRawReply(const uint8_t *buf, size_t length, uint32_t &id, int &code) {
+    if (length < 7 || buf[0] != RAW_FRAME_POST_REPLY) return false;
+    id = ((uint32_t)buf[1] << 24) | ((uint32_t)buf[2] << 16) | ((uint32_t)buf[3] << 8) | buf[4];
+    code = (buf[5] << 8) | buf[6];
+    return true;
+}
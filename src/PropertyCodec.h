@@ -0,0 +1,64 @@
+#ifndef PROPERTY_CODEC_H
+#define PROPERTY_CODEC_H
+
+#include <Arduino.h>
+#include "ThingModel.h"
+
+// 写入调用者提供缓冲区的JSON输出器
+// 不分配内存，不使用printf。缓冲区写满后继续计数但不再写入，
+// 因此length()始终是完整输出需要的长度（不含结尾'\0'），可先传nullptr量出所需大小。
+class JsonOut {
+private:
+    char *_buf;
+    size_t _size;
+    size_t _len;
+
+public:
+    JsonOut(char *buf, size_t size);
+
+    void raw(char c);
+    void raw(const char *s);
+    void str(const char *s);                     // 带引号的字符串，转义"和反斜杠
+    void uinteger(uint32_t value);
+    void integer(int32_t value);
+    void uinteger64(uint64_t value);             // 毫秒时间戳
+    void fixed(float value, uint8_t precision);  // 定点小数，四舍五入，precision最大6
+
+    size_t length() const { return _len; }
+    bool fits() const { return _len < _size; }   // 包括结尾'\0'
+};
+
+// 属性上报编码器
+// 按THING_PROPERTIES表一次写出Alink外层报文和params，mask选择要输出的属性。
+// 非有限值（传感器读取失败时的NaN）不输出，避免生成非法JSON。
+class PropertyCodec {
+public:
+    // 只写params对象
+    static void writeParams(JsonOut &out, const PropertyFrame &frame, PropertyMask mask = PROPERTY_MASK_ALL);
+
+    // 写带时间戳的属性对象 {"name":{"value":v,"time":ms},...}，用于历史上报
+    static void writeTimedParams(JsonOut &out, const PropertyFrame &frame, PropertyMask mask, uint64_t timeMs);
+
+    // 写完整的属性上报报文，返回需要的长度（不含'\0'），返回值>=size表示缓冲区不够
+    static size_t writePost(char *buf, size_t size, uint32_t id, const PropertyFrame &frame,
+                            PropertyMask mask = PROPERTY_MASK_ALL,
+                            const char *method = TSL_METHOD_PROPERTY_POST);
+
+    // 透传二进制帧（thing/model/up_raw，由云端tsl/raw_parse.js解析），多字节整数均为大端：
+    //   上报 [0]=RAW_FRAME_POST [1..4]=id [5]=THING_PROPERTY_COUNT [6..9]=mask，
+    //        之后按属性表顺序写出mask中的属性：PROP_FLOAT为乘10^precision后的int32，
+    //        PROP_INT为int32，PROP_BOOL为1字节
+    //   应答 [0]=RAW_FRAME_POST_REPLY [1..4]=id [5..6]=code
+    static const uint8_t RAW_FRAME_POST = 0x01;
+    static const uint8_t RAW_FRAME_POST_REPLY = 0x02;
+    static const size_t RAW_HEADER_SIZE = 10;
+
+    // 写上报帧，返回需要的长度，返回值>size表示缓冲区不够
+    static size_t writeRawPost(uint8_t *buf, size_t size, uint32_t id, const PropertyFrame &frame,
+                               PropertyMask mask = PROPERTY_MASK_ALL);
+
+    // 解析应答帧
+    static bool parseRawReply(const uint8_t *buf, size_t length, uint32_t &id, int &code);
+};
+
+#endif // PROPERTY_CODEC_H
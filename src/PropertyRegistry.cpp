@@ -0,0 +1,124 @@
+#include "PropertyRegistry.h"
+
+const uint8_t PropertyRegistry::INDEX_SIZE;
+const uint8_t PropertyRegistry::EMPTY_SLOT;
+
+// 构造函数
+PropertyRegistry::PropertyRegistry(const SettableProperty *table, size_t count)
+    : _table(table), _count(count), _onApplied(nullptr) {
+    memset(_index, EMPTY_SLOT, sizeof(_index));
+}
+
+// FNV-1a
+uint32_t PropertyRegistry::hash(const char *name, size_t len) {
+    uint32_t h = 2166136261UL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (uint8_t)name[i];
+        h *= 16777619UL;
+    }
+    return h;
+}
+
+bool PropertyRegistry::begin() {
+    memset(_index, EMPTY_SLOT, sizeof(_index));
+    if (_count > INDEX_SIZE / 2) return false;
+
+    for (uint8_t i = 0; i < _count; i++) {
+        size_t len = strlen(_table[i].name);
+        if (find(_table[i].name, len) != nullptr) return false;
+
+        uint8_t slot = hash(_table[i].name, len) & (INDEX_SIZE - 1);
+        while (_index[slot] != EMPTY_SLOT) {
+            slot = (slot + 1) & (INDEX_SIZE - 1);
+        }
+        _index[slot] = i;
+    }
+    return true;
+}
+
+const SettableProperty *PropertyRegistry::find(const char *name, size_t len) const {
+    uint8_t slot = hash(name, len) & (INDEX_SIZE - 1);
+    while (_index[slot] != EMPTY_SLOT) {
+        const SettableProperty &prop = _table[_index[slot]];
+        if (strncmp(prop.name, name, len) == 0 && prop.name[len] == '\0') {
+            return &prop;
+        }
+        slot = (slot + 1) & (INDEX_SIZE - 1);
+    }
+    return nullptr;
+}
+
+PropertyRegistry::Result PropertyRegistry::apply(const SettableProperty &prop, JsonVariantConst value) const {
+    PropertyValue v;
+    bool clamped = false;
+
+    switch (prop.type) {
+    case PROP_BOOL:
+        // 阿里云bool类型下发0/1，也接受JSON true/false
+        if (value.is<bool>()) {
+            v.b = value.as<bool>();
+        } else if (value.is<int32_t>()) {
+            int32_t raw = value.as<int32_t>();
+            clamped = raw < 0 || raw > 1;
+            v.b = raw > 0;
+        } else {
+            return SET_INVALID;
+        }
+        break;
+
+    case PROP_INT: {
+        if (!value.is<int32_t>()) return SET_INVALID;
+        int32_t raw = value.as<int32_t>();
+        int32_t lo = (int32_t)prop.minValue;
+        int32_t hi = (int32_t)prop.maxValue;
+        v.i = raw < lo ? lo : (raw > hi ? hi : raw);
+        clamped = v.i != raw;
+        break;
+    }
+
+    case PROP_FLOAT: {
+        if (!value.is<float>()) return SET_INVALID;
+        float raw = value.as<float>();
+        if (isnan(raw)) return SET_INVALID;
+        v.f = raw < prop.minValue ? prop.minValue : (raw > prop.maxValue ? prop.maxValue : raw);
+        clamped = v.f != raw;
+        break;
+    }
+
+    default:
+        return SET_INVALID;
+    }
+
+    applyValue(prop, v);
+    return clamped ? SET_CLAMPED : SET_OK;
+}
+
+void PropertyRegistry::applyValue(const SettableProperty &prop, PropertyValue value) const {
+    prop.apply(value);
+    if (_onApplied) _onApplied(indexOf(prop), value);
+}
+
+PropertyRegistry::Summary PropertyRegistry::applyAll(JsonObjectConst params) const {
+    Summary summary = {0, 0, 0, 0};
+    for (JsonPairConst kv : params) {
+        JsonString key = kv.key();
+        const SettableProperty *prop = find(key.c_str(), key.size());
+        if (prop == nullptr) {
+            summary.unknown++;
+            continue;
+        }
+        switch (apply(*prop, kv.value())) {
+        case SET_CLAMPED:
+            summary.clamped++;
+            summary.applied++;
+            break;
+        case SET_OK:
+            summary.applied++;
+            break;
+        default:
+            summary.invalid++;
+            break;
+        }
+    }
+    return summary;
+}
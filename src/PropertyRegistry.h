@@ -0,0 +1,102 @@
+#ifndef PROPERTY_REGISTRY_H
+#define PROPERTY_REGISTRY_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "ThingModel.h"
+
+// 可设置属性的值（按PropertyType取对应成员）
+union PropertyValue {
+    float f;
+    int32_t i;
+    bool b;
+};
+
+// 可设置属性标志
+enum SettableFlags {
+    SETTABLE_COMMAND = 0x01,    // 一次性命令（如开始查寝），不参与期望值同步
+    SETTABLE_RETAINED = 0x02    // 设置后保存到NVS，重启后恢复（阈值）
+};
+
+// 可设置属性描述：类型、取值范围和设置函数
+// 收到的值先按类型校验，再限制到[minValue, maxValue]，最后交给apply()执行。
+struct SettableProperty {
+    const char *name;                   // 属性标识符
+    uint8_t type;                       // PropertyType
+    float minValue;
+    float maxValue;
+    void (*apply)(PropertyValue value);
+    uint8_t flags;                      // SettableFlags
+};
+
+// 只有物模型中读写权限为rw的属性才能放进设置表：只读属性没有type()，编译失败
+template <bool Writable> struct TslWritable;
+template <> struct TslWritable<true> {
+    static constexpr uint8_t type(uint8_t type) { return type; }
+};
+
+// 从物模型生成的常量构造设置表的一行，属性不存在或只读时编译失败
+#define TSL_SETTABLE(field, setter, flags) \
+    { tsl::field::ID, TslWritable<tsl::field::WRITABLE>::type(tsl::field::TYPE), \
+      tsl::field::MIN, tsl::field::MAX, setter, flags }
+
+// 属性设置分发表
+// 启动时按属性名建立开放寻址哈希索引，收到property/set时只遍历一遍params，
+// 每个键一次哈希加一次字符串比较即可找到对应的设置函数，与属性数量无关。
+class PropertyRegistry {
+public:
+    static const uint8_t INDEX_SIZE = 64;   // 哈希槽数，属性数不超过一半
+    static const uint8_t EMPTY_SLOT = 0xFF;
+
+    enum Result {
+        SET_OK,
+        SET_CLAMPED,    // 超出范围，已限制到边界
+        SET_UNKNOWN,    // 不是可设置属性
+        SET_INVALID     // 类型不对，未设置
+    };
+
+    // 属性设置成功后的通知（不论来自property/set、RRPC还是期望值）
+    typedef void (*AppliedHook)(size_t index, PropertyValue value);
+
+    // 一次property/set的处理结果
+    struct Summary {
+        uint8_t applied;    // 已设置（含限制到边界的）
+        uint8_t clamped;
+        uint8_t unknown;
+        uint8_t invalid;
+    };
+
+private:
+    const SettableProperty *_table;
+    uint8_t _count;
+    uint8_t _index[INDEX_SIZE];
+    AppliedHook _onApplied;
+
+    static uint32_t hash(const char *name, size_t len);
+
+public:
+    PropertyRegistry(const SettableProperty *table, size_t count);
+
+    // 建立哈希索引，属性过多或重名时返回false
+    bool begin();
+
+    // 按名字查找，找不到返回nullptr
+    const SettableProperty *find(const char *name, size_t len) const;
+
+    // 设置单个属性
+    Result apply(const SettableProperty &prop, JsonVariantConst value) const;
+
+    // 直接设置已校验的值（从NVS恢复时使用）
+    void applyValue(const SettableProperty &prop, PropertyValue value) const;
+
+    // 遍历params设置全部属性
+    Summary applyAll(JsonObjectConst params) const;
+
+    void onApplied(AppliedHook hook) { _onApplied = hook; }
+    size_t indexOf(const SettableProperty &prop) const { return &prop - _table; }
+
+    size_t count() const { return _count; }
+    const SettableProperty &at(size_t i) const { return _table[i]; }
+};
+
+#endif // PROPERTY_REGISTRY_H
@@ -0,0 +1,94 @@
+#include "PubSubTransport.h"
+
+// 连接任务的栈要放下mbedTLS握手
+#define PUBSUB_CONNECT_STACK 8192
+#define PUBSUB_CONNECT_PRIORITY 1
+
+// 构造函数
+PubSubTransport::PubSubTransport(Client &client, uint16_t bufferSize, uint16_t socketTimeout)
+    : _client(client), _bufferSize(bufferSize), _socketTimeout(socketTimeout),
+      _task(nullptr), _clientId(nullptr), _username(nullptr), _password(nullptr),
+      _connecting(false), _abort(false), _lastError(MQTT_DISCONNECTED) {
+}
+
+// 设置服务器和回调，创建连接任务
+void PubSubTransport::begin(const char *host, uint16_t port, MessageCallback callback) {
+    _client.setServer(host, port);
+    _client.setCallback(callback);
+    _client.setBufferSize(_bufferSize);
+    _client.setSocketTimeout(_socketTimeout);
+    if (!_task) {
+        xTaskCreate(connectTask, "mqtt_connect", PUBSUB_CONNECT_STACK, this, PUBSUB_CONNECT_PRIORITY, &_task);
+    }
+}
+
+// 更换服务器（MqttConnection只在没有连接任务运行时调用）
+void PubSubTransport::setServer(const char *host, const IPAddress &ip, uint16_t port) {
+    if ((uint32_t)ip != 0) {
+        _client.setServer(ip, port);
+    } else {
+        _client.setServer(host, port);
+    }
+}
+
+// 发起连接，交给连接任务完成
+MqttTransport::ConnectResult PubSubTransport::connect(const char *clientId, const char *username, const char *password) {
+    if (_connecting) return TRANSPORT_CONNECT_PENDING;
+    if (!_task) return TRANSPORT_CONNECT_FAILED;
+
+    _clientId = clientId;
+    _username = username;
+    _password = password;
+    _abort = false;
+    _lastError = MQTT_DISCONNECTED;
+    _connecting = true;
+    xTaskNotifyGive(_task);
+    return TRANSPORT_CONNECT_PENDING;
+}
+
+// 连接任务：等待connect()的通知，每次完成一次连接尝试
+void PubSubTransport::connectTask(void *arg) {
+    PubSubTransport *self = static_cast<PubSubTransport *>(arg);
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        self->runConnect();
+    }
+}
+
+// 在连接任务中进行一次连接（阻塞到有结果为止）
+void PubSubTransport::runConnect() {
+    _client.connect(_clientId, _username, _password);
+    if (_abort) {
+        _client.disconnect();
+    }
+    _lastError = _client.state();
+    _connecting = false;
+}
+
+// 断开连接；连接任务还在运行时只做标记，由任务在结束时断开
+void PubSubTransport::disconnect() {
+    if (_connecting) {
+        _abort = true;
+        return;
+    }
+    _client.disconnect();
+}
+
+// 处理协议并派发收到的消息
+void PubSubTransport::loop() {
+    if (_connecting) return;
+    _client.loop();
+}
+
+// 发布消息（PubSubClient只支持QoS0）
+bool PubSubTransport::publish(const char *topic, const uint8_t *payload, size_t length, uint8_t qos) {
+    (void)qos;
+    if (_connecting) return false;
+    return _client.publish(topic, payload, length);
+}
+
+// 订阅主题
+bool PubSubTransport::subscribe(const char *topic, uint8_t qos) {
+    if (_connecting) return false;
+    return _client.subscribe(topic, qos);
+}
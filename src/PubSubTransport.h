@@ -0,0 +1,53 @@
+#ifndef PUBSUB_TRANSPORT_H
+#define PUBSUB_TRANSPORT_H
+
+#include <Arduino.h>
+#include <PubSubClient.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "MqttTransport.h"
+
+// 基于PubSubClient的MQTT后端，只支持QoS0发布
+// 连接在独立的连接任务中进行：TCP连接、TLS握手（有证书时）和等待CONNACK都不占用调用者任务，
+// connect()发起后立即返回PENDING，结果由MqttConnection在CONNECTING状态中检查。
+// 连接任务运行期间客户端归它所有，connected()/publish()/subscribe()/loop()都直接返回，
+// 连接成功后协议收发和发布仍在调用者任务中进行。
+class PubSubTransport : public MqttTransport {
+private:
+    PubSubClient _client;
+    uint16_t _bufferSize;
+    uint16_t _socketTimeout;
+
+    TaskHandle_t _task;
+    const char *_clientId;      // 由MqttConnection保证在连接期间有效
+    const char *_username;
+    const char *_password;
+
+    volatile bool _connecting;  // 连接任务正在使用客户端
+    volatile bool _abort;       // 连接期间被要求断开，任务结束时关闭连接
+    volatile int _lastError;
+
+    static void connectTask(void *arg);
+    void runConnect();
+
+public:
+    // client为底层TCP客户端，bufferSize为收发缓冲区，socketTimeout为等待服务器应答的秒数
+    PubSubTransport(Client &client, uint16_t bufferSize, uint16_t socketTimeout);
+
+    // 更换底层客户端（例如改用TLS），不能在连接过程中调用
+    void setClient(Client &client) { _client.setClient(client); }
+
+    void begin(const char *host, uint16_t port, MessageCallback callback) override;
+    void setServer(const char *host, const IPAddress &ip, uint16_t port) override;
+    ConnectResult connect(const char *clientId, const char *username, const char *password) override;
+    bool connected() override { return !_connecting && _client.connected(); }
+    bool connecting() override { return _connecting; }
+    void disconnect() override;
+    void loop() override;
+    bool publish(const char *topic, const uint8_t *payload, size_t length, uint8_t qos = 0) override;
+    using MqttTransport::publish;
+    bool subscribe(const char *topic, uint8_t qos = 0) override;
+    int state() override { return _connecting ? _lastError : _client.state(); }
+};
+
+#endif // PUBSUB_TRANSPORT_H
@@ -0,0 +1,165 @@
+#include "PublishTracker.h"
+
+const uint8_t PublishTracker::MAX_INFLIGHT;
+const size_t PublishTracker::MAX_PAYLOAD;
+const uint8_t PublishTracker::LATENCY_BUCKETS;
+
+// 构造函数
+PublishTracker::PublishTracker(uint32_t timeoutMs, uint8_t maxRetries)
+    : _pool(nullptr), _timeoutMs(timeoutMs), _maxRetries(maxRetries) {
+    memset(_slots, 0, sizeof(_slots));
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+// 分配报文缓存
+bool PublishTracker::begin() {
+    size_t bytes = (size_t)MAX_INFLIGHT * MAX_PAYLOAD;
+#ifdef BOARD_HAS_PSRAM
+    _pool = (uint8_t *)ps_malloc(bytes);
+#endif
+    // 没有PSRAM时退回内部RAM
+    if (_pool == nullptr) _pool = (uint8_t *)malloc(bytes);
+    if (_pool == nullptr) {
+        return false;
+    }
+    for (uint8_t i = 0; i < MAX_INFLIGHT; i++) {
+        _slots[i].payload = _pool + (size_t)i * MAX_PAYLOAD;
+    }
+    return true;
+}
+
+// 时延分桶上界：50ms起每桶翻倍，最后一桶不设上界
+uint32_t PublishTracker::bucketLimitMs(uint8_t bucket) {
+    if (bucket >= LATENCY_BUCKETS - 1) return 0xFFFFFFFF;
+    return 50UL << bucket;
+}
+
+// 取Alink报文的id（我们生成的报文都以{"id":"开头，只看前面一小段）
+bool PublishTracker::parseId(const uint8_t *payload, size_t length, uint32_t &id) {
+    static const char KEY[] = "\"id\":\"";
+    const size_t keyLen = sizeof(KEY) - 1;
+    size_t limit = length < 32 ? length : 32;
+
+    for (size_t i = 0; i + keyLen < limit; i++) {
+        if (memcmp(payload + i, KEY, keyLen) != 0) continue;
+        size_t p = i + keyLen;
+        if (p >= length || payload[p] < '0' || payload[p] > '9') return false;
+        uint32_t value = 0;
+        while (p < length && payload[p] >= '0' && payload[p] <= '9') {
+            value = value * 10 + (payload[p++] - '0');
+        }
+        id = value;
+        return true;
+    }
+    return false;
+}
+
+// 记录一条已发出的报文
+bool PublishTracker::track(const char *topic, const uint8_t *payload, size_t length, unsigned long now) {
+    uint32_t id;
+    if (!parseId(payload, length, id)) return false;
+    return track(topic, payload, length, id, now);
+}
+
+bool PublishTracker::track(const char *topic, const uint8_t *payload, size_t length, uint32_t id, unsigned long now) {
+    if (_pool == nullptr || length > MAX_PAYLOAD) {
+        return false;
+    }
+
+    bool ok = false;
+    for (uint8_t i = 0; i < MAX_INFLIGHT; i++) {
+        Slot &slot = _slots[i];
+        if (slot.used) continue;
+        slot.id = id;
+        slot.topic = topic;
+        memcpy(slot.payload, payload, length);
+        slot.length = length;
+        slot.firstSentAt = now;
+        slot.sentAt = now;
+        slot.retries = 0;
+        slot.used = true;
+        _stats.tracked++;
+        ok = true;
+        break;
+    }
+    if (!ok) _stats.overflow++;
+    return ok;
+}
+
+void PublishTracker::recordLatency(uint32_t ms) {
+    uint8_t bucket = 0;
+    while (bucket < LATENCY_BUCKETS - 1 && ms >= bucketLimitMs(bucket)) bucket++;
+    _stats.histogram[bucket]++;
+    _stats.latencySumMs += ms;
+    if (ms > _stats.latencyMaxMs) _stats.latencyMaxMs = ms;
+}
+
+// 收到应答
+bool PublishTracker::acknowledge(uint32_t id, int code, unsigned long now) {
+    bool found = false;
+    for (uint8_t i = 0; i < MAX_INFLIGHT; i++) {
+        Slot &slot = _slots[i];
+        if (!slot.used || slot.id != id) continue;
+        if (code == 200) {
+            _stats.acked++;
+            recordLatency(now - slot.firstSentAt);
+        } else {
+            _stats.rejected++; // 云端拒绝（如属性不合法），重发也没用
+        }
+        slot.used = false;
+        found = true;
+        break;
+    }
+    return found;
+}
+
+// 超时重发，重发用尽后过期
+void PublishTracker::service(unsigned long now, Sender send, Sender expire) {
+    if (_pool == nullptr) return;
+
+    for (uint8_t i = 0; i < MAX_INFLIGHT; i++) {
+        Slot &slot = _slots[i];
+        if (!slot.used) continue;
+
+        // 每次重发后等待时间翻倍
+        uint32_t wait = _timeoutMs << slot.retries;
+        if (now - slot.sentAt < wait) continue;
+
+        if (slot.retries >= _maxRetries) {
+            if (expire) expire(slot.topic, slot.payload, slot.length);
+            _stats.expired++;
+            slot.used = false;
+            continue;
+        }
+
+        send(slot.topic, slot.payload, slot.length);
+        slot.retries++;
+        slot.sentAt = now;
+        _stats.retransmits++;
+    }
+}
+
+// 全部按过期处理
+void PublishTracker::expireAll(Sender expire) {
+    if (_pool == nullptr) return;
+
+    for (uint8_t i = 0; i < MAX_INFLIGHT; i++) {
+        Slot &slot = _slots[i];
+        if (!slot.used) continue;
+        if (expire) expire(slot.topic, slot.payload, slot.length);
+        _stats.expired++;
+        slot.used = false;
+    }
+}
+
+uint8_t PublishTracker::inflight() {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < MAX_INFLIGHT; i++) {
+        if (_slots[i].used) count++;
+    }
+    return count;
+}
+
+PublishTracker::Stats PublishTracker::stats() {
+    return _stats;
+}
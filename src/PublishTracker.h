@@ -0,0 +1,82 @@
+#ifndef PUBLISH_TRACKER_H
+#define PUBLISH_TRACKER_H
+
+#include <Arduino.h>
+
+// 上报确认跟踪
+// 记录已发出、还没收到post_reply的报文（按Alink报文里的id对应），
+// 超时按倍增间隔重发，重发maxRetries次仍无应答时交给expire回调（例如放入暂存队列）。
+// 应答到达时统计往返时延，按对数分桶做直方图，供设备指标上报。
+// 只在loop任务中使用。
+class PublishTracker {
+public:
+    // 发送/过期回调，topic和payload只在回调期间有效
+    typedef bool (*Sender)(const char *topic, const uint8_t *payload, size_t length);
+
+    static const uint8_t MAX_INFLIGHT = 8;
+    static const size_t MAX_PAYLOAD = 4096;
+    // 时延直方图上界（毫秒），最后一桶为超过最大上界
+    static const uint8_t LATENCY_BUCKETS = 8;
+
+    struct Stats {
+        uint32_t tracked;         // 跟踪的报文数
+        uint32_t acked;           // 收到code=200应答
+        uint32_t rejected;        // 收到非200应答
+        uint32_t retransmits;     // 重发次数
+        uint32_t expired;         // 重发用尽
+        uint32_t overflow;        // 跟踪表满未能跟踪
+        uint32_t latencySumMs;
+        uint32_t latencyMaxMs;
+        uint32_t histogram[LATENCY_BUCKETS];
+    };
+
+private:
+    struct Slot {
+        bool used;
+        uint32_t id;
+        const char *topic;        // 主题须长期有效（宏或全局字符串）
+        uint8_t *payload;
+        size_t length;
+        unsigned long firstSentAt;
+        unsigned long sentAt;
+        uint8_t retries;
+    };
+
+    Slot _slots[MAX_INFLIGHT];
+    uint8_t *_pool;
+    uint32_t _timeoutMs;
+    uint8_t _maxRetries;
+    Stats _stats;
+
+    void recordLatency(uint32_t ms);
+
+public:
+    PublishTracker(uint32_t timeoutMs, uint8_t maxRetries);
+
+    // 分配报文缓存（PSRAM）
+    bool begin();
+
+    // 从Alink报文开头的"id":"..."取出id，找不到返回false
+    static bool parseId(const uint8_t *payload, size_t length, uint32_t &id);
+
+    // 报文发出后调用，返回false表示没有跟踪（表满或报文无id）
+    bool track(const char *topic, const uint8_t *payload, size_t length, unsigned long now);
+
+    // 同上，id由调用者给出（二进制报文）
+    bool track(const char *topic, const uint8_t *payload, size_t length, uint32_t id, unsigned long now);
+
+    // 收到post_reply时调用，返回true表示匹配到了
+    bool acknowledge(uint32_t id, int code, unsigned long now);
+
+    // 在loop()中调用，处理超时重发和过期
+    void service(unsigned long now, Sender send, Sender expire);
+
+    // 断线后已发出的报文不会再有应答，立即按超时处理
+    void expireAll(Sender expire);
+
+    uint8_t inflight();
+    Stats stats();
+    static uint32_t bucketLimitMs(uint8_t bucket);
+};
+
+#endif // PUBLISH_TRACKER_H
@@ -0,0 +1,78 @@
+#include "SampleBatch.h"
+#include "PropertyCodec.h"
+
+const uint8_t SampleBatch::MAX_SAMPLES;
+
+#define SAMPLE_BATCH_MAGIC 0x53424154  // "SBAT"
+
+// 构造函数
+SampleBatch::SampleBatch(uint8_t maxSamples, uint32_t maxAgeMs)
+    : _count(0), _maxSamples(maxSamples > MAX_SAMPLES ? MAX_SAMPLES : maxSamples),
+      _maxAgeMs(maxAgeMs), _firstAt(0) {
+}
+
+// 加入一条样本
+bool SampleBatch::add(uint64_t uptimeMs, const PropertyFrame &frame, PropertyMask mask, unsigned long now) {
+    if (full()) return false;
+    if (_count == 0) _firstAt = now;
+
+    Sample &sample = _samples[_count++];
+    sample.uptimeMs = uptimeMs;
+    sample.mask = mask;
+    sample.frame = frame;
+    return true;
+}
+
+// 条数或等待时间达到上限
+bool SampleBatch::due(unsigned long now) const {
+    if (_count == 0) return false;
+    return full() || now - _firstAt >= _maxAgeMs;
+}
+
+// 报文格式：
+// {"id":"1","version":"1.0","method":"thing.event.property.history.post",
+//  "params":[{"identity":{"productKey":"..","deviceName":".."},
+//             "properties":[{"temperature":{"value":26.4,"time":1700000000000},...},...]}]}
+size_t SampleBatch::write(char *buf, size_t size, uint32_t id, const char *productKey, const char *deviceName,
+                          int64_t offsetMs) const {
+    JsonOut out(buf, size);
+    out.raw("{\"id\":\"");
+    out.uinteger(id);
+    out.raw("\",\"version\":\"1.0\",\"method\":\"thing.event.property.history.post\","
+            "\"params\":[{\"identity\":{\"productKey\":");
+    out.str(productKey);
+    out.raw(",\"deviceName\":");
+    out.str(deviceName);
+    out.raw("},\"properties\":[");
+    for (uint8_t i = 0; i < _count; i++) {
+        if (i > 0) out.raw(',');
+        PropertyCodec::writeTimedParams(out, _samples[i].frame, _samples[i].mask,
+                                        (uint64_t)((int64_t)_samples[i].uptimeMs + offsetMs));
+    }
+    out.raw("]}]}");
+    return out.length();
+}
+
+// 二进制暂存：头部 + 样本数组，只在同一个固件的同一次开机内读回
+size_t SampleBatch::save(uint8_t *buf, size_t size, uint32_t bootId) const {
+    size_t length = sizeof(SavedHeader) + (size_t)_count * sizeof(Sample);
+    if (length > size) return length;
+
+    SavedHeader header = { SAMPLE_BATCH_MAGIC, bootId, _count };
+    memcpy(buf, &header, sizeof(header));
+    memcpy(buf + sizeof(header), _samples, (size_t)_count * sizeof(Sample));
+    return length;
+}
+
+// 读回暂存的样本（data可能没有对齐，逐段拷贝）
+bool SampleBatch::load(const uint8_t *data, size_t length, uint32_t bootId) {
+    SavedHeader header;
+    if (length < sizeof(header)) return false;
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != SAMPLE_BATCH_MAGIC || header.bootId != bootId) return false;
+    if (header.count > MAX_SAMPLES || length != sizeof(header) + header.count * sizeof(Sample)) return false;
+
+    memcpy(_samples, data + sizeof(header), header.count * sizeof(Sample));
+    _count = header.count;
+    return true;
+}
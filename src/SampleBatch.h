@@ -0,0 +1,61 @@
+#ifndef SAMPLE_BATCH_H
+#define SAMPLE_BATCH_H
+
+#include <Arduino.h>
+#include "ThingModel.h"
+
+// 属性样本批量上报
+// 收集带时间戳的属性样本，攒够maxSamples条或最早一条超过maxAgeMs后，
+// 合成一条thing.event.property.history.post发出，每条样本保留自己的采集时间。
+// 样本记录的是开机以来的毫秒数，写报文时再加上UTC偏移，因此时间同步之前的样本也能进批次：
+// 那时还没有偏移，用save()把样本连同开机编号原样存下，同步后在同一次开机内load()回来补上时间。
+class SampleBatch {
+public:
+    static const uint8_t MAX_SAMPLES = 30;
+
+private:
+    struct Sample {
+        uint64_t uptimeMs;      // 采集时开机以来的毫秒数
+        PropertyMask mask;      // 本条样本包含的属性
+        PropertyFrame frame;
+    };
+
+    // save()的二进制格式：头部之后是count条Sample
+    struct SavedHeader {
+        uint32_t magic;
+        uint32_t bootId;
+        uint32_t count;
+    };
+
+    Sample _samples[MAX_SAMPLES];
+    uint8_t _count;
+    uint8_t _maxSamples;
+    uint32_t _maxAgeMs;
+    unsigned long _firstAt;     // 第一条样本加入时的millis()
+
+public:
+    SampleBatch(uint8_t maxSamples, uint32_t maxAgeMs);
+
+    // 加入一条样本，uptimeMs为采集时开机以来的毫秒数，批次已满时返回false
+    bool add(uint64_t uptimeMs, const PropertyFrame &frame, PropertyMask mask, unsigned long now);
+
+    // 是否应该发送
+    bool due(unsigned long now) const;
+
+    // 写history.post报文，offsetMs为UTC毫秒时间减开机毫秒数（时间同步后才有）
+    // 返回需要的长度（不含'\0'），返回值>=size表示缓冲区不够
+    size_t write(char *buf, size_t size, uint32_t id, const char *productKey, const char *deviceName,
+                 int64_t offsetMs) const;
+
+    // 把样本原样存入buf（时间未同步时暂存用），返回需要的长度，返回值>size表示缓冲区不够
+    size_t save(uint8_t *buf, size_t size, uint32_t bootId) const;
+
+    // 读回save()的内容，替换当前批次；格式不对或不是本次开机（bootId不同）时返回false
+    bool load(const uint8_t *data, size_t length, uint32_t bootId);
+
+    void clear() { _count = 0; }
+    uint8_t count() const { return _count; }
+    bool full() const { return _count >= _maxSamples; }
+};
+
+#endif // SAMPLE_BATCH_H
@@ -0,0 +1,134 @@
+#include "SceneManager.h"
+
+// 构造函数
+SceneManager::SceneManager()
+    : _depth(0), _transitions(nullptr), _transitionCount(0), _governor(nullptr),
+      _toastRenderer(nullptr), _toastStart(0), _toastDuration(0), _toastActive(false),
+      _toastDrawn(false), _lastKey(0), _needFull(true) {
+    _toast[0] = '\0';
+}
+
+// 初始化
+void SceneManager::begin(const Scene *root, const SceneTransition *transitions, uint8_t count,
+                         DisplayGovernor *governor, void (*toastRenderer)(const char *text)) {
+    _transitions = transitions;
+    _transitionCount = count;
+    _governor = governor;
+    _toastRenderer = toastRenderer;
+    _depth = 0;
+    push(root);
+}
+
+// 进入场景
+void SceneManager::enter(const Scene *scene) {
+    if (scene && scene->onEnter) {
+        scene->onEnter();
+    }
+    _needFull = true;
+}
+
+// 离开场景
+void SceneManager::leave(const Scene *scene) {
+    if (scene && scene->onExit) {
+        scene->onExit();
+    }
+}
+
+// 替换栈顶场景
+void SceneManager::replace(const Scene *scene) {
+    if (_depth == 0) {
+        push(scene);
+        return;
+    }
+    leave(_stack[_depth - 1]);
+    _stack[_depth - 1] = scene;
+    enter(scene);
+}
+
+// 压入场景
+void SceneManager::push(const Scene *scene) {
+    if (_depth >= MAX_DEPTH) return;
+    _stack[_depth++] = scene;
+    enter(scene);
+}
+
+// 弹出场景，根场景不会被弹出
+void SceneManager::pop() {
+    if (_depth <= 1) return;
+    leave(_stack[--_depth]);
+    // 回到下层场景，内容需要整帧重绘
+    _needFull = true;
+}
+
+// 按切换表处理事件
+bool SceneManager::dispatch(uint8_t event) {
+    const Scene *top = current();
+
+    for (uint8_t i = 0; i < _transitionCount; i++) {
+        const SceneTransition &t = _transitions[i];
+        if (t.event != event) continue;
+        if (t.from != nullptr && t.from != top) continue;
+
+        switch (t.op) {
+            case SCENE_REPLACE: replace(t.to); break;
+            case SCENE_PUSH:    push(t.to);    break;
+            case SCENE_POP:     pop();         break;
+        }
+        return true;
+    }
+    return false;
+}
+
+// 显示定时提示
+void SceneManager::toast(const char *text, unsigned long durationMs) {
+    strncpy(_toast, text, TOAST_MAX_LEN - 1);
+    _toast[TOAST_MAX_LEN - 1] = '\0';
+    _toastStart = millis();
+    _toastDuration = durationMs;
+    _toastActive = true;
+    _toastDrawn = false;
+}
+
+// 按需刷新显示
+void SceneManager::update() {
+    // 定时提示优先显示，到期后恢复当前场景
+    if (_toastActive) {
+        if (millis() - _toastStart < _toastDuration) {
+            if (!_toastDrawn && _toastRenderer) {
+                if (_governor && !_governor->beginFrame(true)) return;
+                _toastRenderer(_toast);
+                _toastDrawn = true;
+                if (_governor) _governor->endFrame();
+            }
+            return;
+        }
+        _toastActive = false;
+        _needFull = true;
+    }
+
+    const Scene *scene = current();
+    if (!scene || !scene->render) return;
+
+    // 绑定状态未变化且显示内容有效时不重绘
+    uint32_t key = scene->stateKey ? scene->stateKey() : 0;
+    if (!_needFull && key == _lastKey) return;
+
+    if (_governor && !_governor->beginFrame(_needFull)) return;
+
+    scene->render(_needFull);
+    _lastKey = key;
+    _needFull = false;
+
+    if (_governor) _governor->endFrame();
+}
+
+// 立即绘制当前场景
+void SceneManager::renderNow() {
+    _toastActive = false;
+    const Scene *scene = current();
+    if (!scene || !scene->render) return;
+
+    scene->render(true);
+    _lastKey = scene->stateKey ? scene->stateKey() : 0;
+    _needFull = false;
+}
@@ -0,0 +1,97 @@
+#ifndef SCENE_MANAGER_H
+#define SCENE_MANAGER_H
+
+#include <Arduino.h>
+#include "DisplayGovernor.h"
+
+// 场景描述（声明式页面）
+// stateKey返回该页面绑定状态的摘要，摘要不变时不重绘；
+// render的full参数表示显示屏内容已失效，需要整帧绘制。
+struct Scene {
+    const char *name;
+    void (*onEnter)();              // 进入场景时调用，可为nullptr
+    void (*onExit)();               // 离开场景时调用，可为nullptr
+    uint32_t (*stateKey)();         // 绑定状态摘要
+    void (*render)(bool full);      // 绘制函数
+};
+
+// 场景切换方式
+enum SceneOp : uint8_t {
+    SCENE_REPLACE,  // 替换栈顶场景
+    SCENE_PUSH,     // 压入新场景（如查寝模式）
+    SCENE_POP       // 返回上一个场景
+};
+
+// 事件驱动的场景切换表项，from为nullptr时匹配任意场景
+struct SceneTransition {
+    const Scene *from;
+    uint8_t event;
+    SceneOp op;
+    const Scene *to;
+};
+
+// 场景栈管理器
+// 负责事件驱动的页面切换、不阻塞的定时提示（toast）以及按需重绘。
+class SceneManager {
+public:
+    static const uint8_t MAX_DEPTH = 4;         // 场景栈深度
+    static const uint8_t TOAST_MAX_LEN = 64;    // 提示文本最大长度
+
+private:
+    const Scene *_stack[MAX_DEPTH];
+    uint8_t _depth;
+    const SceneTransition *_transitions;
+    uint8_t _transitionCount;
+    DisplayGovernor *_governor;
+    void (*_toastRenderer)(const char *text);
+
+    char _toast[TOAST_MAX_LEN];
+    unsigned long _toastStart;
+    unsigned long _toastDuration;
+    bool _toastActive;
+    bool _toastDrawn;
+
+    uint32_t _lastKey;
+    bool _needFull;
+
+    void enter(const Scene *scene);
+    void leave(const Scene *scene);
+
+public:
+    SceneManager();
+
+    // 初始化：根场景、切换表、调速器（可为nullptr）和提示绘制函数
+    void begin(const Scene *root, const SceneTransition *transitions, uint8_t count,
+               DisplayGovernor *governor, void (*toastRenderer)(const char *text));
+
+    // 投递事件，按切换表切换场景，返回是否发生切换
+    bool dispatch(uint8_t event);
+
+    // 直接操作场景栈
+    void replace(const Scene *scene);
+    void push(const Scene *scene);
+    void pop();
+
+    // 显示定时提示，不阻塞调用者；'\n'分隔第二行
+    void toast(const char *text, unsigned long durationMs);
+    bool toastActive() const { return _toastActive; }
+
+    // 标记显示内容失效，下次update时强制整帧绘制
+    void invalidate() { _needFull = true; }
+
+    const Scene *current() const { return _depth ? _stack[_depth - 1] : nullptr; }
+    bool isCurrent(const Scene *scene) const { return current() == scene; }
+
+    // 在loop()中调用：处理提示超时，只在绑定状态变化时重绘
+    void update();
+
+    // 立即整帧绘制当前场景，不经过调速器，并结束正在显示的提示（用于阻塞操作前的提示）
+    void renderNow();
+
+    // 组合状态摘要的辅助函数
+    static uint32_t mix(uint32_t hash, uint32_t value) {
+        return (hash ^ value) * 16777619UL;
+    }
+};
+
+#endif // SCENE_MANAGER_H
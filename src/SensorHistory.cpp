@@ -0,0 +1,166 @@
+#include "SensorHistory.h"
+#include <float.h>
+
+// 各级分辨率配置
+static const uint32_t TIER_PERIOD_MS[SensorHistory::TIER_COUNT] = {1000UL, 60000UL};
+static const uint16_t TIER_CAPACITY[SensorHistory::TIER_COUNT] = {600, 1440};
+
+// 构造函数
+SensorHistory::SensorHistory() : _ready(false) {
+    memset(_tiers, 0, sizeof(_tiers));
+}
+
+// 分配缓冲区
+bool SensorHistory::begin() {
+    for (uint8_t t = 0; t < TIER_COUNT; t++) {
+        Ring &ring = _tiers[t];
+        size_t bytes = (size_t)TIER_CAPACITY[t] * CHANNEL_COUNT * sizeof(Bucket);
+
+#ifdef BOARD_HAS_PSRAM
+        ring.buckets = (Bucket *)ps_malloc(bytes);
+#endif
+        // 没有PSRAM时退回内部RAM
+        if (ring.buckets == nullptr) {
+            ring.buckets = (Bucket *)malloc(bytes);
+        }
+        if (ring.buckets == nullptr) {
+            return false;
+        }
+
+        ring.capacity = TIER_CAPACITY[t];
+        ring.periodMs = TIER_PERIOD_MS[t];
+        ring.head = 0;
+        ring.count = 0;
+        ring.version = 0;
+        ring.slotStart = 0;
+        for (uint8_t c = 0; c < CHANNEL_COUNT; c++) {
+            resetBucket(ring.pending[c]);
+        }
+    }
+
+    _ready = true;
+    return true;
+}
+
+// 清空桶
+void SensorHistory::resetBucket(Bucket &bucket) {
+    bucket.min = FLT_MAX;
+    bucket.max = -FLT_MAX;
+    bucket.sum = 0;
+    bucket.count = 0;
+}
+
+// 合并两个桶
+void SensorHistory::mergeBucket(Bucket &into, const Bucket &from) {
+    if (from.count == 0) return;
+    if (from.min < into.min) into.min = from.min;
+    if (from.max > into.max) into.max = from.max;
+    into.sum += from.sum;
+    into.count += from.count;
+}
+
+// 提交当前桶到环形缓冲区
+void SensorHistory::commit(Ring &ring) {
+    Bucket *slot = ring.buckets + (size_t)ring.head * CHANNEL_COUNT;
+    for (uint8_t c = 0; c < CHANNEL_COUNT; c++) {
+        slot[c] = ring.pending[c];
+        resetBucket(ring.pending[c]);
+    }
+
+    ring.head = (ring.head + 1) % ring.capacity;
+    if (ring.count < ring.capacity) ring.count++;
+    ring.version++;
+}
+
+// 追加采样
+void SensorHistory::append(unsigned long now, const float values[CHANNEL_COUNT]) {
+    if (!_ready) return;
+
+    for (uint8_t t = 0; t < TIER_COUNT; t++) {
+        Ring &ring = _tiers[t];
+
+        if (ring.version == 0 && ring.pending[0].count == 0) {
+            // 第一个采样，对齐到周期边界
+            ring.slotStart = now - (now % ring.periodMs);
+        } else if (now - ring.slotStart >= ring.periodMs) {
+            // 提交当前桶；中间没有采样的周期以空桶补齐，保持时间轴连续
+            uint32_t elapsed = (now - ring.slotStart) / ring.periodMs;
+            commit(ring);
+            for (uint32_t gap = 1; gap < elapsed && gap <= ring.capacity; gap++) {
+                commit(ring);
+            }
+            ring.slotStart += elapsed * ring.periodMs;
+        }
+
+        for (uint8_t c = 0; c < CHANNEL_COUNT; c++) {
+            Bucket &bucket = ring.pending[c];
+            float v = values[c];
+            if (v < bucket.min) bucket.min = v;
+            if (v > bucket.max) bucket.max = v;
+            bucket.sum += v;
+            bucket.count++;
+        }
+    }
+}
+
+// 按时间倒序取桶（age=0为最新）
+const SensorHistory::Bucket *SensorHistory::at(const Ring &ring, uint16_t age) const {
+    if (age >= ring.count) return nullptr;
+    uint16_t index = (ring.head + ring.capacity - 1 - age) % ring.capacity;
+    return ring.buckets + (size_t)index * CHANNEL_COUNT;
+}
+
+// 最近span个桶的统计
+SensorHistory::Summary SensorHistory::summarize(Tier tier, Channel channel, uint16_t span) const {
+    Summary summary = {0, 0, 0, false};
+    if (!_ready) return summary;
+
+    const Ring &ring = _tiers[tier];
+    Bucket total;
+    resetBucket(total);
+
+    if (span > ring.count) span = ring.count;
+    for (uint16_t age = 0; age < span; age++) {
+        mergeBucket(total, at(ring, age)[channel]);
+    }
+
+    if (total.count > 0) {
+        summary.min = total.min;
+        summary.max = total.max;
+        summary.avg = total.sum / total.count;
+        summary.valid = true;
+    }
+    return summary;
+}
+
+// 折叠成曲线列
+uint8_t SensorHistory::columns(Tier tier, Channel channel, uint16_t span, Summary out[], uint8_t n) const {
+    if (!_ready || n == 0) return 0;
+
+    const Ring &ring = _tiers[tier];
+    if (span > ring.capacity) span = ring.capacity;
+
+    // 每列覆盖的桶区间按整个窗口等分，数据不足时右对齐（最新数据在最右侧）
+    for (uint8_t col = 0; col < n; col++) {
+        uint16_t first = (uint32_t)col * span / n;
+        uint16_t last = (uint32_t)(col + 1) * span / n;
+        if (last == first) last = first + 1;
+
+        Bucket total;
+        resetBucket(total);
+        for (uint16_t i = first; i < last; i++) {
+            // 换算成从最新开始的age
+            uint16_t age = span - 1 - i;
+            const Bucket *slot = at(ring, age);
+            if (slot) mergeBucket(total, slot[channel]);
+        }
+
+        out[col].valid = total.count > 0;
+        if (out[col].valid) {
+            out[col].min = total.min;
+            out[col].max = total.max;
+            out[col].avg = total.sum / total.count;
+        }
+    }
+    return n;
+}
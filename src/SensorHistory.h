@@ -0,0 +1,88 @@
+#ifndef SENSOR_HISTORY_H
+#define SENSOR_HISTORY_H
+
+#include <Arduino.h>
+
+// 多分辨率传感器历史数据（存放在PSRAM中）
+// 每一级是一个固定周期的环形缓冲区，每个桶保存该周期内的最小值、最大值和累加和，
+// 追加采样为O(1)；曲线页面直接读取这些汇总桶，不需要保存和扫描原始采样。
+class SensorHistory {
+public:
+    // 数据通道
+    enum Channel {
+        CH_TEMPERATURE,
+        CH_HUMIDITY,
+        CH_LUX,
+        CH_FLAME,
+        CH_SMOKE,
+        CH_NOISE,
+        CHANNEL_COUNT
+    };
+
+    // 分辨率等级
+    enum Tier {
+        TIER_SECOND,    // 1秒一个桶，保存10分钟
+        TIER_MINUTE,    // 1分钟一个桶，保存24小时
+        TIER_COUNT
+    };
+
+    // 汇总桶
+    struct Bucket {
+        float min;
+        float max;
+        float sum;
+        uint16_t count;     // 0表示该周期没有采样
+    };
+
+    // 区间统计结果
+    struct Summary {
+        float min;
+        float max;
+        float avg;
+        bool valid;
+    };
+
+private:
+    struct Ring {
+        Bucket *buckets;            // capacity * CHANNEL_COUNT
+        uint16_t capacity;
+        uint16_t head;              // 下一个写入位置
+        uint16_t count;             // 已提交的桶数量
+        uint32_t periodMs;          // 每个桶的时间跨度
+        unsigned long slotStart;    // 当前未提交桶的开始时间
+        uint32_t version;           // 已提交桶总数，用于判断是否需要重绘
+        Bucket pending[CHANNEL_COUNT];
+    };
+
+    Ring _tiers[TIER_COUNT];
+    bool _ready;
+
+    static void resetBucket(Bucket &bucket);
+    static void mergeBucket(Bucket &into, const Bucket &from);
+    void commit(Ring &ring);
+    const Bucket *at(const Ring &ring, uint16_t age) const;
+
+public:
+    SensorHistory();
+
+    // 分配缓冲区（优先PSRAM），失败返回false
+    bool begin();
+    bool ready() const { return _ready; }
+
+    // 追加一次采样（所有通道）
+    void append(unsigned long now, const float values[CHANNEL_COUNT]);
+
+    // 查询接口，age=0为最新的已提交桶
+    uint16_t size(Tier tier) const { return _tiers[tier].count; }
+    uint16_t capacity(Tier tier) const { return _tiers[tier].capacity; }
+    uint32_t periodMs(Tier tier) const { return _tiers[tier].periodMs; }
+    uint32_t version(Tier tier) const { return _tiers[tier].version; }
+
+    // 最近span个桶的统计
+    Summary summarize(Tier tier, Channel channel, uint16_t span) const;
+
+    // 把最近span个桶按时间顺序折叠成n列（最旧在前），返回列数
+    uint8_t columns(Tier tier, Channel channel, uint16_t span, Summary out[], uint8_t n) const;
+};
+
+#endif // SENSOR_HISTORY_H
@@ -0,0 +1,51 @@
+#ifndef SEQLOCK_SNAPSHOT_H
+#define SEQLOCK_SNAPSHOT_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// 顺序锁快照：一个写者整体更新，任意任务中的读者不加锁读取一份一致的副本
+// 写者在更新前后各把序号加1（更新期间为奇数）；读者读前后序号相同且为偶数时副本有效，否则重读。
+// 写者不会被读者阻塞，读者不会读到一半新一半旧的数据。T必须可以按值复制（不含指针指向的共享数据）。
+// 只允许一个写者（这里是loop任务中的sampleSensors()）。
+template <typename T>
+class SeqlockSnapshot {
+private:
+    std::atomic<uint32_t> _seq;
+    T _value;
+
+public:
+    static const uint8_t MAX_RETRIES = 8;
+
+    // 构造函数
+    SeqlockSnapshot() : _seq(0), _value() {}
+
+    void write(const T &value) {
+        uint32_t seq = _seq.load(std::memory_order_relaxed);
+        _seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        _value = value;
+        _seq.store(seq + 2, std::memory_order_release);
+    }
+
+    // 读取副本；还没有写入过、或连续MAX_RETRIES次碰上写入时返回false
+    bool read(T &out) const {
+        for (uint8_t i = 0; i < MAX_RETRIES; i++) {
+            uint32_t before = _seq.load(std::memory_order_acquire);
+            if (before == 0) return false;
+            if (before & 1) continue;
+            out = _value;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (_seq.load(std::memory_order_relaxed) == before) return true;
+        }
+        return false;
+    }
+
+    // 写入次数（可用来判断是否有新样本）
+    uint32_t version() const { return _seq.load(std::memory_order_acquire) / 2; }
+};
+
+template <typename T>
+const uint8_t SeqlockSnapshot<T>::MAX_RETRIES;
+
+#endif // SEQLOCK_SNAPSHOT_H
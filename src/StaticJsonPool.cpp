@@ -0,0 +1,62 @@
+#include "StaticJsonPool.h"
+
+// 每块前面记录块大小，reallocate()需要知道原大小
+struct PoolBlockHeader {
+    size_t size;
+};
+
+static const size_t POOL_ALIGN = sizeof(void *);
+
+static size_t alignUp(size_t n) {
+    return (n + POOL_ALIGN - 1) & ~(POOL_ALIGN - 1);
+}
+
+// 构造函数
+StaticJsonPool::StaticJsonPool(uint8_t *buf, size_t size)
+    : _buf(buf), _size(size), _used(0), _peak(0) {
+}
+
+void *StaticJsonPool::allocate(size_t size) {
+    size_t need = sizeof(PoolBlockHeader) + alignUp(size);
+    if (_used + need > _size) return nullptr;
+
+    PoolBlockHeader *header = (PoolBlockHeader *)(_buf + _used);
+    header->size = alignUp(size);
+    _used += need;
+    if (_used > _peak) _peak = _used;
+    return header + 1;
+}
+
+void StaticJsonPool::deallocate(void *ptr) {
+    // 最后一块可以直接退回，其余等reset()
+    if (ptr == nullptr) return;
+    PoolBlockHeader *header = (PoolBlockHeader *)ptr - 1;
+    if ((uint8_t *)ptr + header->size == _buf + _used) {
+        _used = (uint8_t *)header - _buf;
+    }
+}
+
+void *StaticJsonPool::reallocate(void *ptr, size_t newSize) {
+    if (ptr == nullptr) return allocate(newSize);
+
+    PoolBlockHeader *header = (PoolBlockHeader *)ptr - 1;
+    size_t aligned = alignUp(newSize);
+
+    // 最后一块原地伸缩（字符串拼接时最常见）
+    if ((uint8_t *)ptr + header->size == _buf + _used) {
+        size_t start = (uint8_t *)ptr - _buf;
+        if (start + aligned > _size) return nullptr;
+        header->size = aligned;
+        _used = start + aligned;
+        if (_used > _peak) _peak = _used;
+        return ptr;
+    }
+
+    if (aligned <= header->size) {
+        return ptr;
+    }
+
+    void *moved = allocate(newSize);
+    if (moved) memcpy(moved, ptr, header->size);
+    return moved;
+}
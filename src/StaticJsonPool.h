@@ -0,0 +1,32 @@
+#ifndef STATIC_JSON_POOL_H
+#define STATIC_JSON_POOL_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// 固定缓冲区上的ArduinoJson分配器
+// 在调用者提供的静态缓冲区里顺序分配，deallocate()不回收，处理完一条消息后reset()整体清空。
+// 缓冲区用完时返回nullptr，JsonDocument会标记overflowed()，不会碰堆内存。
+class StaticJsonPool : public ArduinoJson::Allocator {
+private:
+    uint8_t *_buf;
+    size_t _size;
+    size_t _used;
+    size_t _peak;
+
+public:
+    StaticJsonPool(uint8_t *buf, size_t size);
+
+    void *allocate(size_t size) override;
+    void deallocate(void *ptr) override;
+    void *reallocate(void *ptr, size_t newSize) override;
+
+    // 清空全部分配（对应的JsonDocument需先clear()）
+    void reset() { _used = 0; }
+
+    size_t used() const { return _used; }
+    size_t peak() const { return _peak; }
+    size_t capacity() const { return _size; }
+};
+
+#endif // STATIC_JSON_POOL_H
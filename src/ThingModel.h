@@ -0,0 +1,128 @@
+#ifndef THING_MODEL_H
+#define THING_MODEL_H
+
+#include <Arduino.h>
+#include <stddef.h>
+
+// 物模型属性表
+// 与阿里云控制台上定义的属性标识符一一对应，上报时按表中顺序写出。
+// 属性名、类型和小数位数取自tsl/model.json生成的ThingModelTsl.h，
+// 与云端模型不一致时编译失败。
+// 新增上报属性：先在控制台添加并导出到tsl/model.json，再在PropertyFrame中加字段、
+// 在THING_FRAME_FIELDS中加一项。
+
+// 属性值类型
+enum PropertyType {
+    PROP_FLOAT,   // float，按precision位小数输出
+    PROP_INT,     // int32_t
+    PROP_BOOL,    // bool，输出0/1（阿里云bool类型）
+    PROP_TEXT     // 字符串，不进PropertyFrame（例如absentUsers）
+};
+
+#include "ThingModelTsl.h"
+
+// 一帧属性值
+struct PropertyFrame {
+    float temperature;
+    float humidity;
+    float light;
+    int32_t flame;
+    int32_t smoke;
+    int32_t noise;
+    bool lightState;
+    bool fanState;
+    bool pumpState;
+    float temperatureThreshold;
+    float humidityThreshold;
+    float lightThreshold;
+    int32_t flameThreshold;
+    int32_t smokeThreshold;
+    int32_t decibelThreshold;
+};
+
+// 属性描述
+struct PropertyDesc {
+    const char *name;     // 属性标识符
+    uint8_t type;         // PropertyType
+    uint8_t precision;    // 小数位数（仅PROP_FLOAT）
+    uint16_t offset;      // 在PropertyFrame中的偏移
+};
+
+// PropertyFrame中的上报属性，顺序即上报顺序
+#define THING_FRAME_FIELDS(X) \
+    X(temperature) \
+    X(humidity) \
+    X(light) \
+    X(flame) \
+    X(smoke) \
+    X(noise) \
+    X(lightState) \
+    X(fanState) \
+    X(pumpState) \
+    X(temperatureThreshold) \
+    X(humidityThreshold) \
+    X(lightThreshold) \
+    X(flameThreshold) \
+    X(smokeThreshold) \
+    X(decibelThreshold)
+
+// 字段的C++类型对应的属性类型
+template <typename T> struct PropertyFieldType;
+template <> struct PropertyFieldType<float> { static const uint8_t TYPE = PROP_FLOAT; };
+template <> struct PropertyFieldType<int32_t> { static const uint8_t TYPE = PROP_INT; };
+template <> struct PropertyFieldType<bool> { static const uint8_t TYPE = PROP_BOOL; };
+
+// 字段必须是物模型中的属性（否则tsl::field未定义），且C++类型与物模型类型一致
+#define THING_CHECK(field) \
+    static_assert(PropertyFieldType<decltype(PropertyFrame::field)>::TYPE == tsl::field::TYPE, \
+                  "PropertyFrame::" #field "的类型与物模型不一致");
+THING_FRAME_FIELDS(THING_CHECK)
+#undef THING_CHECK
+
+#define THING_PROP(field) { tsl::field::ID, tsl::field::TYPE, tsl::field::PRECISION, offsetof(PropertyFrame, field) },
+
+static const PropertyDesc THING_PROPERTIES[] = {
+    THING_FRAME_FIELDS(THING_PROP)
+};
+
+#undef THING_PROP
+
+#define THING_PROPERTY_COUNT (sizeof(THING_PROPERTIES) / sizeof(THING_PROPERTIES[0]))
+
+// 上报策略（与THING_PROPERTIES逐行对应）
+// 变化超过deadband且距上次上报不少于minIntervalMs才上报；
+// maxIntervalMs>0时即使没变化也按该间隔补报一次，0表示只在变化时上报（阈值、执行器状态）。
+struct ReportPolicy {
+    float deadband;
+    uint32_t minIntervalMs;
+    uint32_t maxIntervalMs;
+};
+
+static const ReportPolicy THING_REPORT_POLICY[] = {
+    { 0.3f,  5000, 60000 },   // temperature
+    { 1.0f,  5000, 60000 },   // humidity
+    { 50.0f, 5000, 60000 },   // light
+    { 5.0f,  1000, 60000 },   // flame（报警相关，变化时尽快上报）
+    { 5.0f,  1000, 60000 },   // smoke（报警相关，变化时尽快上报）
+    { 5.0f,  5000, 60000 },   // noise
+    { 0.0f,     0,     0 },   // lightState
+    { 0.0f,     0,     0 },   // fanState
+    { 0.0f,     0,     0 },   // pumpState
+    { 0.0f,     0,     0 },   // temperatureThreshold
+    { 0.0f,     0,     0 },   // humidityThreshold
+    { 0.0f,     0,     0 },   // lightThreshold
+    { 0.0f,     0,     0 },   // flameThreshold
+    { 0.0f,     0,     0 },   // smokeThreshold
+    { 0.0f,     0,     0 },   // decibelThreshold
+};
+
+static_assert(sizeof(THING_REPORT_POLICY) / sizeof(THING_REPORT_POLICY[0]) == THING_PROPERTY_COUNT,
+              "THING_REPORT_POLICY必须与THING_PROPERTIES逐行对应");
+
+// 属性选择掩码，第i位对应THING_PROPERTIES[i]
+typedef uint32_t PropertyMask;
+#define PROPERTY_MASK_ALL ((PropertyMask)((1UL << THING_PROPERTY_COUNT) - 1))
+
+static_assert(THING_PROPERTY_COUNT <= 32, "PropertyMask只有32位");
+
+#endif // THING_MODEL_H
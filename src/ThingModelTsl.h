@@ -0,0 +1,226 @@
+// 由scripts/gen_thing_model.py根据tsl/model.json生成，不要手工修改
+#ifndef THING_MODEL_TSL_H
+#define THING_MODEL_TSL_H
+
+// 只能由ThingModel.h包含（依赖PropertyType）
+
+#define TSL_PRODUCT_KEY "a1kyhW4QQ1t"
+
+// 属性标识符（宏形式，便于拼接到报文模板中）
+#define TSL_PROP_TEMPERATURE "temperature"
+#define TSL_PROP_HUMIDITY "humidity"
+#define TSL_PROP_LIGHT "light"
+#define TSL_PROP_FLAME "flame"
+#define TSL_PROP_SMOKE "smoke"
+#define TSL_PROP_NOISE "noise"
+#define TSL_PROP_LIGHT_STATE "lightState"
+#define TSL_PROP_FAN_STATE "fanState"
+#define TSL_PROP_PUMP_STATE "pumpState"
+#define TSL_PROP_TEMPERATURE_THRESHOLD "temperatureThreshold"
+#define TSL_PROP_HUMIDITY_THRESHOLD "humidityThreshold"
+#define TSL_PROP_LIGHT_THRESHOLD "lightThreshold"
+#define TSL_PROP_FLAME_THRESHOLD "flameThreshold"
+#define TSL_PROP_SMOKE_THRESHOLD "smokeThreshold"
+#define TSL_PROP_DECIBEL_THRESHOLD "decibelThreshold"
+#define TSL_PROP_START_CHECK_IN "startCheckIn"
+#define TSL_PROP_RESET_CHECK_IN "resetCheckIn"
+#define TSL_PROP_ABSENT_USERS "absentUsers"
+
+// 方法名
+#define TSL_METHOD_PROPERTY_POST "thing.event.property.post"
+#define TSL_METHOD_PROPERTY_SET  "thing.service.property.set"
+
+// 事件：方法名和主题后缀（/sys/${pk}/${dn}/之后的部分）
+#define TSL_EVENT_FIRE_ALARM "thing.event.fireAlarm.post"
+#define TSL_EVENT_FIRE_ALARM_TOPIC "thing/event/fireAlarm/post"
+#define TSL_EVENT_SMOKE_ALARM "thing.event.smokeAlarm.post"
+#define TSL_EVENT_SMOKE_ALARM_TOPIC "thing/event/smokeAlarm/post"
+
+// 每个属性一个结构体：类型、范围、小数位数（由step推出）、是否可由云端设置
+namespace tsl {
+
+static const size_t PROPERTY_COUNT = 18;
+
+// 温度（float）
+struct temperature {
+    static constexpr const char *ID = TSL_PROP_TEMPERATURE;
+    static const uint8_t TYPE = PROP_FLOAT;
+    static const uint8_t PRECISION = 1;
+    static const bool WRITABLE = false;
+    static constexpr float MIN = -40.0f;
+    static constexpr float MAX = 125.0f;
+};
+
+// 湿度（float）
+struct humidity {
+    static constexpr const char *ID = TSL_PROP_HUMIDITY;
+    static const uint8_t TYPE = PROP_FLOAT;
+    static const uint8_t PRECISION = 1;
+    static const bool WRITABLE = false;
+    static constexpr float MIN = 0.0f;
+    static constexpr float MAX = 100.0f;
+};
+
+// 光照强度（float）
+struct light {
+    static constexpr const char *ID = TSL_PROP_LIGHT;
+    static const uint8_t TYPE = PROP_FLOAT;
+    static const uint8_t PRECISION = 1;
+    static const bool WRITABLE = false;
+    static constexpr float MIN = 0.0f;
+    static constexpr float MAX = 65535.0f;
+};
+
+// 火焰强度（int）
+struct flame {
+    static constexpr const char *ID = TSL_PROP_FLAME;
+    static const uint8_t TYPE = PROP_INT;
+    static const uint8_t PRECISION = 0;
+    static const bool WRITABLE = false;
+    static constexpr float MIN = 0.0f;
+    static constexpr float MAX = 100.0f;
+};
+
+// 烟雾浓度（int）
+struct smoke {
+    static constexpr const char *ID = TSL_PROP_SMOKE;
+    static const uint8_t TYPE = PROP_INT;
+    static const uint8_t PRECISION = 0;
+    static const bool WRITABLE = false;
+    static constexpr float MIN = 0.0f;
+    static constexpr float MAX = 100.0f;
+};
+
+// 噪声（int）
+struct noise {
+    static constexpr const char *ID = TSL_PROP_NOISE;
+    static const uint8_t TYPE = PROP_INT;
+    static const uint8_t PRECISION = 0;
+    static const bool WRITABLE = false;
+    static constexpr float MIN = 0.0f;
+    static constexpr float MAX = 100.0f;
+};
+
+// 灯开关（bool）
+struct lightState {
+    static constexpr const char *ID = TSL_PROP_LIGHT_STATE;
+    static const uint8_t TYPE = PROP_BOOL;
+    static const uint8_t PRECISION = 0;
+    static const bool WRITABLE = true;
+    static constexpr float MIN = 0.0f;
+    static constexpr float MAX = 1.0f;
+};
+
+// 风扇开关（bool）
+struct fanState {
+    static constexpr const char *ID = TSL_PROP_FAN_STATE;
+    static const uint8_t TYPE = PROP_BOOL;
+    static const uint8_t PRECISION = 0;
+    static const bool WRITABLE = true;
+    static constexpr float MIN = 0.0f;
+    static constexpr float MAX = 1.0f;
+};
+
+// 水泵开关（bool）
+struct pumpState {
+    static constexpr const char *ID = TSL_PROP_PUMP_STATE;
+    static const uint8_t TYPE = PROP_BOOL;
+    static const uint8_t PRECISION = 0;
+    static const bool WRITABLE = true;
+    static constexpr float MIN = 0.0f;
+    static constexpr float MAX = 1.0f;
+};
+
+// 温度阈值（float）
+struct temperatureThreshold {
+    static constexpr const char *ID = TSL_PROP_TEMPERATURE_THRESHOLD;
+    static const uint8_t TYPE = PROP_FLOAT;
+    static const uint8_t PRECISION = 1;
+    static const bool WRITABLE = true;
+    static constexpr float MIN = -40.0f;
+    static constexpr float MAX = 125.0f;
+};
+
+// 湿度阈值（float）
+struct humidityThreshold {
+    static constexpr const char *ID = TSL_PROP_HUMIDITY_THRESHOLD;
+    static const uint8_t TYPE = PROP_FLOAT;
+    static const uint8_t PRECISION = 1;
+    static const bool WRITABLE = true;
+    static constexpr float MIN = 0.0f;
+    static constexpr float MAX = 100.0f;
+};
+
+// 光照阈值（float）
+struct lightThreshold {
+    static constexpr const char *ID = TSL_PROP_LIGHT_THRESHOLD;
+    static const uint8_t TYPE = PROP_FLOAT;
+    static const uint8_t PRECISION = 1;
+    static const bool WRITABLE = true;
+    static constexpr float MIN = 0.0f;
+    static constexpr float MAX = 65535.0f;
+};
+
+// 火焰阈值（int）
+struct flameThreshold {
+    static constexpr const char *ID = TSL_PROP_FLAME_THRESHOLD;
+    static const uint8_t TYPE = PROP_INT;
+    static const uint8_t PRECISION = 0;
+    static const bool WRITABLE = true;
+    static constexpr float MIN = 0.0f;
+    static constexpr float MAX = 100.0f;
+};
+
+// 烟雾阈值（int）
+struct smokeThreshold {
+    static constexpr const char *ID = TSL_PROP_SMOKE_THRESHOLD;
+    static const uint8_t TYPE = PROP_INT;
+    static const uint8_t PRECISION = 0;
+    static const bool WRITABLE = true;
+    static constexpr float MIN = 0.0f;
+    static constexpr float MAX = 100.0f;
+};
+
+// 噪声阈值（int）
+struct decibelThreshold {
+    static constexpr const char *ID = TSL_PROP_DECIBEL_THRESHOLD;
+    static const uint8_t TYPE = PROP_INT;
+    static const uint8_t PRECISION = 0;
+    static const bool WRITABLE = true;
+    static constexpr float MIN = 0.0f;
+    static constexpr float MAX = 100.0f;
+};
+
+// 开始查寝（bool）
+struct startCheckIn {
+    static constexpr const char *ID = TSL_PROP_START_CHECK_IN;
+    static const uint8_t TYPE = PROP_BOOL;
+    static const uint8_t PRECISION = 0;
+    static const bool WRITABLE = true;
+    static constexpr float MIN = 0.0f;
+    static constexpr float MAX = 1.0f;
+};
+
+// 重置查寝（bool）
+struct resetCheckIn {
+    static constexpr const char *ID = TSL_PROP_RESET_CHECK_IN;
+    static const uint8_t TYPE = PROP_BOOL;
+    static const uint8_t PRECISION = 0;
+    static const bool WRITABLE = true;
+    static constexpr float MIN = 0.0f;
+    static constexpr float MAX = 1.0f;
+};
+
+// 未打卡人员（text）
+struct absentUsers {
+    static constexpr const char *ID = TSL_PROP_ABSENT_USERS;
+    static const uint8_t TYPE = PROP_TEXT;
+    static const uint8_t PRECISION = 0;
+    static const bool WRITABLE = false;
+    static constexpr float MIN = 0.0f;
+    static constexpr float MAX = 256.0f;
+};
+
+} // namespace tsl
+
+#endif // THING_MODEL_TSL_H
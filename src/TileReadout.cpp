@@ -0,0 +1,96 @@
+#include "TileReadout.h"
+
+// 构造函数
+TileReadout::TileReadout(U8G2 &display, const uint8_t *font)
+    : _display(display), _font(font), _count(0) {
+}
+
+// 注册字段
+int8_t TileReadout::addField(uint8_t col, uint8_t row, uint8_t width) {
+    if (_count >= MAX_FIELDS || width == 0 || width > MAX_WIDTH) {
+        return -1;
+    }
+
+    Field &field = _fields[_count];
+    field.col = col;
+    field.row = row;
+    field.width = width;
+    field.dirty = true;
+    memset(field.text, ' ', width);
+    field.text[width] = '\0';
+
+    return _count++;
+}
+
+// 右对齐保存文本，超长时保留右侧字符
+bool TileReadout::store(Field &field, const char *text) {
+    char padded[MAX_WIDTH + 1];
+    size_t len = strlen(text);
+
+    if (len >= field.width) {
+        memcpy(padded, text + (len - field.width), field.width);
+    } else {
+        memset(padded, ' ', field.width - len);
+        memcpy(padded + (field.width - len), text, len);
+    }
+    padded[field.width] = '\0';
+
+    // 内容相同则不需要发送
+    if (memcmp(padded, field.text, field.width) == 0) {
+        return false;
+    }
+    memcpy(field.text, padded, field.width + 1);
+    return true;
+}
+
+// 更新字段文本
+void TileReadout::setText(uint8_t field, const char *text) {
+    if (field >= _count) return;
+    if (store(_fields[field], text)) {
+        _fields[field].dirty = true;
+    }
+}
+
+// 更新整数字段
+void TileReadout::setInt(uint8_t field, long value) {
+    char buf[12];
+    snprintf(buf, sizeof(buf), "%ld", value);
+    setText(field, buf);
+}
+
+// 更新浮点字段
+void TileReadout::setFloat(uint8_t field, float value, uint8_t decimals) {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%.*f", decimals, value);
+    setText(field, buf);
+}
+
+// 整帧刷新后所有字段都需要重新写入
+void TileReadout::invalidate() {
+    for (uint8_t i = 0; i < _count; i++) {
+        _fields[i].dirty = true;
+    }
+}
+
+// 把变化的字段直接写入显示RAM
+uint8_t TileReadout::flush() {
+    u8x8_t *u8x8 = _display.getU8x8();
+    uint8_t tiles = 0;
+    bool fontSet = false;
+
+    for (uint8_t i = 0; i < _count; i++) {
+        Field &field = _fields[i];
+        if (!field.dirty) continue;
+
+        // 只在确实需要写入时设置字体
+        if (!fontSet) {
+            u8x8_SetFont(u8x8, _font);
+            fontSet = true;
+        }
+        u8x8_DrawString(u8x8, field.col, field.row, field.text);
+        field.dirty = false;
+        tiles += field.width;
+    }
+
+    return tiles;
+}
@@ -0,0 +1,51 @@
+#ifndef TILE_READOUT_H
+#define TILE_READOUT_H
+
+#include <Arduino.h>
+#include <U8g2lib.h>
+
+// 基于u8x8瓦片接口的数值显示区
+// 页面框架（标题、标签、单位）由u8g2整帧绘制一次，
+// 数值直接按8x8瓦片写入显示RAM，只在内容变化时发送几个字节。
+class TileReadout {
+public:
+    static const uint8_t MAX_FIELDS = 8;   // 最大字段数量
+    static const uint8_t MAX_WIDTH = 8;    // 单个字段最大字符数（瓦片数）
+
+private:
+    struct Field {
+        uint8_t col;                    // 起始瓦片列（0-15）
+        uint8_t row;                    // 瓦片行（0-7）
+        uint8_t width;                  // 字段宽度（字符数）
+        bool dirty;                     // 是否需要重新发送
+        char text[MAX_WIDTH + 1];       // 当前内容（右对齐，空格填充）
+    };
+
+    U8G2 &_display;
+    const uint8_t *_font;
+    Field _fields[MAX_FIELDS];
+    uint8_t _count;
+
+    // 将文本右对齐写入字段，内容不变时返回false
+    bool store(Field &field, const char *text);
+
+public:
+    // 构造函数，font为u8x8字体（8x8像素）
+    TileReadout(U8G2 &display, const uint8_t *font);
+
+    // 注册一个数值字段，返回字段编号，失败返回-1
+    int8_t addField(uint8_t col, uint8_t row, uint8_t width);
+
+    // 更新字段内容（只标记，不立即发送）
+    void setText(uint8_t field, const char *text);
+    void setInt(uint8_t field, long value);
+    void setFloat(uint8_t field, float value, uint8_t decimals);
+
+    // 整帧刷新后调用，使所有字段在下次flush时重新写入
+    void invalidate();
+
+    // 将变化的字段写入显示RAM，返回写入的瓦片数量
+    uint8_t flush();
+};
+
+#endif // TILE_READOUT_H
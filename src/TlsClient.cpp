@@ -0,0 +1,237 @@
+#include "TlsClient.h"
+#include <esp_random.h>
+#include <mbedtls/net_sockets.h>
+
+// 构造函数
+TlsClient::TlsClient(uint32_t handshakeTimeoutMs)
+    : _caLoaded(false), _confReady(false), _sslActive(false), _haveSession(false),
+      _hostname(nullptr), _handshakeTimeoutMs(handshakeTimeoutMs), _peek(-1) {
+    memset(&_metrics, 0, sizeof(_metrics));
+    mbedtls_x509_crt_init(&_ca);
+    mbedtls_ssl_config_init(&_conf);
+    mbedtls_ssl_session_init(&_session);
+}
+
+TlsClient::~TlsClient() {
+    stop();
+    mbedtls_ssl_session_free(&_session);
+    mbedtls_ssl_config_free(&_conf);
+    mbedtls_x509_crt_free(&_ca);
+}
+
+// 解析CA证书，只在启动时做一次
+bool TlsClient::loadCaCert(const char *pem) {
+    // PEM解析要求长度包含结尾的'\0'
+    int ret = mbedtls_x509_crt_parse(&_ca, (const unsigned char *)pem, strlen(pem) + 1);
+    _caLoaded = ret == 0;
+    _metrics.lastError = ret;
+    return _caLoaded;
+}
+
+// TLS配置只建立一次，所有连接共用
+bool TlsClient::setupConfig() {
+    if (_confReady) return true;
+    if (!_caLoaded) return false;
+
+    int ret = mbedtls_ssl_config_defaults(&_conf, MBEDTLS_SSL_IS_CLIENT,
+                                          MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT);
+    if (ret != 0) {
+        _metrics.lastError = ret;
+        return false;
+    }
+    mbedtls_ssl_conf_authmode(&_conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+    mbedtls_ssl_conf_ca_chain(&_conf, &_ca, nullptr);
+    mbedtls_ssl_conf_rng(&_conf, rng, nullptr);
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    mbedtls_ssl_conf_session_tickets(&_conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+    _confReady = true;
+    return true;
+}
+
+// 硬件随机数
+int TlsClient::rng(void *ctx, unsigned char *buf, size_t len) {
+    (void)ctx;
+    esp_fill_random(buf, len);
+    return 0;
+}
+
+// mbedTLS通过WiFiClient收发，不阻塞
+int TlsClient::bioSend(void *ctx, const unsigned char *buf, size_t len) {
+    TlsClient *self = static_cast<TlsClient *>(ctx);
+    if (!self->_tcp.connected()) return MBEDTLS_ERR_NET_CONN_RESET;
+    size_t sent = self->_tcp.write(buf, len);
+    return sent > 0 ? (int)sent : MBEDTLS_ERR_SSL_WANT_WRITE;
+}
+
+int TlsClient::bioRecv(void *ctx, unsigned char *buf, size_t len) {
+    TlsClient *self = static_cast<TlsClient *>(ctx);
+    int avail = self->_tcp.available();
+    if (avail <= 0) {
+        return self->_tcp.connected() ? MBEDTLS_ERR_SSL_WANT_READ : MBEDTLS_ERR_NET_CONN_RESET;
+    }
+    int got = self->_tcp.read(buf, len < (size_t)avail ? len : (size_t)avail);
+    return got > 0 ? got : MBEDTLS_ERR_SSL_WANT_READ;
+}
+
+void TlsClient::dropSession() {
+    if (_haveSession) {
+        mbedtls_ssl_session_free(&_session);
+        mbedtls_ssl_session_init(&_session);
+        _haveSession = false;
+    }
+}
+
+void TlsClient::freeSsl() {
+    if (_sslActive) {
+        mbedtls_ssl_free(&_ssl);
+        _sslActive = false;
+    }
+}
+
+// 在已建立的TCP连接上握手，返回0表示成功
+int TlsClient::handshake(const char *hostname) {
+    mbedtls_ssl_init(&_ssl);
+    _sslActive = true;
+
+    int ret = mbedtls_ssl_setup(&_ssl, &_conf);
+    if (ret == 0) ret = mbedtls_ssl_set_hostname(&_ssl, hostname);
+    if (ret != 0) return ret;
+    mbedtls_ssl_set_bio(&_ssl, this, bioSend, bioRecv, nullptr);
+
+    // 带上次保存的会话，服务器接受时走简化握手
+    bool offered = _haveSession && mbedtls_ssl_set_session(&_ssl, &_session) == 0;
+
+    unsigned long start = millis();
+    while ((ret = mbedtls_ssl_handshake(&_ssl)) != 0) {
+        if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) break;
+        if (millis() - start >= _handshakeTimeoutMs) {
+            ret = MBEDTLS_ERR_SSL_TIMEOUT;
+            break;
+        }
+        delay(1);
+    }
+    uint32_t elapsed = millis() - start;
+
+    if (ret != 0) {
+        // 会话可能已被服务器淘汰，下次做完整握手
+        if (offered) dropSession();
+        return ret;
+    }
+
+    _metrics.handshakes++;
+    _metrics.lastHandshakeMs = elapsed;
+    if (offered) {
+        _metrics.resumeOffers++;
+        _metrics.resumeTotalMs += elapsed;
+    } else {
+        _metrics.fullTotalMs += elapsed;
+    }
+
+    // 保存本次会话供下次复用
+    dropSession();
+    if (mbedtls_ssl_get_session(&_ssl, &_session) == 0) {
+        _haveSession = true;
+    }
+    return 0;
+}
+
+int TlsClient::connect(IPAddress ip, uint16_t port) {
+    stop();
+    if (_hostname == nullptr || !setupConfig()) return 0;
+    if (!_tcp.connect(ip, port)) return 0;
+
+    int ret = handshake(_hostname);
+    if (ret != 0) {
+        _metrics.failures++;
+        _metrics.lastError = ret;
+        stop();
+        return 0;
+    }
+    return 1;
+}
+
+int TlsClient::connect(const char *host, uint16_t port) {
+    stop();
+    if (!setupConfig()) return 0;
+    if (!_tcp.connect(host, port)) return 0;
+
+    int ret = handshake(_hostname ? _hostname : host);
+    if (ret != 0) {
+        _metrics.failures++;
+        _metrics.lastError = ret;
+        stop();
+        return 0;
+    }
+    return 1;
+}
+
+// 发送，直到全部写入或出错
+size_t TlsClient::write(const uint8_t *buf, size_t size) {
+    if (!_sslActive) return 0;
+    size_t sent = 0;
+    unsigned long start = millis();
+    while (sent < size) {
+        int ret = mbedtls_ssl_write(&_ssl, buf + sent, size - sent);
+        if (ret > 0) {
+            sent += ret;
+        } else if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+            break;
+        } else if (millis() - start >= _handshakeTimeoutMs) {
+            break;
+        }
+    }
+    return sent;
+}
+
+// 处理已到达的记录并返回可读字节数
+int TlsClient::available() {
+    if (!_sslActive) return 0;
+    int pending = _peek >= 0 ? 1 : 0;
+    int ret = mbedtls_ssl_read(&_ssl, nullptr, 0);
+    if (ret < 0 && ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+        return pending;
+    }
+    return pending + (int)mbedtls_ssl_get_bytes_avail(&_ssl);
+}
+
+int TlsClient::read() {
+    uint8_t b;
+    return read(&b, 1) == 1 ? b : -1;
+}
+
+int TlsClient::read(uint8_t *buf, size_t size) {
+    if (!_sslActive || size == 0) return -1;
+    size_t got = 0;
+    if (_peek >= 0) {
+        buf[got++] = (uint8_t)_peek;
+        _peek = -1;
+        if (got == size) return got;
+    }
+    int ret = mbedtls_ssl_read(&_ssl, buf + got, size - got);
+    if (ret > 0) return got + ret;
+    return got > 0 ? (int)got : -1;
+}
+
+int TlsClient::peek() {
+    if (_peek < 0) {
+        uint8_t b;
+        if (read(&b, 1) == 1) _peek = b;
+    }
+    return _peek;
+}
+
+// 关闭连接，保留会话
+void TlsClient::stop() {
+    if (_sslActive) {
+        mbedtls_ssl_close_notify(&_ssl);
+    }
+    freeSsl();
+    _tcp.stop();
+    _peek = -1;
+}
+
+uint8_t TlsClient::connected() {
+    if (!_sslActive) return 0;
+    return _tcp.connected() || available() > 0;
+}
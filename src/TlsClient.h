@@ -0,0 +1,79 @@
+#ifndef TLS_CLIENT_H
+#define TLS_CLIENT_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/x509_crt.h>
+
+// 带会话复用的TLS客户端（给PubSubClient用的Client实现）
+// CA证书只在启动时解析一次，之后每次重连直接复用解析结果；
+// 握手成功后保存会话（Session ID/Ticket），下次连接时带上，服务器接受时只需简化握手，
+// WiFi短暂断开后的重连基本不再做RSA/ECDHE运算。AES/SHA/大数运算由mbedTLS调用S3硬件加速。
+class TlsClient : public Client {
+public:
+    struct Metrics {
+        uint32_t handshakes;        // 成功的握手次数
+        uint32_t resumeOffers;      // 其中带着已保存会话发起的次数
+        uint32_t failures;          // 失败次数
+        uint32_t lastHandshakeMs;
+        uint32_t fullTotalMs;       // 不带会话的握手累计耗时
+        uint32_t resumeTotalMs;     // 带会话的握手累计耗时
+        int lastError;              // mbedTLS错误码
+    };
+
+private:
+    WiFiClient _tcp;
+    mbedtls_ssl_context _ssl;
+    mbedtls_ssl_config _conf;
+    mbedtls_x509_crt _ca;
+    mbedtls_ssl_session _session;
+    bool _caLoaded;
+    bool _confReady;
+    bool _sslActive;
+    bool _haveSession;
+    const char *_hostname;      // 用于SNI和证书校验的域名
+    uint32_t _handshakeTimeoutMs;
+    int _peek;
+    Metrics _metrics;
+
+    static int bioSend(void *ctx, const unsigned char *buf, size_t len);
+    static int bioRecv(void *ctx, unsigned char *buf, size_t len);
+    static int rng(void *ctx, unsigned char *buf, size_t len);
+    bool setupConfig();
+    int handshake(const char *hostname);
+    void dropSession();
+    void freeSsl();
+
+public:
+    explicit TlsClient(uint32_t handshakeTimeoutMs = 10000);
+    ~TlsClient();
+
+    // 解析PEM格式的CA证书，返回false时不能建立TLS连接
+    bool loadCaCert(const char *pem);
+    bool hasCaCert() const { return _caLoaded; }
+
+    // 按IP连接时用于SNI和证书校验的域名（指针需长期有效）
+    void setHostname(const char *hostname) { _hostname = hostname; }
+
+    // 丢弃保存的会话，下次做完整握手（例如更换服务器后）
+    void forgetSession() { dropSession(); }
+
+    const Metrics &metrics() const { return _metrics; }
+
+    // Client接口
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(const char *host, uint16_t port) override;
+    size_t write(uint8_t b) override { return write(&b, 1); }
+    size_t write(const uint8_t *buf, size_t size) override;
+    int available() override;
+    int read() override;
+    int read(uint8_t *buf, size_t size) override;
+    int peek() override;
+    void flush() override {}
+    void stop() override;
+    uint8_t connected() override;
+    operator bool() override { return connected(); }
+};
+
+#endif // TLS_CLIENT_H
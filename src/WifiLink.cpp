@@ -0,0 +1,338 @@
+#include "WifiLink.h"
+#include <Preferences.h>
+#include <time.h>
+#include <esp_netif.h>
+#include <esp_netif_net_stack.h>
+#include <lwip/dhcp.h>
+
+#define WIFI_NAMESPACE "wifi"
+#define CACHE_MAGIC 0x57494649UL           // "WIFI"
+#define FAST_CONNECT_TIMEOUT 4000          // 指定BSSID和信道时一般1秒内连上
+#define CONNECT_TIMEOUT 12000
+#define SCAN_TIMEOUT 10000
+#define REASON_ASSOC_LEAVE 8               // 本机主动断开（WiFi.begin/disconnect切换网络时产生）
+
+const uint8_t WifiLink::MAX_NETWORKS;
+WifiLink *WifiLink::_instance = nullptr;
+
+// 软复位和深睡唤醒后仍然有效，用校验和判断是否为上电后的随机内容
+RTC_NOINIT_ATTR WifiLink::Cache WifiLink::_rtcCache;
+RTC_NOINIT_ATTR uint32_t WifiLink::_rtcCheck;
+
+// FNV-1a
+uint32_t WifiLink::checksum(const Cache &cache) {
+    const uint8_t *data = (const uint8_t *)&cache;
+    uint32_t h = 2166136261UL;
+    for (size_t i = 0; i < sizeof(cache); i++) {
+        h = (h ^ data[i]) * 16777619UL;
+    }
+    return h;
+}
+
+// 构造函数
+WifiLink::WifiLink(uint32_t minBackoffMs, uint32_t maxBackoffMs)
+    : _networkCount(0), _target(nullptr), _staticIp(false), _reuseLease(false),
+      _cacheValid(false), _fastAttempt(false), _leaseReused(false), _state(LINK_IDLE), _attemptStart(0), _retryAt(0),
+      _backoffMs(0), _minBackoffMs(minBackoffMs), _maxBackoffMs(maxBackoffMs),
+      _gotIp(false), _disconnected(false), _reason(0), _onState(nullptr) {
+    memset(&_cache, 0, sizeof(_cache));
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+bool WifiLink::addNetwork(const char *ssid, const char *password) {
+    if (_networkCount >= MAX_NETWORKS || ssid == nullptr || ssid[0] == '\0') return false;
+    _networks[_networkCount].ssid = ssid;
+    _networks[_networkCount].password = password;
+    _networkCount++;
+    return true;
+}
+
+void WifiLink::setStaticIp(const IPAddress &ip, const IPAddress &gateway, const IPAddress &subnet,
+                           const IPAddress &dns1, const IPAddress &dns2) {
+    _staticIp = true;
+    _ip = ip;
+    _gateway = gateway;
+    _subnet = subnet;
+    _dns1 = dns1;
+    _dns2 = dns2;
+}
+
+// WiFi任务中调用，只设置标志
+void WifiLink::handleEvent(WiFiEvent_t event, WiFiEventInfo_t info) {
+    WifiLink *link = _instance;
+    if (link == nullptr) return;
+    switch (event) {
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+        link->_gotIp = true;
+        break;
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+    case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+        link->_reason = event == ARDUINO_EVENT_WIFI_STA_LOST_IP ? 0 : info.wifi_sta_disconnected.reason;
+        link->_disconnected = true;
+        break;
+    default:
+        break;
+    }
+}
+
+void WifiLink::setState(State state) {
+    if (state == _state) return;
+    _state = state;
+    if (_onState) _onState(state);
+}
+
+const WifiLink::Network *WifiLink::findNetwork(const char *ssid) const {
+    for (uint8_t i = 0; i < _networkCount; i++) {
+        if (strcmp(_networks[i].ssid, ssid) == 0) return &_networks[i];
+    }
+    return nullptr;
+}
+
+// 当前DHCP租约的租期（秒），取不到时返回0
+uint32_t WifiLink::leaseSeconds() {
+    esp_netif_t *netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+    if (netif == nullptr) return 0;
+    struct netif *lwip = (struct netif *)esp_netif_get_netif_impl(netif);
+    struct dhcp *dhcp = lwip != nullptr ? netif_dhcp_data(lwip) : nullptr;
+    return dhcp != nullptr ? dhcp->offered_t0_lease : 0;
+}
+
+// 系统时间由RTC计时，软复位和深睡后继续走；对时只会让它向前跳，沿用的地址因此提前作废
+bool WifiLink::leaseUsable() const {
+    return _cache.ip != 0 && (int32_t)(_cache.renewAt - (uint32_t)time(nullptr)) > 0;
+}
+
+// RTC内存中有就用RTC（带DHCP地址），否则用NVS中的AP信息
+void WifiLink::loadCache() {
+    if (_rtcCheck == checksum(_rtcCache)) {
+        _cache = _rtcCache;
+    } else {
+        memset(&_cache, 0, sizeof(_cache));
+        Preferences prefs;
+        if (prefs.begin(WIFI_NAMESPACE, true)) {
+            prefs.getBytes("ap", &_cache, offsetof(Cache, ip));
+            prefs.end();
+        }
+    }
+    _cache.ssid[sizeof(_cache.ssid) - 1] = '\0';
+    _cacheValid = _cache.magic == CACHE_MAGIC && _cache.channel != 0 && findNetwork(_cache.ssid) != nullptr;
+}
+
+// AP变化时才写NVS，DHCP地址每次都更新到RTC内存
+void WifiLink::saveCache() {
+    Cache latest;
+    memset(&latest, 0, sizeof(latest));
+    latest.magic = CACHE_MAGIC;
+    strlcpy(latest.ssid, _target->ssid, sizeof(latest.ssid));
+    memcpy(latest.bssid, WiFi.BSSID(), sizeof(latest.bssid));
+    latest.channel = WiFi.channel();
+    if (_leaseReused) {
+        // 沿用的地址是静态配置上去的，不是新租约，保留原来的截止时间
+        latest.ip = _cache.ip;
+        latest.gateway = _cache.gateway;
+        latest.subnet = _cache.subnet;
+        latest.dns = _cache.dns;
+        latest.renewAt = _cache.renewAt;
+    } else if (!_staticIp) {
+        uint32_t lease = leaseSeconds();
+        if (lease != 0) {
+            latest.ip = WiFi.localIP();
+            latest.gateway = WiFi.gatewayIP();
+            latest.subnet = WiFi.subnetMask();
+            latest.dns = WiFi.dnsIP();
+            latest.renewAt = (uint32_t)time(nullptr) + lease / 2;
+        }
+    }
+
+    bool apChanged = !_cacheValid || memcmp(&latest, &_cache, offsetof(Cache, ip)) != 0;
+    _cache = latest;
+    _cacheValid = true;
+    _rtcCache = _cache;
+    _rtcCheck = checksum(_rtcCache);
+
+    if (apChanged) {
+        Preferences prefs;
+        if (prefs.begin(WIFI_NAMESPACE, false)) {
+            prefs.putBytes("ap", &_cache, offsetof(Cache, ip));
+            prefs.end();
+        }
+    }
+}
+
+void WifiLink::connectTo(const Network &network, const uint8_t *bssid, int32_t channel, bool useLease) {
+    if (_staticIp) {
+        WiFi.config(_ip, _gateway, _subnet, _dns1, _dns2);
+    } else if (useLease) {
+        WiFi.config(IPAddress(_cache.ip), IPAddress(_cache.gateway), IPAddress(_cache.subnet), IPAddress(_cache.dns));
+    } else {
+        // 全0表示使用DHCP
+        WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+    }
+    _target = &network;
+    _leaseReused = !_staticIp && useLease;
+    _attemptStart = millis();
+    _disconnected = false;
+    _gotIp = false;
+    WiFi.begin(network.ssid, network.password, channel, bssid, true);
+    setState(LINK_CONNECTING);
+}
+
+// 用上次连接的AP直接连接，没有缓存时返回false
+bool WifiLink::fastConnect() {
+    if (!_cacheValid) return false;
+    const Network *network = findNetwork(_cache.ssid);
+    if (network == nullptr) return false;
+    _fastAttempt = true;
+    connectTo(*network, _cache.bssid, _cache.channel, _reuseLease && leaseUsable());
+    return true;
+}
+
+// 沿用的地址到了续租时间：作废缓存的地址，用同一个AP重新连接，由DHCP取得新租约
+void WifiLink::renewLease() {
+    _cache.ip = 0;
+    _rtcCache.ip = 0;
+    _rtcCheck = checksum(_rtcCache);
+    WiFi.disconnect();
+    _stats.leaseRenewals++;
+    if (!fastConnect()) startScan();
+}
+
+void WifiLink::startScan() {
+    _fastAttempt = false;
+    WiFi.disconnect();
+    WiFi.scanDelete();
+    if (WiFi.scanNetworks(true) == WIFI_SCAN_FAILED) {
+        scheduleRetry(millis());
+        return;
+    }
+    _stats.scans++;
+    _attemptStart = millis();
+    setState(LINK_SCANNING);
+}
+
+// 在扫描结果中选信号最强的已配置网络，信号相同时按添加顺序
+void WifiLink::connectBestFromScan() {
+    int16_t count = WiFi.scanComplete();
+    int16_t best = -1;
+    const Network *bestNetwork = nullptr;
+    for (int16_t i = 0; i < count; i++) {
+        const Network *network = findNetwork(WiFi.SSID(i).c_str());
+        if (network == nullptr) continue;
+        if (best < 0 || WiFi.RSSI(i) > WiFi.RSSI(best) ||
+            (WiFi.RSSI(i) == WiFi.RSSI(best) && network < bestNetwork)) {
+            best = i;
+            bestNetwork = network;
+        }
+    }
+    if (bestNetwork == nullptr) {
+        WiFi.scanDelete();
+        scheduleRetry(millis());
+        return;
+    }
+
+    uint8_t bssid[6];
+    memcpy(bssid, WiFi.BSSID(best), sizeof(bssid));
+    int32_t channel = WiFi.channel(best);
+    WiFi.scanDelete();
+    connectTo(*bestNetwork, bssid, channel, false);
+}
+
+void WifiLink::established(unsigned long now) {
+    uint32_t elapsed = now - _attemptStart;
+    _stats.connects++;
+    if (_fastAttempt) _stats.fastConnects++;
+    _stats.lastConnectMs = elapsed;
+    if (elapsed > _stats.maxConnectMs) _stats.maxConnectMs = elapsed;
+    _backoffMs = 0;
+    saveCache();
+    setState(LINK_CONNECTED);
+}
+
+void WifiLink::scheduleRetry(unsigned long now) {
+    _backoffMs = _backoffMs == 0 ? _minBackoffMs : _backoffMs * 2;
+    if (_backoffMs > _maxBackoffMs) _backoffMs = _maxBackoffMs;
+    _retryAt = now + _backoffMs;
+    setState(LINK_BACKOFF);
+}
+
+void WifiLink::begin() {
+    _instance = this;
+    WiFi.persistent(false);           // 配置不写入WiFi库自己的NVS
+    WiFi.mode(WIFI_STA);
+    WiFi.setAutoReconnect(false);     // 重连由本类负责，避免和库的重连互相打断
+    WiFi.onEvent(handleEvent);
+    loadCache();
+    if (!fastConnect()) startScan();
+}
+
+void WifiLink::loop() {
+    if (_state == LINK_IDLE) return;
+    unsigned long now = millis();
+
+    if (_gotIp) {
+        _gotIp = false;
+        if (_state == LINK_CONNECTING) established(now);
+    }
+
+    if (_disconnected) {
+        _disconnected = false;
+        uint8_t reason = _reason;
+        if (_state == LINK_CONNECTED) {
+            // 断开后立即用同一个AP重连，不等轮询
+            _stats.disconnects++;
+            _stats.lastReason = reason;
+            if (!fastConnect()) startScan();
+            return;
+        }
+        if (_state == LINK_CONNECTING && reason != REASON_ASSOC_LEAVE) {
+            _stats.lastReason = reason;
+            _attemptStart = now - CONNECT_TIMEOUT;   // 按超时处理
+        }
+    }
+
+    switch (_state) {
+    case LINK_CONNECTED:
+        // 静态配置的地址不会自动续租
+        if (_leaseReused && !leaseUsable()) renewLease();
+        break;
+
+    case LINK_CONNECTING:
+        if (now - _attemptStart >= (_fastAttempt ? FAST_CONNECT_TIMEOUT : CONNECT_TIMEOUT)) {
+            if (_fastAttempt) {
+                // AP换了信道或沿用的地址不可用，改为扫描，下次不再沿用这个地址
+                _cache.ip = 0;
+                _rtcCache.ip = 0;
+                _rtcCheck = checksum(_rtcCache);
+                startScan();
+            } else {
+                WiFi.disconnect();
+                scheduleRetry(now);
+            }
+        }
+        break;
+
+    case LINK_SCANNING: {
+        int16_t result = WiFi.scanComplete();
+        if (result == WIFI_SCAN_RUNNING) {
+            if (now - _attemptStart >= SCAN_TIMEOUT) {
+                WiFi.scanDelete();
+                scheduleRetry(now);
+            }
+        } else if (result == WIFI_SCAN_FAILED) {
+            scheduleRetry(now);
+        } else {
+            connectBestFromScan();
+        }
+        break;
+    }
+
+    case LINK_BACKOFF:
+        if ((long)(now - _retryAt) >= 0) {
+            if (!fastConnect()) startScan();
+        }
+        break;
+
+    default:
+        break;
+    }
+}
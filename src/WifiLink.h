@@ -0,0 +1,133 @@
+#ifndef WIFI_LINK_H
+#define WIFI_LINK_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+// WiFi连接管理
+// 由WiFi事件驱动：事件回调（WiFi任务中）只记下发生了什么，状态在loop()中推进，从不延时等待。
+// 上次连上的AP（SSID/BSSID/信道）保存在RTC内存和NVS中，重连时直接指定BSSID和信道，省掉全信道扫描；
+// 快速连接失败才异步扫描，在已配置的多个SSID中选信号最强的一个。
+// 可以使用静态IP；也可以沿用RTC内存中上次的DHCP地址（软复位和深睡后有效，断电后重新DHCP）。
+// 沿用的地址只用到租期过半（DHCP客户端本该续租的时间），到期后通过DHCP重新连接取得新租约。
+// 断开后立即重连，连续失败按指数退避。
+class WifiLink {
+public:
+    static const uint8_t MAX_NETWORKS = 4;
+
+    enum State {
+        LINK_IDLE,          // 还没有调用begin()
+        LINK_CONNECTING,    // 正在连接（快速连接或扫描后连接）
+        LINK_SCANNING,      // 正在异步扫描
+        LINK_CONNECTED,     // 已拿到IP
+        LINK_BACKOFF        // 没有可用网络或连接失败，等待重试
+    };
+
+    // 连接状态变化回调（loop任务中调用）
+    typedef void (*StateCallback)(State state);
+
+    struct Stats {
+        uint32_t connects;        // 成功连接次数
+        uint32_t fastConnects;    // 其中用缓存BSSID/信道直接连上的次数
+        uint32_t scans;
+        uint32_t disconnects;
+        uint32_t lastConnectMs;   // 开始连接到拿到IP
+        uint32_t maxConnectMs;
+        uint32_t leaseRenewals;   // 沿用的地址到期后改用DHCP重新连接的次数
+        uint8_t lastReason;       // 最近一次断开原因（wifi_err_reason_t）
+    };
+
+private:
+    struct Network {
+        const char *ssid;
+        const char *password;
+    };
+
+    // 上次连接的AP和地址（RTC内存和NVS中各一份）
+    struct Cache {
+        uint32_t magic;
+        char ssid[33];
+        uint8_t bssid[6];
+        uint8_t channel;
+        uint32_t ip;              // DHCP地址，只在RTC内存中有效
+        uint32_t gateway;
+        uint32_t subnet;
+        uint32_t dns;
+        uint32_t renewAt;         // 沿用地址的截止时间（系统时间，秒），取得租约时的租期一半
+    };
+
+    static WifiLink *_instance;   // 事件回调是普通函数指针，通过它找到对象
+    static Cache _rtcCache;
+    static uint32_t _rtcCheck;
+
+    Network _networks[MAX_NETWORKS];
+    uint8_t _networkCount;
+    const Network *_target;       // 本次连接的网络
+
+    bool _staticIp;
+    IPAddress _ip, _gateway, _subnet, _dns1, _dns2;
+    bool _reuseLease;
+
+    Cache _cache;
+    bool _cacheValid;
+    bool _fastAttempt;            // 本次是否用缓存的BSSID/信道
+    bool _leaseReused;            // 本次连接是否沿用了缓存的DHCP地址（没有向DHCP续租）
+
+    State _state;
+    unsigned long _attemptStart;
+    unsigned long _retryAt;
+    uint32_t _backoffMs;
+    uint32_t _minBackoffMs;
+    uint32_t _maxBackoffMs;
+
+    volatile bool _gotIp;
+    volatile bool _disconnected;
+    volatile uint8_t _reason;
+
+    StateCallback _onState;
+    Stats _stats;
+
+    static uint32_t checksum(const Cache &cache);
+    static void handleEvent(WiFiEvent_t event, WiFiEventInfo_t info);
+    static uint32_t leaseSeconds();
+    bool leaseUsable() const;
+    void renewLease();
+    void setState(State state);
+    bool fastConnect();
+    void startScan();
+    void connectBestFromScan();
+    void connectTo(const Network &network, const uint8_t *bssid, int32_t channel, bool useLease);
+    void established(unsigned long now);
+    void scheduleRetry(unsigned long now);
+    const Network *findNetwork(const char *ssid) const;
+    void loadCache();
+    void saveCache();
+
+public:
+    WifiLink(uint32_t minBackoffMs, uint32_t maxBackoffMs);
+
+    // 添加一个网络（指针需一直有效），按添加顺序作为同样信号强度时的优先级
+    bool addNetwork(const char *ssid, const char *password);
+
+    // 使用静态IP（在begin()之前调用）
+    void setStaticIp(const IPAddress &ip, const IPAddress &gateway, const IPAddress &subnet,
+                     const IPAddress &dns1, const IPAddress &dns2 = IPAddress());
+
+    // 快速重连时沿用RTC内存中的DHCP地址（租期过半前），不等DHCP
+    void reuseLease(bool enable) { _reuseLease = enable; }
+
+    void onStateChange(StateCallback callback) { _onState = callback; }
+
+    // 注册事件并立即开始连接，不等待结果
+    void begin();
+
+    // 在loop()中调用
+    void loop();
+
+    bool connected() const { return _state == LINK_CONNECTED; }
+    State state() const { return _state; }
+    const char *ssid() const { return _target ? _target->ssid : ""; }
+    const Stats &stats() const { return _stats; }
+};
+
+#endif // WIFI_LINK_H
@@ -5,10 +5,40 @@
 #include <OneButton.h> // 按键处理库
 #include "SoftwareSerial.h"       //注意添加这个软串口头文件s
 #include<WiFi.h>
-#include <PubSubClient.h> // MQTT库
 #include <ArduinoJson.h>  // JSON库
 #include <Ticker.h>      // 定时器库
 #include "SoftI2C_SHT30.h"
+#include "MqttConnection.h"
+#include "PubSubTransport.h"
+#include "EspMqttTransport.h"
+#include "TileReadout.h"
+#include "DisplayGovernor.h"
+#include "DisplayPower.h"
+#include "SceneManager.h"
+#include "SensorHistory.h"
+#include "PropertyCodec.h"
+#include "ChangeTracker.h"
+#include "SampleBatch.h"
+#include "Outbox.h"
+#include "PublishTracker.h"
+#include "DeviceIdentity.h"
+#include "TlsClient.h"
+#include "AliyunRootCa.h"
+#include "StaticJsonPool.h"
+#include "DeferredLog.h"
+#include "PropertyRegistry.h"
+#include "AlarmChannel.h"
+#include "AlarmLatch.h"
+#include "DesiredState.h"
+#include "WifiLink.h"
+#include "BootTimeline.h"
+#include "BrokerResolver.h"
+#include "SeqlockSnapshot.h"
+#include <LittleFS.h>
+#include <esp_timer.h>
+#include <esp_random.h>
+#include <time.h>
+#include <sys/time.h>
 
 //----------------------------------------
 // 引脚定义
@@ -29,6 +59,26 @@
 #define KEY2 38             // 按键引脚
 #define KEY3 39             // 按键3引脚
 
+// OLED显示参数（可通过build_flags覆盖）
+#ifndef OLED_BUS_CLOCK
+#define OLED_BUS_CLOCK 400000       // OLED I2C时钟（Hz），面板允许时可设为1000000
+#endif
+#ifndef OLED_TARGET_FPS
+#define OLED_TARGET_FPS 10          // 最大刷新帧率
+#endif
+#ifndef OLED_LOAD_BUDGET_US
+#define OLED_LOAD_BUDGET_US 50000   // 控制循环周期超过该值时跳帧（微秒）
+#endif
+#ifndef OLED_MIN_FPS
+#define OLED_MIN_FPS 1              // 高负载跳帧时的最低刷新帧率
+#endif
+#ifndef OLED_DIM_TIMEOUT_MS
+#define OLED_DIM_TIMEOUT_MS 30000   // 无操作多久后降低亮度（毫秒）
+#endif
+#ifndef OLED_OFF_TIMEOUT_MS
+#define OLED_OFF_TIMEOUT_MS 120000  // 无操作多久后关闭显示（毫秒）
+#endif
+
 // SHT30传感器引脚
 #define SHT30_SDA_PIN 3  // SHT30 SDA引脚
 #define SHT30_SCL_PIN 4  // SHT30 SCL引脚
@@ -36,25 +86,49 @@
 //----------------------------------------
 // 阿里云MQTT配置
 //----------------------------------------
+// 出厂默认三元组：设备NVS（命名空间aliyun）中没有写入三元组时使用
 #define PRODUCT_KEY       "a1kyhW4QQ1t"       // 替换为你的阿里云PRODUCT_KEY
 #define DEVICE_NAME       "ZNSGZS"            // 替换为你的阿里云DEVICE_NAME
 #define DEVICE_SECRET     "c15db7d20d58754ca996b7d2352a583d" // 替换为你的阿里云DEVICE_SECRET
 #define REGION_ID         "cn-shanghai"
 
-/* 线上环境域名和端口号 */
-#define MQTT_SERVER       PRODUCT_KEY".iot-as-mqtt."REGION_ID ".aliyuncs.com"
-#define MQTT_PORT         1883
-#define MQTT_USRNAME      DEVICE_NAME"&"PRODUCT_KEY
-
-// 这里需要根据阿里云生成的三元组信息修改
-#define CLIENT_ID         "a1kyhW4QQ1t.ZNSGZS|securemode=2,signmethod=hmacsha256,timestamp=1747019835103|"
-#define MQTT_PASSWD       "ae0dbce0965f1974fafd10eb9da3834db870f6d1d2ca27d19ba08ca502224942" // 根据阿里云规则生成的密码
-
-// 阿里云主题定义
-#define ALI_TOPIC_PROP_POST     "/sys/" PRODUCT_KEY "/" DEVICE_NAME "/thing/event/property/post"
-#define ALI_TOPIC_PROP_SET      "/sys/" PRODUCT_KEY "/" DEVICE_NAME "/thing/service/property/set"
-#define ALI_TOPIC_PROP_POST_REPLY "/sys/" PRODUCT_KEY "/" DEVICE_NAME "/thing/event/property/post_reply"
-#define ALI_TOPIC_PROP_FORMAT   "{\"id\":\"%u\",\"version\":\"1.0\",\"method\":\"thing.event.property.post\",\"params\":%s}"
+/* 线上环境端口号，域名、clientId、用户名和密码由DeviceIdentity在运行时生成 */
+#define MQTT_PORT         1883                // TCP直连（securemode=3），只在定义MQTT_PLAINTEXT时使用
+#define MQTT_TLS_PORT     8883                // TLS直连（securemode=2）
+// 默认走TLS，阿里云根证书编译在固件里（AliyunRootCa.h）；LittleFS中有这个文件时用它代替
+// （用 pio run -t uploadfs 写入，根证书更换时不必重新烧录）。
+// 编译时加 -DMQTT_PLAINTEXT 才改用TCP直连，报文明文传输，只用于调试
+#define MQTT_CA_CERT_PATH "/certs/aliyun_root_ca.pem"
+// 备用服务器：编译时加 -DMQTT_FALLBACK_HOST=\"...\" 作为云端备用域名（端口和加密方式与主域名相同）；
+// 加 -DMQTT_LAN_BROKER=\"192.168.1.10\" 在云端连不上时改连局域网内的MQTT桥接服务器（TCP直连），
+// 桥接服务器用它自己的阿里云账号把/sys/主题转发到云端。设备登录桥接服务器用局域网专用的账号
+// （-DMQTT_LAN_USERNAME=\"...\" -DMQTT_LAN_PASSWORD=\"...\"），三元组签名只发给云端的TLS连接
+#ifndef MQTT_LAN_PORT
+#define MQTT_LAN_PORT     1883
+#endif
+#if defined(MQTT_LAN_BROKER) && !(defined(MQTT_LAN_USERNAME) && defined(MQTT_LAN_PASSWORD))
+#error "MQTT_LAN_BROKER需要同时定义MQTT_LAN_USERNAME和MQTT_LAN_PASSWORD（局域网服务器的账号，不能用三元组）"
+#endif
+
+// 阿里云主题（按NVS中的三元组在运行时拼出）
+#define ALI_TOPIC_PROP_POST     identity.topic(DeviceIdentity::TOPIC_PROP_POST)
+#define ALI_TOPIC_PROP_SET      identity.topic(DeviceIdentity::TOPIC_PROP_SET)
+#define ALI_TOPIC_PROP_POST_REPLY identity.topic(DeviceIdentity::TOPIC_PROP_POST_REPLY)
+#define ALI_TOPIC_PROP_HISTORY_POST identity.topic(DeviceIdentity::TOPIC_HISTORY_POST)
+#define ALI_TOPIC_PROP_HISTORY_POST_REPLY identity.topic(DeviceIdentity::TOPIC_HISTORY_POST_REPLY)
+#define ALI_TOPIC_PROP_SET_REPLY identity.topic(DeviceIdentity::TOPIC_PROP_SET_REPLY)
+#define ALI_TOPIC_USER_UPDATE   identity.topic(DeviceIdentity::TOPIC_USER_UPDATE)   // 自定义主题，上报设备指标
+#define ALI_TOPIC_RAW_UP        identity.topic(DeviceIdentity::TOPIC_RAW_UP)
+#define ALI_TOPIC_RAW_UP_REPLY  identity.topic(DeviceIdentity::TOPIC_RAW_UP_REPLY)
+#define ALI_TOPIC_EVENT_FIRE_ALARM  identity.topic(DeviceIdentity::TOPIC_EVENT_FIRE_ALARM)
+#define ALI_TOPIC_EVENT_SMOKE_ALARM identity.topic(DeviceIdentity::TOPIC_EVENT_SMOKE_ALARM)
+#define ALI_TOPIC_EVENT_POST_REPLY  identity.topic(DeviceIdentity::TOPIC_EVENT_POST_REPLY)
+#define ALI_TOPIC_RRPC_REQUEST  identity.topic(DeviceIdentity::TOPIC_RRPC_REQUEST)
+#define ALI_TOPIC_RRPC_RESPONSE identity.topic(DeviceIdentity::TOPIC_RRPC_RESPONSE)    // 前缀，后接messageId
+#define ALI_TOPIC_DESIRED_GET   identity.topic(DeviceIdentity::TOPIC_DESIRED_GET)
+#define ALI_TOPIC_DESIRED_GET_REPLY identity.topic(DeviceIdentity::TOPIC_DESIRED_GET_REPLY)
+
+#define ALI_TOPIC_PROP_FORMAT   "{\"id\":\"%u\",\"version\":\"1.0\",\"method\":\"" TSL_METHOD_PROPERTY_POST "\",\"params\":%s}"
 
 //----------------------------------------
 // 全局对象初始化
@@ -62,17 +136,103 @@
 // 初始化OLED显示屏 SCL-21   SDA-40
 U8G2_SSD1306_128X64_NONAME_F_HW_I2C u8g2(U8G2_R0, /* reset=*/U8X8_PIN_NONE, /* clock=*/21, /* data=*/40);
 
+// 主页面数值区（u8x8瓦片直写），页面框架由u8g2整帧绘制
+TileReadout readout(u8g2, u8x8_font_chroma48medium8_r);
+int8_t fieldFlame, fieldMq2, fieldLux, fieldDb, fieldTemp, fieldHumid;
+bool mainChromeWifi = false;    // 框架绘制时的WiFi图标状态
+
+// 显示刷新调速器
+DisplayGovernor displayGovernor(OLED_TARGET_FPS, OLED_LOAD_BUDGET_US, OLED_MIN_FPS);
+
+// 显示屏电源管理（无操作降低亮度后关闭，按键或报警唤醒）
+DisplayPower displayPower(u8g2, OLED_DIM_TIMEOUT_MS, OLED_OFF_TIMEOUT_MS);
+unsigned long lastDisplayMetricsTime = 0;               // 上次输出显示指标时间
+const unsigned long displayMetricsInterval = 10000;     // 显示指标输出间隔（10秒）
+
+// 界面场景栈
+SceneManager scenes;
+
+// 界面事件
+enum UiEvent : uint8_t {
+  UI_EVT_NEXT_PAGE,       // 长按按键3，切换到下一页面
+  UI_EVT_CHECKIN_START,   // 查寝开始
+  UI_EVT_CHECKIN_END      // 查寝结束或被重置
+};
+
 // 初始化BH1750光照传感器
 BH1750 lightMeter(0x23);
 
 // 初始化软件串口用于指纹模块通信
 SoftwareSerial mySerial(12,13);    //软串口引脚，RX：GPIO12    TX：GPIO13
 
+// 设备身份（三元组、主题、连接签名）
+DeviceIdentity identity;
+
 // MQTT相关变量
 int postMsgId = 0; // 消息ID,每次上报属性时递增
-WiFiClient espClient; // 创建WiFiClient对象
-PubSubClient mqttClient(espClient); // 创建PubSubClient对象
-Ticker mqttTicker; // 创建定时器对象，用于定时上报数据
+Ticker mqttTicker; // 每秒触发一次属性上报检查（定时器任务中只置标志，上报在loop()中进行）
+volatile bool publishDue = false;
+const uint32_t propertyFullSyncInterval = 300000; // 全量属性同步间隔（5分钟）
+ChangeTracker propertyTracker(propertyFullSyncInterval); // 按变化上报属性
+const PropertyMask liveOnlyProperties = ChangeTracker::onChangeOnly(); // 阈值和执行器状态，变化后立即上报
+
+// 传感器样本批量上报（history.post），样本按开机毫秒数记录，发送时换算成UTC时间
+const uint8_t sampleBatchSize = 8;                 // 每批最多8条样本
+const uint32_t sampleBatchMaxAge = 30000;          // 最早一条样本最多等待30秒
+SampleBatch sampleBatch(sampleBatchSize, sampleBatchMaxAge);
+SampleBatch replayBatch(SampleBatch::MAX_SAMPLES, 0); // 补发未定时样本时读回用
+#define HISTORY_POST_BUFFER 3584                   // history.post报文缓冲区（8条传感器全量样本约2.3KB）
+char historyBuf[HISTORY_POST_BUFFER];              // 发送批次和补发未定时样本共用（都在loop()中）
+// 时间同步前的批次以二进制存入暂存队列，用这个本地主题区分，补发时换算时间后改发history.post
+#define OUTBOX_TOPIC_UNTIMED "local/untimed_samples"
+uint32_t bootId = 0;                               // 本次开机的随机编号，未定时样本只能在同一次开机内补上时间
+uint32_t untimedDropped = 0;                       // 重启前没等到时间同步、无法补时间而丢弃的批次数
+
+// 断网暂存：PSRAM缓冲64KB，溢出或放置超过1分钟写入LittleFS，闪存最多占用1MB（读数每秒都超出死区时每8秒一批约2.3KB，约1小时数据）
+Outbox outbox(65536, 32768, 1048576, 60000, 250);
+
+// 上报确认：5秒无post_reply重发，间隔倍增，重发2次后放弃
+PublishTracker publishTracker(5000, 2);
+// 报警事件：检测到状态变化后立即发送，2秒无应答重发，间隔倍增到30秒后保持，直到确认
+enum AlarmKindId { ALARM_FIRE, ALARM_SMOKE, ALARM_KIND_COUNT };
+const AlarmChannel::Kind ALARM_KINDS[ALARM_KIND_COUNT] = {
+  {TSL_EVENT_FIRE_ALARM,  "flame"},
+  {TSL_EVENT_SMOKE_ALARM, "smoke"},
+};
+AlarmChannel alarmChannel(ALARM_KINDS, ALARM_KIND_COUNT, 2000, 30000);
+
+// RRPC同步控制：执行后立即回读执行器实际状态作为应答（平台等待应答最多8秒）
+struct RrpcMetrics {
+  uint32_t requests;
+  uint32_t rejected;        // 解析失败或有类型错误的属性
+  uint32_t lastActuateUs;   // 收到请求到执行完成
+  uint32_t maxActuateUs;
+  uint32_t actuateSumUs;
+  uint32_t lastReplyUs;     // 收到请求到应答发出
+};
+RrpcMetrics rrpcMetrics = {0, 0, 0, 0, 0, 0};
+
+BootTimeline bootTimeline;                             // 启动各阶段距上电的时间
+bool networkStackStarted = false;                      // 存储和MQTT是否已初始化
+
+unsigned long lastDeviceMetricsTime = 0;               // 上次上报设备指标时间
+const unsigned long deviceMetricsInterval = 60000;     // 设备指标上报间隔（1分钟）
+
+// 下行消息解析：直接在MQTT接收缓冲区上解析，JSON节点放在静态内存池中，不使用堆
+#define INBOUND_JSON_POOL 4096                     // ArduinoJson 7按整块（约2KB）申请节点池，再加字符串
+alignas(void *) uint8_t inboundJsonBuf[INBOUND_JSON_POOL]; // 池中按指针对齐分配，缓冲区起点也要对齐
+StaticJsonPool inboundJsonPool(inboundJsonBuf, sizeof(inboundJsonBuf));
+JsonDocument inboundDoc(&inboundJsonPool);
+JsonDocument inboundFilter;                         // 只保留已知字段，启动时建立一次
+uint32_t inboundOverflows = 0;                      // 内存池不够导致的解析失败次数
+
+// 消息回调中的日志先写入缓冲，loop()中再输出到串口
+char deferredLogBuf[2048];
+DeferredLog deferredLog(deferredLogBuf, sizeof(deferredLogBuf));
+#define DEFERRED_LOG_ECHO 160                      // 日志中报文内容最多显示的字节数
+
+#define NTP_SERVER1 "ntp.aliyun.com"
+#define NTP_SERVER2 "ntp1.aliyun.com"
 
 // 初始化SHT30传感器（软件I2C方式）
 SoftI2C_SHT30 sht30(SHT30_SDA_PIN, SHT30_SCL_PIN);
@@ -94,11 +254,32 @@ int decibelThreshold = 80;           // 分贝阈值（dB）
 int flameThreshold = 50;             // 火焰阈值（0-100）
 int smokeThreshold = 60;             // 烟雾阈值（0-100）
 
-int currentPage = 0;         // 当前页面编号，0为主页面，1为添加指纹页面，2为删除指纹页面
-int fingerOption = 0;        // 指纹选项，0为添加指纹，1为删除指纹
 int fingerId = 1;            // 当前选择的指纹ID，默认为1
 int MAX_FINGER_ID = 6;       // 最大指纹ID数量
 
+// 最新传感器数据（由loop()定期采样，各页面和上报共享）
+struct SensorData {
+  float temperature;   // 温度（摄氏度）
+  float humidity;      // 湿度（百分比）
+  float lux;           // 光照强度（勒克斯）
+  int flameValue;      // 火焰值（0-100）
+  int mq2Value;        // 烟雾值（0-100）
+  int dB;              // 声音强度（0-100）
+  unsigned long sampledAt; // 采样时间（millis）
+};
+SensorData sensorData = {0, 0, 0, 0, 0, 0, 0};
+// 每次采样后整体发布的快照，上报等读者只读这里，不再自己读传感器
+SeqlockSnapshot<SensorData> sensorSnapshot;
+
+// 传感器历史数据（PSRAM）和曲线页面状态
+SensorHistory history;
+uint8_t graphChannel = SensorHistory::CH_TEMPERATURE;  // 当前显示的通道
+uint8_t graphTier = SensorHistory::TIER_SECOND;         // 当前显示的分辨率
+const char *const GRAPH_CHANNEL_NAMES[SensorHistory::CHANNEL_COUNT] = {
+  "Temp C", "Humid %", "Light lx", "Flame %", "Smoke %", "Noise dB"
+};
+const char *const GRAPH_TIER_NAMES[SensorHistory::TIER_COUNT] = {"10min", "24h"};
+
 // 添加时间管理变量
 unsigned long lastSensorReadTime = 0;  // 上次传感器读取时间
 const unsigned long sensorReadInterval = 100;  // 传感器读取间隔，100ms
@@ -107,6 +288,10 @@ const unsigned long sensorReadInterval = 100;  // 传感器读取间隔，100ms
 OneButton button1(KEY1, true); // KEY1按钮，参数true表示按下时为LOW电平
 OneButton button2(KEY2, true); // KEY2按钮，参数true表示按下时为LOW电平
 OneButton button3(KEY3, true); // KEY3按钮，参数true表示按下时为LOW电平
+// 显示屏关闭时按下的键只用来唤醒，松开之前不交给OneButton（黑屏时用户看不到按键会改变什么）
+bool button1Swallowed = false;
+bool button2Swallowed = false;
+bool button3Swallowed = false;
 
 bool fanState = false;      // 风扇的当前状态
 bool pumpState = false;     // 水泵的当前状态
@@ -116,6 +301,9 @@ bool pumpManualControl = false; // 水泵手动控制标志
 // 报警状态管理
 bool fireAlarmActive = false;     // 火灾报警状态
 bool smokeAlarmActive = false;      // 烟雾报警状态
+// 报警超过阈值立即触发，读数低于阈值5以下并保持5秒才解除，阈值附近抖动时不反复报警
+AlarmLatch fireLatch(5, 5000);
+AlarmLatch smokeLatch(5, 5000);
 
 // 查寝功能相关变量
 bool checkInModeActive = false;          // 查寝模式激活状态
@@ -132,6 +320,13 @@ unsigned long lastBuzzerToggleTime = 0;  // 上次蜂鸣器状态切换时间
 unsigned long buzzerToggleInterval = 500; // 蜂鸣器状态切换间隔（毫秒）
 bool buzzerState = false;          // 蜂鸣器当前状态（高/低）
 
+// 蜂鸣器提示音（非阻塞，报警时被报警音覆盖）
+uint8_t chirpRemaining = 0;             // 剩余响声次数
+unsigned long chirpOnTime = 0;          // 每声持续时间
+unsigned long chirpOffTime = 0;         // 两声间隔
+unsigned long chirpToggleTime = 0;      // 上次切换时间
+bool chirpLevel = false;                // 当前输出电平
+
 // 指纹模块状态
 bool enrollingFinger = false;     // 正在注册指纹
 bool deletingFinger = false;      // 正在删除指纹
@@ -139,9 +334,6 @@ unsigned long fingerOpStartTime = 0; // 指纹操作开始时间
 const unsigned long fingerOpTimeout = 10000; // 指纹操作超时时间(10秒)
 
 // 指纹操作反馈提示
-bool showFeedback = false;           // 是否显示反馈
-char feedbackMessage[50] = "";       // 反馈消息
-unsigned long feedbackStartTime = 0;  // 反馈开始时间
 const unsigned long feedbackDisplayTime = 2000; // 反馈显示时间(2秒)
 
 // FPM383C指纹模块命令数组
@@ -155,38 +347,73 @@ uint8_t PS_EmptyBuffer[12] = {0xEF,0x01,0xFF,0xFF,0xFF,0xFF,0x01,0x00,0x03,0x0D,
 uint8_t PS_CancelBuffer[12] = {0xEF,0x01,0xFF,0xFF,0xFF,0xFF,0x01,0x00,0x03,0x30,0x00,0x34};
 uint8_t PS_ReceiveBuffer[20]; // 接收数据缓冲区
 
-// WiFi连接相关变量
-const char* ssid = "12345";           // WiFi名称
-const char* password = "00000000";       // WiFi密码
-bool wifiConnected = false;              // WiFi连接状态
-unsigned long lastWiFiCheckTime = 0;     // 上次WiFi检查时间
-const unsigned long wifiCheckInterval = 5000;  // WiFi检查间隔时间(5秒)
-int wifiSignalStrength = 0;              // WiFi信号强度(RSSI值)
+// WiFi网络（名称、密码），可配置多个，连接时选信号最强的
+const char *const wifiNetworks[][2] = {
+  {"12345", "00000000"},
+};
+// 静态IP：编译时加 -DWIFI_STATIC_IP 并修改下面的地址，不加则使用DHCP
+#ifdef WIFI_STATIC_IP
+const IPAddress wifiStaticIp(192, 168, 1, 200);
+const IPAddress wifiGateway(192, 168, 1, 1);
+const IPAddress wifiSubnet(255, 255, 255, 0);
+const IPAddress wifiDns(192, 168, 1, 1);
+#endif
+WifiLink wifiLink(1000, 30000);          // 连接失败后1秒起重试，最长30秒
 bool showingWiFiPage = false;            // 是否显示WiFi页面
 
-// MQTT连接状态和数据上传间隔
-bool mqtt_connected = false;
-unsigned long lastMqttReconnectAttempt = 0;
-const unsigned long mqttReconnectInterval = 5000;  // 重连间隔5秒
-unsigned long lastDataUploadTime = 0;
-const unsigned long dataUploadInterval = 10000;    // 每10秒上传一次数据
+// MQTT连接管理（指数退避重连，连接在后端的任务中进行，不阻塞loop()）
+const uint32_t mqttMinBackoff = 2000;      // 首次重连等待2秒
+const uint32_t mqttMaxBackoff = 120000;    // 最长重连等待2分钟
+const uint32_t mqttConnectTimeout = 20000; // 一次连接最长等待（TCP连接+TLS握手10秒+CONNACK）
+const uint16_t mqttSocketTimeout = 3;      // 单次连接等待CONNACK的超时时间（秒）
+const uint16_t mqttBufferSize = 4096;      // MQTT收发缓冲区大小（需放下一批history.post）
+#define PROPERTY_POST_BUFFER 512           // 属性上报报文缓冲区（全部属性约350字节）
+
+// MQTT传输后端：默认PubSubClient（独立连接任务，收发在loop()中）；
+// 编译时加 -DMQTT_USE_ESP_MQTT 改用esp-mqtt（独立任务+发送队列）
+#ifdef MQTT_USE_ESP_MQTT
+EspMqttTransport mqttClient(mqttBufferSize);
+const char *mqttCaCert = nullptr; // TLS服务器使用的CA证书，局域网服务器连接时不设置
+#else
+WiFiClient espClient; // 创建WiFiClient对象
+TlsClient tlsClient;  // TLS连接（带会话复用），有CA证书时使用
+PubSubTransport mqttClient(espClient, mqttBufferSize, mqttSocketTimeout);
+#endif
+MqttConnection mqttConnection(mqttClient, mqttMinBackoff, mqttMaxBackoff, mqttConnectTimeout);
+// 服务器地址缓存1小时，同一服务器连续失败3次换下一个，连在局域网服务器上10分钟后切回云端
+BrokerResolver brokerResolver(3600, 3, 600000);
 
 //----------------------------------------
 // 函数声明
 //----------------------------------------
-void displayData(float temperature, float humidity, float lux, int flameValue, int mq2Value, int dB);
+void drawMainChrome(); // 绘制主页面静态框架
+void reportDisplayMetrics(); // 输出显示性能指标
+void updateDisplayPower(); // 显示屏休眠与唤醒
+void tickButton(OneButton &button, uint8_t pin, bool &swallowed); // 按键检测（跳过唤醒显示屏的那次按下）
 void handleButton();
 void handleButton3();
 void readSensors(float &temperature, float &humidity, float &lux, int &flameValue, int &mq2Value, int &dB);
-void displayFingerPage(); // 显示指纹管理页面
+void sampleSensors(); // 采样传感器并执行自动控制
+void startChirp(uint8_t count, unsigned long onMs, unsigned long offMs); // 非阻塞提示音
 void addFinger();  // 添加指纹功能
 void deleteFinger(); // 删除指纹功能
-void displayFeedback(); // 显示操作反馈
+void showFeedback(const char *message); // 显示操作反馈
 void startCheckInMode(); // 开始查寝模式
 void handleCheckInMode(); // 处理查寝模式
 void resetCheckInStatus(); // 重置查寝状态
 void reportCheckInResult(); // 上报查寝结果
-void displayCheckInPage(); // 显示查寝页面
+
+// 界面场景
+void renderMainScene(bool full); // 主页面
+uint32_t mainSceneKey();
+void renderFingerScene(bool full); // 指纹管理页面
+uint32_t fingerSceneKey();
+void resetFingerScene();
+void renderCheckInScene(bool full); // 查寝页面
+uint32_t checkInSceneKey();
+void renderGraphScene(bool full); // 历史曲线页面
+uint32_t graphSceneKey();
+void renderToast(const char *text); // 定时提示
 
 // 按钮回调函数
 void toggleLight(); // 切换灯的状态
@@ -196,6 +423,8 @@ void togglePump(); // 切换水泵状态
 void nextFingerId(); // 切换下一个指纹ID
 void previousFingerId(); // 切换上一个指纹ID
 void confirmFingerOperation(); // 确认指纹操作
+void onButton3Click(); // 按键3短按（按页面分发）
+void onButton3DoubleClick(); // 按键3双击（按页面分发）
 
 // 指纹模块相关函数
 void FPM383C_SendData(int len, uint8_t PS_Databuffer[]); // 发送数据到指纹模块
@@ -208,13 +437,54 @@ uint8_t PS_Empty(); // 清空所有指纹
 uint8_t PS_Cancel(); // 取消当前操作
 
 // WiFi相关函数
-void connectToWiFi();                   // 连接WiFi
-void checkWiFiStatus();                 // 检查WiFi状态
+void beginWiFi();                       // 配置网络并开始连接（不等待）
+void startNetworkStack();               // 初始化存储和MQTT（loop()中执行一次）
+void onWifiStateChange(WifiLink::State state); // WiFi连接状态变化
 
 // MQTT相关函数
-void connectToAliyun();
+void onMqttStateChange(MqttConnection::State state, int error); // 连接状态变化
+void onMqttConnected(); // 连接成功后订阅主题
+bool signMqttCredentials(); // 连接前生成签名
+const char *loadMqttCaCert(); // 取MQTT的CA证书（LittleFS中的文件或编译进固件的根证书）
 void mqttCallback(char* topic, byte* payload, unsigned int length);
+void buildInboundFilter(); // 建立下行报文的字段过滤器
+
+// 属性设置函数
+void setStartCheckIn(PropertyValue value);
+void setResetCheckIn(PropertyValue value);
+void setLightState(PropertyValue value);
+void setFanState(PropertyValue value);
+void setPumpState(PropertyValue value);
+void setTemperatureThreshold(PropertyValue value);
+void setHumidityThreshold(PropertyValue value);
+void setLightThreshold(PropertyValue value);
+void setDecibelThreshold(PropertyValue value);
+void setFlameThreshold(PropertyValue value);
+void setSmokeThreshold(PropertyValue value);
 void publishSensorData();
+void requestSensorPublish(); // 定时器回调：标记需要检查属性上报
+void flushSampleBatch(bool online); // 发送批量样本
+bool publishOutboxRecord(const char *topic, const uint8_t *payload, size_t length); // 补发暂存报文
+bool publishTracked(const char *topic, const uint8_t *payload, size_t length); // 发布并等待post_reply
+bool republishTracked(const char *topic, const uint8_t *payload, size_t length); // 超时重发
+bool onPublishExpired(const char *topic, const uint8_t *payload, size_t length); // 重发用尽
+void handlePostReply(const byte *payload, unsigned int length); // 处理post_reply
+bool publishAlarmEvent(uint8_t kind, const uint8_t *payload, size_t length); // 发送报警事件
+void handleAlarmReply(const byte *payload, unsigned int length); // 处理报警事件的post_reply
+bool isReplyTopic(const char *topic, const char *postTopic); // 判断是否为某个主题的_reply
+void handleRrpcRequest(const char *topic, const byte *payload, unsigned int length); // 处理RRPC控制请求
+void requestDesiredState(); // 连接后拉取期望属性值
+void reportBootTimeline(); // 上报启动时间线（每次启动一次）
+void handleDesiredReply(const byte *payload, unsigned int length); // 应用期望属性值
+void rememberSetting(size_t index, PropertyValue value); // 属性设置后保存需要保留的值
+void reportDeviceMetrics(); // 上报设备指标
+uint64_t epochMillis(); // 当前UTC毫秒时间，未同步时返回0
+uint64_t uptimeMillis(); // 开机以来的毫秒数（不回绕）
+void fillPropertyFrame(PropertyFrame &frame, float temperature, float humidity, float lux,
+                       int flameValue, int mq2Value, int dB); // 填充属性帧
+#ifdef PROPERTY_CODEC_BENCH
+void benchmarkPropertyCodec(); // 属性编码耗时对比
+#endif
 
 //----------------------------------------
 // 蜂鸣器控制函数
@@ -223,10 +493,24 @@ void handleBuzzer() {
   // 如果存在报警事件，激活蜂鸣器
   if (fireAlarmActive || smokeAlarmActive) {
     buzzerActive = true;
+    chirpRemaining = 0; // 报警音优先，取消提示音
   } else {
     // 如果所有报警解除，停止蜂鸣器
     buzzerActive = false;
     buzzerState = false;
+
+    // 没有报警时播放提示音
+    if (chirpRemaining > 0) {
+      unsigned long currentTime = millis();
+      if (currentTime - chirpToggleTime >= (chirpLevel ? chirpOnTime : chirpOffTime)) {
+        chirpLevel = !chirpLevel;
+        chirpToggleTime = currentTime;
+        if (!chirpLevel) chirpRemaining--; // 一声结束
+      }
+      digitalWrite(BUZZER_PIN, (chirpRemaining > 0 && chirpLevel) ? HIGH : LOW);
+      return;
+    }
+
     digitalWrite(BUZZER_PIN, LOW);
     return;
   }
@@ -244,16 +528,167 @@ void handleBuzzer() {
   }
 }
 
+//----------------------------------------
+// 采样传感器并执行自动控制
+//----------------------------------------
+void sampleSensors()
+{
+  bool wasFireAlarm = fireAlarmActive;
+  bool wasSmokeAlarm = smokeAlarmActive;
+  
+  // 读取所有传感器数据
+  readSensors(sensorData.temperature, sensorData.humidity, sensorData.lux,
+              sensorData.flameValue, sensorData.mq2Value, sensorData.dB);
+  sensorData.sampledAt = millis();
+  sensorSnapshot.write(sensorData);
+  
+  // 记录历史数据（按通道顺序）
+  const float historyValues[SensorHistory::CHANNEL_COUNT] = {
+    sensorData.temperature, sensorData.humidity, sensorData.lux,
+    (float)sensorData.flameValue, (float)sensorData.mq2Value, (float)sensorData.dB
+  };
+  history.append(millis(), historyValues);
+  
+  // 温度检测 - 温度大于阈值自动打开风扇
+  if (sensorData.temperature > temperatureThreshold) {
+    // 打开风扇
+    digitalWrite(FAN_PIN, HIGH);
+    fanState = true;
+    fanManualControl = false; // 自动控制模式
+  } else{
+    // 只有在非手动控制模式下才自动关闭风扇
+    if (!fanManualControl) {
+      digitalWrite(FAN_PIN, LOW);
+      fanState = false;
+    }
+  }
+  
+  // 湿度检测 - 湿度大于阈值可以添加相应操作
+  if (sensorData.humidity > humidityThreshold) {
+    // 这里可以添加湿度过高时的操作，例如打开风扇或其他设备
+  }
+  
+  // 火灾检测 - 火焰值大于阈值自动打开水泵（解除带回差和保持时间）
+  fireAlarmActive = fireLatch.update(sensorData.flameValue, flameThreshold, millis());
+  if (fireAlarmActive) {
+    // 打开水泵
+    digitalWrite(PUMP_PIN, HIGH);
+    pumpState = true;
+    pumpManualControl = false; // 自动控制模式
+  } else {
+    // 火灾解除，只有在非手动控制模式下才自动关闭水泵
+    if (!pumpManualControl) {
+      digitalWrite(PUMP_PIN, LOW);
+      pumpState = false;
+    }
+  }
+  
+  // 烟雾泄漏检测 - MQ-2值大于阈值自动打开风扇（解除带回差和保持时间）
+  smokeAlarmActive = smokeLatch.update(sensorData.mq2Value, smokeThreshold, millis());
+  if (smokeAlarmActive) {
+    // 打开风扇
+    digitalWrite(FAN_PIN, HIGH);
+    fanState = true;
+    fanManualControl = false; // 自动控制模式
+  } else {
+    // 烟雾泄漏解除，只有在非手动控制模式下才自动关闭风扇
+    if (!fanManualControl) {
+      digitalWrite(FAN_PIN, LOW);
+      fanState = false;
+    }
+  }
+  
+  // 报警触发或解除时生成事件，带上当时的读数
+  if (fireAlarmActive != wasFireAlarm) {
+    AlarmChannel::Snapshot snapshot = {sensorData.flameValue, flameThreshold, sensorData.temperature};
+    alarmChannel.raise(ALARM_FIRE, fireAlarmActive, snapshot, epochMillis(), millis());
+  }
+  if (smokeAlarmActive != wasSmokeAlarm) {
+    AlarmChannel::Snapshot snapshot = {sensorData.mq2Value, smokeThreshold, sensorData.temperature};
+    alarmChannel.raise(ALARM_SMOKE, smokeAlarmActive, snapshot, epochMillis(), millis());
+  }
+}
+
+//----------------------------------------
+// 启动非阻塞提示音
+//----------------------------------------
+void startChirp(uint8_t count, unsigned long onMs, unsigned long offMs) {
+  chirpRemaining = count;
+  chirpOnTime = onMs;
+  chirpOffTime = offMs;
+  chirpLevel = true;
+  chirpToggleTime = millis();
+  if (!fireAlarmActive && !smokeAlarmActive) {
+    digitalWrite(BUZZER_PIN, HIGH);
+  }
+}
+
+//----------------------------------------
+// 界面场景定义
+//----------------------------------------
+const Scene SCENE_MAIN = {"main", nullptr, nullptr, mainSceneKey, renderMainScene};
+const Scene SCENE_ADD_FINGER = {"addFinger", resetFingerScene, nullptr, fingerSceneKey, renderFingerScene};
+const Scene SCENE_DELETE_FINGER = {"deleteFinger", resetFingerScene, resetFingerScene, fingerSceneKey, renderFingerScene};
+const Scene SCENE_CHECK_IN = {"checkIn", nullptr, nullptr, checkInSceneKey, renderCheckInScene};
+const Scene SCENE_GRAPH = {"graph", nullptr, nullptr, graphSceneKey, renderGraphScene};
+
+// 页面切换表：长按按键3在四个页面间循环，查寝模式压栈显示
+const SceneTransition SCENE_TRANSITIONS[] = {
+  {&SCENE_MAIN,          UI_EVT_NEXT_PAGE,     SCENE_REPLACE, &SCENE_GRAPH},
+  {&SCENE_GRAPH,         UI_EVT_NEXT_PAGE,     SCENE_REPLACE, &SCENE_ADD_FINGER},
+  {&SCENE_ADD_FINGER,    UI_EVT_NEXT_PAGE,     SCENE_REPLACE, &SCENE_DELETE_FINGER},
+  {&SCENE_DELETE_FINGER, UI_EVT_NEXT_PAGE,     SCENE_REPLACE, &SCENE_MAIN},
+  {nullptr,              UI_EVT_CHECKIN_START, SCENE_PUSH,    &SCENE_CHECK_IN},
+  {&SCENE_CHECK_IN,      UI_EVT_CHECKIN_END,   SCENE_POP,     nullptr},
+};
+
+//----------------------------------------
+// 可设置属性表（thing.service.property.set）
+// 类型和取值范围来自物模型（ThingModelTsl.h）
+//----------------------------------------
+const SettableProperty SETTABLE_PROPERTIES[] = {
+  TSL_SETTABLE(startCheckIn,         setStartCheckIn,         SETTABLE_COMMAND),
+  TSL_SETTABLE(resetCheckIn,         setResetCheckIn,         SETTABLE_COMMAND),
+  TSL_SETTABLE(lightState,           setLightState,           0),
+  TSL_SETTABLE(fanState,             setFanState,             0),
+  TSL_SETTABLE(pumpState,            setPumpState,            0),
+  TSL_SETTABLE(temperatureThreshold, setTemperatureThreshold, SETTABLE_RETAINED),
+  TSL_SETTABLE(humidityThreshold,    setHumidityThreshold,    SETTABLE_RETAINED),
+  TSL_SETTABLE(lightThreshold,       setLightThreshold,       SETTABLE_RETAINED),
+  TSL_SETTABLE(decibelThreshold,     setDecibelThreshold,     SETTABLE_RETAINED),
+  TSL_SETTABLE(flameThreshold,       setFlameThreshold,       SETTABLE_RETAINED),
+  TSL_SETTABLE(smokeThreshold,       setSmokeThreshold,       SETTABLE_RETAINED),
+};
+PropertyRegistry propertyRegistry(SETTABLE_PROPERTIES, sizeof(SETTABLE_PROPERTIES) / sizeof(SETTABLE_PROPERTIES[0]));
+
+// 期望属性值：每次连接后一次取回，等待应答期间（最多3秒）执行器和阈值不单独上报
+DesiredState desiredState(propertyRegistry, 3000);
+
 //----------------------------------------
 // 初始化设置
 void setup()
 {
+  bootTimeline.mark("setup");
+  bootId = esp_random();
+  
+  // 执行器先置为安全状态
+  pinMode(LIGHT_PIN, OUTPUT);        // LED灯
+  pinMode(FAN_PIN, OUTPUT);          // 风扇
+  pinMode(PUMP_PIN, OUTPUT);         // 水泵
+  pinMode(BUZZER_PIN, OUTPUT);       // 蜂鸣器引脚设置为输出
+  digitalWrite(PUMP_PIN, LOW);       // 水泵初始状态为关闭
+  digitalWrite(BUZZER_PIN, LOW);     // 蜂鸣器初始状态为关闭
+  
+  // 设置输入引脚
+  pinMode(FLAME_SENSOR_PIN, INPUT);  // 火焰传感器
+  pinMode(MQ2_SENSOR_PIN, INPUT);    // MQ-2气体传感器
+  pinMode(KEY1, INPUT);              // 按键1
+  pinMode(KEY2, INPUT);              // 按键2
+  pinMode(KEY3, INPUT);              // 按键3
+  pinMode(VOICE, INPUT);             // max4466语音传感器
+  
   // 初始化串口通信
   Serial.begin(115200);  // 初始化串口用于调试
-  
-  // 初始化OLED显示屏
-  u8g2.begin(); 
-  u8g2.enableUTF8Print();  // 启用UTF8打印，支持中文显示
 
   // 初始化I2C总线，指定SDA和SCL引脚
   Wire1.begin(15, 41);  // SDA=15, SCL=41
@@ -264,36 +699,54 @@ void setup()
   // 初始化SHT30传感器
   sht30.begin();
 
+  // 恢复上次保存的阈值，之后每次设置都保存
+  if (!propertyRegistry.begin()) {
+    Serial.println("可设置属性表有重名或超出索引容量");
+  }
+  desiredState.begin();
+  propertyRegistry.onApplied(rememberSetting);
+  bootTimeline.mark("sensors");
+
+  // 分配历史数据缓冲区（PSRAM）
+  if (!history.begin()) {
+    Serial.println("历史数据缓冲区分配失败");
+  }
+
+  // 立即采样一次，火焰/烟雾报警和自动控制从这里开始生效，不等网络
+  sampleSensors();
+  lastSensorReadTime = millis();
+  bootTimeline.mark("armed");
+  
+  // 初始化OLED显示屏（总线时钟需在begin之前设置）
+  u8g2.setBusClock(OLED_BUS_CLOCK);
+  u8g2.begin(); 
+  u8g2.enableUTF8Print();  // 启用UTF8打印，支持中文显示
+  displayPower.begin();
+
+  // 注册主页面数值字段（瓦片列、瓦片行、宽度）
+  fieldFlame = readout.addField(2, 3, 3);   // 火焰 0-100
+  fieldMq2 = readout.addField(11, 3, 3);    // MQ-2 0-100
+  fieldLux = readout.addField(2, 5, 5);     // 光照 0-65535
+  fieldDb = readout.addField(11, 5, 3);     // 分贝 0-100
+  fieldTemp = readout.addField(2, 7, 5);    // 温度 -40.0~125.0
+  fieldHumid = readout.addField(10, 7, 5);  // 湿度 0.0~100.0
+
   // 初始化指纹模块串口
   mySerial.begin(57600);
 
-  // 设置输入引脚
-  pinMode(FLAME_SENSOR_PIN, INPUT);  // 火焰传感器
-  pinMode(MQ2_SENSOR_PIN, INPUT);    // MQ-2气体传感器
-  pinMode(KEY1, INPUT);              // 按键1
-  pinMode(KEY2, INPUT);              // 按键2
-  pinMode(KEY3, INPUT);              // 按键3
-  pinMode(VOICE, INPUT);             // max4466语音传感器
-  
-  // 设置输出引脚
-  pinMode(LIGHT_PIN, OUTPUT);        // LED灯
-  pinMode(FAN_PIN, OUTPUT);          // 风扇
-  pinMode(PUMP_PIN, OUTPUT);         // 水泵
-  pinMode(BUZZER_PIN, OUTPUT);       // 蜂鸣器引脚设置为输出
-  
-  // 初始化输出设备状态
-  digitalWrite(PUMP_PIN, LOW);       // 水泵初始状态为关闭
-  digitalWrite(BUZZER_PIN, LOW);     // 蜂鸣器初始状态为关闭
-  
   // 配置按钮事件回调
   button1.attachClick(toggleLight); // 短按按钮1切换灯的状态
   button2.attachClick(toggleFan);   // 短按按钮2切换风扇的状态
   
   // 使用k3按钮控制指纹功能
-  button3.attachClick(nextFingerId); // 短按按钮3切换指纹ID
-  button3.attachDoubleClick(confirmFingerOperation); // 双击按钮3执行指纹操作
+  button3.attachClick(onButton3Click); // 短按按钮3切换指纹ID/曲线通道
+  button3.attachDoubleClick(onButton3DoubleClick); // 双击按钮3执行指纹操作/切换曲线时间范围
   button3.attachLongPressStart(switchPage); // 长按按钮3切换页面/模式
   
+  // 初始化界面场景栈
+  scenes.begin(&SCENE_MAIN, SCENE_TRANSITIONS, sizeof(SCENE_TRANSITIONS) / sizeof(SCENE_TRANSITIONS[0]),
+               &displayGovernor, renderToast);
+
   // 设置按钮长按检测时间（单位：毫秒）
   button3.setPressTicks(1500);
   
@@ -306,25 +759,85 @@ void setup()
   button1.setDebounceTicks(10); // 减少防抖时间为10ms
   button2.setDebounceTicks(10); // 减少防抖时间
   button3.setDebounceTicks(20); // 增加防抖时间以提高双击检测稳定性
+  bootTimeline.mark("ui");
   
-  // 初始化WiFi连接
-  connectToWiFi();
+  // 开始连接WiFi，结果由事件通知，不在这里等待
+  beginWiFi();
   
-  // 初始化MQTT客户端
-  mqttClient.setServer(MQTT_SERVER, MQTT_PORT);
-  mqttClient.setCallback(mqttCallback);
+  // SNTP对时，批量上报的样本需要UTC时间戳
+  configTime(0, 0, NTP_SERVER1, NTP_SERVER2);
+  bootTimeline.mark("wifi-start");
   
-  // 连接WiFi后连接OneNET
-  if (wifiConnected) {
-    connectToAliyun();
-    // 设置10秒定时上报数据
-    mqttTicker.attach(1, publishSensorData);
-    
-    // 初始化发送absentUsers默认值
-    char statusBuffer[128];
-    sprintf(statusBuffer, "{\"id\":\"%u\",\"version\":\"1.0\",\"method\":\"thing.event.property.post\",\"params\":{\"absentUsers\":\"未开启查寝\"}}", postMsgId++);
-    mqttClient.publish(ALI_TOPIC_PROP_POST, statusBuffer);
+  // 存储和MQTT在loop()画出第一帧之后再初始化（见startNetworkStack）
+}
+
+//----------------------------------------
+// 存储和MQTT初始化（在loop()中执行一次）
+// 挂载LittleFS（首次使用要格式化）、恢复暂存数据和解析CA证书都比较慢，
+// 放在第一次采样和第一帧画面之后，期间报警、自动控制和按键已经可用
+//----------------------------------------
+void startNetworkStack() {
+  // 挂载LittleFS（首次使用时格式化），恢复上次断网未发完的数据
+  if (!LittleFS.begin(true)) {
+    Serial.println("LittleFS挂载失败，断网数据只保存在内存中");
+  }
+  if (!outbox.begin()) {
+    Serial.println("暂存队列缓冲区分配失败");
+  }
+  if (!publishTracker.begin()) {
+    Serial.println("上报确认缓冲区分配失败");
   }
+  bootTimeline.mark("storage");
+  
+  // 从NVS加载设备三元组，生成服务器域名和主题
+  if (!identity.begin(PRODUCT_KEY, DEVICE_NAME, DEVICE_SECRET, REGION_ID)) {
+    Serial.println("NVS中没有完整的设备三元组，使用出厂默认值");
+  }
+  
+  // 云端连接走TLS，CA证书只在这里解析一次，重连时复用（PubSubClient后端还复用TLS会话）
+#ifdef MQTT_PLAINTEXT
+  uint16_t mqttPort = MQTT_PORT;
+  Serial.println("MQTT_PLAINTEXT：MQTT使用TCP直连，报文不加密");
+#else
+  uint16_t mqttPort = MQTT_TLS_PORT;
+  const char *caCert = loadMqttCaCert();
+#ifdef MQTT_USE_ESP_MQTT
+  mqttCaCert = caCert;
+#else
+  if (!tlsClient.loadCaCert(caCert)) {
+    Serial.printf("CA证书解析失败(%d)，无法连接阿里云\n", tlsClient.metrics().lastError);
+  }
+  mqttClient.setClient(tlsClient);
+#endif
+#endif
+  
+  // 服务器列表：云端域名在前，局域网桥接服务器最后；上次解析的地址从NVS恢复，连接时不再同步查DNS
+  bool cloudTls = mqttPort == MQTT_TLS_PORT;
+  brokerResolver.addEndpoint(identity.host(), mqttPort, cloudTls, false);
+#ifdef MQTT_FALLBACK_HOST
+  brokerResolver.addEndpoint(MQTT_FALLBACK_HOST, mqttPort, cloudTls, false);
+#endif
+#ifdef MQTT_LAN_BROKER
+  brokerResolver.addEndpoint(MQTT_LAN_BROKER, MQTT_LAN_PORT, false, true);
+#endif
+  brokerResolver.begin();
+  
+  // 初始化MQTT客户端，连接由mqttConnection在loop()中完成
+  buildInboundFilter();
+  mqttClient.begin(identity.host(), mqttPort, mqttCallback);
+#ifdef PROPERTY_CODEC_BENCH
+  benchmarkPropertyCodec();
+#endif
+  mqttConnection.setCredentials(identity.clientId(), identity.username(), identity.password());
+  mqttConnection.onPrepare(signMqttCredentials);
+  mqttConnection.onStateChange(onMqttStateChange);
+  mqttConnection.onConnected(onMqttConnected);
+  
+  // 每秒检查一次属性变化，只上报有变化或到期的属性
+  mqttTicker.attach(1, requestSensorPublish);
+  networkStackStarted = true;
+  bootTimeline.mark("mqtt-start");
+  bootTimeline.print(Serial);
 }
 
 //----------------------------------------
@@ -335,141 +848,95 @@ void loop()
   // 获取当前时间
   unsigned long currentTime = millis();
   
+  // 测量控制循环周期，供显示调速器判断负载
+  displayGovernor.loopTick();
+  
+  // 显示屏休眠与唤醒（在按键检测之前，唤醒用的那次按下不会触发操作）
+  updateDisplayPower();
+  
   // 检测按钮状态（高频率）
-  button1.tick();
-  button2.tick();
-  button3.tick();
+  tickButton(button1, KEY1, button1Swallowed);
+  tickButton(button2, KEY2, button2Swallowed);
+  tickButton(button3, KEY3, button3Swallowed);
   
-  // 检查WiFi状态（定期检查）
-  if (currentTime - lastWiFiCheckTime >= wifiCheckInterval) {
-    checkWiFiStatus();
-    lastWiFiCheckTime = currentTime;
+  // WiFi连接状态机（由WiFi事件驱动，不阻塞）
+  wifiLink.loop();
+  
+  // 定期上报设备指标（在显示指标清零峰值之前取值）
+  if (currentTime - lastDeviceMetricsTime >= deviceMetricsInterval) {
+    reportDeviceMetrics();
+    lastDeviceMetricsTime = currentTime;
   }
   
-  // 显示反馈信息（优先级最高）
-  if (showFeedback) {
-    displayFeedback();
-    
-    // 检查是否需要关闭反馈显示
-    if (currentTime - feedbackStartTime >= feedbackDisplayTime) {
-      showFeedback = false;
-    }
-    
-    // 在显示反馈时不执行其他显示操作
-    delay(10);
-    return;
+  // 定期输出显示性能指标
+  if (currentTime - lastDisplayMetricsTime >= displayMetricsInterval) {
+    reportDisplayMetrics();
+    lastDisplayMetricsTime = currentTime;
+  }
+  
+  // 传感器采样与自动控制（与当前页面无关，始终运行）
+  if (currentTime - lastSensorReadTime >= sensorReadInterval) {
+    sampleSensors();
+    lastSensorReadTime = currentTime; // 更新上次读取时间
   }
   
-  // 查寝模式处理（优先级第二）
+  // 报警事件优先发送（在补发和重发之前），未确认的按超时重发
+  alarmChannel.service(mqttConnection.connected(), millis(), publishAlarmEvent);
+  
+  // 处理蜂鸣器报警
+  handleBuzzer();
+  
+  // 查寝模式处理
   if (checkInModeActive) {
     handleCheckInMode();
-    delay(10);
-    return;
   }
   
-  // 根据当前页面显示不同内容
-  if (currentPage == 0) {
-    // 传感器数据变量
-    static float temperature = 0, humidity = 0, lux = 0;
-    static int flameValue = 0, mq2Value = 0, dB = 0;
-    
-    // 控制传感器读取频率
-    if (currentTime - lastSensorReadTime >= sensorReadInterval) {
-      // 读取所有传感器数据
-      readSensors(temperature, humidity, lux, flameValue, mq2Value, dB);
-      
-      // 温度检测 - 温度大于阈值自动打开风扇
-      if (temperature > temperatureThreshold) {
-        // 打开风扇
-        digitalWrite(FAN_PIN, HIGH);
-        fanState = true;
-        fanManualControl = false; // 自动控制模式
-      } else{
-        // 只有在非手动控制模式下才自动关闭风扇
-        if (!fanManualControl) {
-          digitalWrite(FAN_PIN, LOW);
-          fanState = false;
-        }
-      }
-      
-      // 湿度检测 - 湿度大于阈值可以添加相应操作
-      if (humidity > humidityThreshold) {
-        // 这里可以添加湿度过高时的操作，例如打开风扇或其他设备
-      }
-      
-      // 火灾检测 - 火焰值大于阈值自动打开水泵
-      if (flameValue > flameThreshold) {
-        // 打开水泵
-        digitalWrite(PUMP_PIN, HIGH);
-        pumpState = true;
-        pumpManualControl = false; // 自动控制模式
-        // 设置火灾报警状态
-        fireAlarmActive = true;
-      } else {
-        // 火灾解除
-        fireAlarmActive = false;
-        // 只有在非手动控制模式下才自动关闭水泵
-        if (!pumpManualControl) {
-          digitalWrite(PUMP_PIN, LOW);
-          pumpState = false;
-        }
-      }
-      
-      // 烟雾泄漏检测 - MQ-2值大于阈值自动打开风扇
-      if (mq2Value > smokeThreshold) {
-        // 打开风扇
-        digitalWrite(FAN_PIN, HIGH);
-        fanState = true;
-        fanManualControl = false; // 自动控制模式
-        // 设置烟雾泄漏报警状态
-        smokeAlarmActive = true;
-      } else {
-        // 烟雾泄漏解除
-        smokeAlarmActive = false;
-        // 只有在非手动控制模式下才自动关闭风扇
-        if (!fanManualControl) {
-          digitalWrite(FAN_PIN, LOW);
-          fanState = false;
-        }
-      }
-      
-      lastSensorReadTime = currentTime; // 更新上次读取时间
-    }
-    
-    // 处理蜂鸣器报警
-    handleBuzzer();
-    
-    // 显示所有传感器数据
-    displayData(temperature, humidity, lux, flameValue, mq2Value, dB);
-  } else if (currentPage == 1) {
-    // 显示添加指纹页面
-    displayFingerPage();
-    
-    // 根据当前状态处理指纹操作
-    if (enrollingFinger) {
-      // 处理添加指纹
-      addFinger();
-    }
-  } else if (currentPage == 2) {
-    // 显示删除指纹页面
-    displayFingerPage();
-    
-    // 处理删除指纹
-    if (deletingFinger) {
-      deleteFinger();
-    }
+  // 刷新界面（只在绑定状态变化时重绘，显示屏关闭时不产生总线传输）
+  if (displayPower.renderAllowed()) {
+    scenes.update();
+  }
+  
+  // 根据当前状态处理指纹操作
+  if (enrollingFinger) {
+    addFinger();
+  } else if (deletingFinger) {
+    deleteFinger();
+  }
+  
+  // 第一帧画完后再初始化存储和MQTT
+  if (!networkStackStarted) {
+    bootTimeline.mark("loop");
+    startNetworkStack();
   }
   
-  // MQTT连接维护
-  if (wifiConnected && !mqttClient.connected()) {
-    connectToAliyun();
+  // 服务器地址到期后异步重新解析；连在局域网服务器上太久时断开，切回云端
+  brokerResolver.loop(wifiLink.connected());
+  if (brokerResolver.shouldFailback()) {
+    Serial.println("尝试切回阿里云服务器");
+    mqttClient.disconnect();
   }
   
-  // 处理MQTT消息
-  if (mqttClient.connected()) {
-    mqttClient.loop();
+  // MQTT连接维护和消息处理（不阻塞，失败后按退避重连）
+  mqttConnection.loop(wifiLink.connected());
+  
+  // 属性上报与MQTT收发在同一个任务中，不会和mqttConnection.loop()同时操作客户端
+  if (publishDue) {
+    publishDue = false;
+    publishSensorData();
+  }
+  
+  // 断网暂存的数据写入闪存，连接后限速补发（等待确认的报文过多时暂停补发）
+  bool drainOutbox = mqttConnection.connected() && publishTracker.inflight() < PublishTracker::MAX_INFLIGHT / 2;
+  outbox.service(drainOutbox, millis(), publishOutboxRecord);
+  
+  // 等待post_reply超时的报文重发
+  if (mqttConnection.connected()) {
+    publishTracker.service(millis(), republishTracked, onPublishExpired);
   }
   
+  // 输出消息回调中记录的日志（串口发送缓冲有空间时才写）
+  deferredLog.flush(Serial, 256);
+  
   // 短暂延迟，减少CPU占用但保持按键灵敏度
   delay(10);
 }
@@ -542,46 +1009,31 @@ void togglePump() {
 // 切换页面和模式回调函数
 //----------------------------------------
 void switchPage() {
-  // 修改逻辑：在三个页面间循环切换
-  if (currentPage == 0) {
-    // 从主页面切换到添加指纹页面
-    currentPage = 1;
-    fingerOption = 0; // 设置为添加模式
-    fingerId = 1;     // 重置指纹ID为1
-  } else if (currentPage == 1) {
-    // 从添加指纹页面切换到删除指纹页面
-    currentPage = 2;
-    fingerOption = 1; // 设置为删除模式
-    fingerId = 1;     // 重置指纹ID为1
-  } else {
-    // 从删除指纹页面返回主页面
-    currentPage = 0;
-    fingerOption = 0; // 重置指纹选项
-    fingerId = 1;     // 重置指纹ID为1
-    enrollingFinger = false; // 取消任何正在进行的指纹操作
-    deletingFinger = false;
-    showFeedback = false;    // 取消任何反馈显示
-  }
-  
-  // 显示切换提示
-  u8g2.clearBuffer();
-  u8g2.setFont(u8g2_font_wqy16_t_gb2312);
-  u8g2.setCursor(0, 35);
-  if (currentPage == 0) {
-    u8g2.print("切换到主页面");
-  } else if (currentPage == 1) {
-    u8g2.print("切换到添加指纹");
-  } else {
-    u8g2.print("切换到删除指纹");
-  }
-  u8g2.sendBuffer();
-  delay(1000); // 显示1秒切换提示
+  // 由页面切换表决定目标页面，切换立即生效，不阻塞传感和网络
+  scenes.dispatch(UI_EVT_NEXT_PAGE);
+}
+
+//----------------------------------------
+// 指纹页面进入/离开时重置状态
+//----------------------------------------
+void resetFingerScene() {
+  fingerId = 1;            // 重置指纹ID为1
+  enrollingFinger = false; // 取消任何正在进行的指纹操作
+  deletingFinger = false;
+}
+//----------------------------------------
+// 指纹管理页面绑定状态
+//----------------------------------------
+uint32_t fingerSceneKey()
+{
+  uint32_t key = SceneManager::mix(2166136261UL, fingerId);
+  return SceneManager::mix(key, (enrollingFinger ? 1 : 0) | (deletingFinger ? 2 : 0));
 }
 
 //----------------------------------------
 // 显示指纹管理页面
 //----------------------------------------
-void displayFingerPage()
+void renderFingerScene(bool full)
 {
   // 清空OLED显示屏缓冲区
   u8g2.clearBuffer();
@@ -596,9 +1048,9 @@ void displayFingerPage()
   
   // 显示当前模式标题
   u8g2.setCursor(0, 30);
-  if (currentPage == 1) {
+  if (scenes.isCurrent(&SCENE_ADD_FINGER)) {
     u8g2.print("添加指纹模式");
-  } else if (currentPage == 2) {
+  } else {
     u8g2.print("删除指纹模式");
   }
   
@@ -643,28 +1095,21 @@ void addFinger()
   if (millis() - fingerOpStartTime > fingerOpTimeout) {
     // 超时，取消操作
     enrollingFinger = false;
-    strcpy(feedbackMessage, "添加指纹超时");
-    showFeedback = true;
-    feedbackStartTime = millis();
+    showFeedback("添加指纹超时");
     return;
   }
 
+  // 模块应答前会一直阻塞，先直接画出"正在处理"提示（不经过调速器和toast）
+  scenes.renderNow();
+  
   // 执行添加指纹操作
   uint8_t result = PS_AutoEnroll(fingerId - 1); // 注意ID从0开始，界面从1开始
   
   // 处理添加结果
   enrollingFinger = false;
-  if (result == 0x00) {
-    // 添加成功
-    strcpy(feedbackMessage, "指纹添加成功");
-  } else {
-    // 添加失败
-    strcpy(feedbackMessage, "指纹添加失败");
-  }
   
   // 显示反馈信息
-  showFeedback = true;
-  feedbackStartTime = millis();
+  showFeedback(result == 0x00 ? "指纹添加成功" : "指纹添加失败");
 }
 
 //----------------------------------------
@@ -679,79 +1124,218 @@ void deleteFinger()
   if (millis() - fingerOpStartTime > fingerOpTimeout) {
     // 超时，取消操作
     deletingFinger = false;
-    strcpy(feedbackMessage, "删除指纹超时");
-    showFeedback = true;
-    feedbackStartTime = millis();
+    showFeedback("删除指纹超时");
     return;
   }
 
+  // 模块应答前会一直阻塞，先直接画出"正在处理"提示
+  scenes.renderNow();
+  
   // 执行删除指纹操作
   uint8_t result = PS_Delete(fingerId - 1); // 注意ID从0开始，界面从1开始
   
   // 处理删除结果
   deletingFinger = false;
-  if (result == 0x00) {
-    // 删除成功
-    strcpy(feedbackMessage, "指纹删除成功");
-  } else {
-    // 删除失败
-    strcpy(feedbackMessage, "指纹删除失败");
-  }
   
   // 显示反馈信息
-  showFeedback = true;
-  feedbackStartTime = millis();
+  showFeedback(result == 0x00 ? "指纹删除成功" : "指纹删除失败");
 }
 
 //----------------------------------------
-// 在OLED上显示所有数据
+// 绘制主页面静态框架（标题、标签、单位）
 //----------------------------------------
-void displayData(float temperature, float humidity, float lux, int flameValue, int mq2Value, int dB)
+void drawMainChrome()
 {
   // 清空OLED显示屏缓冲区
   u8g2.clearBuffer();
 
-  // 显示标题（第一行）- 使用中文字体
+  // 显示标题（瓦片行0-1）- 使用中文字体
   u8g2.setFont(u8g2_font_wqy16_t_gb2312);
   u8g2.setCursor(12, 14);
   u8g2.print("智能舍管助手");
   
   // 在标题行右侧显示WiFi图标
-  if (wifiConnected) {
+  if (wifiLink.connected()) {
     // 使用符号字体绘制WiFi图标
     u8g2.setFont(u8g2_font_siji_t_6x10);
     u8g2.drawGlyph(110, 12, 0x0e21a); // WiFi图标的Unicode值
   }
 
-  // 切换到英文字体显示数据
-  u8g2.setFont(u8g2_font_ncenB08_tr);
+  // 标签和单位使用小字体，对齐到数值所在的瓦片行（3、5、7）
+  u8g2.setFont(u8g2_font_5x7_tr);
+  u8g2.drawStr(0, 30, "F:");
+  u8g2.drawStr(40, 30, "%");
+  u8g2.drawStr(64, 30, "MQ2:");
+  u8g2.drawStr(112, 30, "%");
+
+  u8g2.drawStr(0, 46, "L:");
+  u8g2.drawStr(56, 46, "lx");
+  u8g2.drawStr(72, 46, "dB:");
+  u8g2.drawStr(112, 46, "dB");
+
+  u8g2.drawStr(0, 62, "T:");
+  u8g2.drawStr(56, 62, "C");
+  u8g2.drawStr(64, 62, "H:");
+  u8g2.drawStr(120, 62, "%");
+
+  u8g2.sendBuffer();
+  mainChromeWifi = wifiLink.connected();
+
+  // 框架覆盖了数值区域，所有数值需要重新写入
+  readout.invalidate();
+}
+
+//----------------------------------------
+// 主页面绑定状态（显示精度下的传感器数据和WiFi图标）
+//----------------------------------------
+uint32_t mainSceneKey()
+{
+  uint32_t key = 2166136261UL;
+  key = SceneManager::mix(key, sensorData.flameValue);
+  key = SceneManager::mix(key, sensorData.mq2Value);
+  key = SceneManager::mix(key, (uint32_t)lroundf(sensorData.lux));
+  key = SceneManager::mix(key, sensorData.dB);
+  key = SceneManager::mix(key, (uint32_t)lroundf(sensorData.temperature * 10));
+  key = SceneManager::mix(key, (uint32_t)lroundf(sensorData.humidity * 10));
+  return SceneManager::mix(key, wifiLink.connected() ? 1 : 0);
+}
+
+//----------------------------------------
+// 在OLED上显示所有数据
+//----------------------------------------
+void renderMainScene(bool full)
+{
+  // 页面框架失效或WiFi图标变化时整帧刷新
+  if (full || mainChromeWifi != wifiLink.connected()) {
+    drawMainChrome();
+  }
+
+  // 更新数值，内容未变化的字段不会产生总线传输
+  readout.setInt(fieldFlame, sensorData.flameValue);
+  readout.setInt(fieldMq2, sensorData.mq2Value);
+  readout.setFloat(fieldLux, sensorData.lux, 0);
+  readout.setInt(fieldDb, sensorData.dB);
+  readout.setFloat(fieldTemp, sensorData.temperature, 1);
+  readout.setFloat(fieldHumid, sensorData.humidity, 1);
+
+  // 只把变化的瓦片写入显示RAM
+  readout.flush();
+}
+//----------------------------------------
+// 显示屏休眠与唤醒
+//----------------------------------------
+void updateDisplayPower()
+{
+  bool woken = false;
+  
+  // 任意按键按下立即唤醒（按键电平为低表示按下）；从关闭状态唤醒时这次按下不执行操作
+  bool key1 = digitalRead(KEY1) == LOW;
+  bool key2 = digitalRead(KEY2) == LOW;
+  bool key3 = digitalRead(KEY3) == LOW;
+  if (key1 || key2 || key3) {
+    woken = displayPower.wake();
+    if (woken) {
+      button1Swallowed |= key1;
+      button2Swallowed |= key2;
+      button3Swallowed |= key3;
+    }
+  }
   
-  // 显示火焰传感器和MQ-2传感器值（第二行）
-  u8g2.setCursor(0, 30);
-  u8g2.print("Flame: ");
-  u8g2.print(flameValue);
-  u8g2.print("%  MQ-2: ");
-  u8g2.print(mq2Value);
-  u8g2.print("%");
-
-  // 显示光照强度和分贝值（第三行）
-  u8g2.setCursor(0, 45);
-  u8g2.print("L: ");
-  u8g2.print(lux);
-  u8g2.print("lx");
-  u8g2.print("  dB: ");
-  u8g2.print(dB);
-  u8g2.print("dB");
-
-  // 显示温湿度值（第四行）
-  u8g2.setCursor(0, 60);
-  u8g2.print("T: ");
-  u8g2.print(temperature);
-  u8g2.print("C    ");
-  u8g2.print("H: ");
-  u8g2.print(humidity);
-  u8g2.print("%");
+  // 报警和查寝期间保持点亮
+  woken |= displayPower.hold(fireAlarmActive || smokeAlarmActive || checkInModeActive);
+  
+  // 关闭期间未刷新，唤醒后整帧重绘
+  if (woken) {
+    scenes.invalidate();
+  }
   
+  displayPower.update();
+}
+
+//----------------------------------------
+// 按键检测：被吞掉的按下在松开前不交给OneButton，松开后清掉它的状态再恢复检测
+//----------------------------------------
+void tickButton(OneButton &button, uint8_t pin, bool &swallowed)
+{
+  if (swallowed) {
+    if (digitalRead(pin) == LOW) return;
+    swallowed = false;
+    button.reset();
+  }
+  button.tick();
+}
+
+//----------------------------------------
+// 输出显示性能指标
+//----------------------------------------
+void reportDisplayMetrics()
+{
+  const DisplayGovernor::Metrics &m = displayGovernor.metrics();
+  Serial.printf("[display] frame=%luus avg=%luus max=%luus loop=%luus frames=%lu dropped=%lu\n",
+                (unsigned long)m.lastFrameUs, (unsigned long)m.avgFrameUs, (unsigned long)m.maxFrameUs,
+                (unsigned long)m.loopUs, (unsigned long)m.frames, (unsigned long)m.dropped);
+  displayGovernor.resetPeak();
+}
+
+//----------------------------------------
+// 历史曲线页面绑定状态（通道、分辨率和已提交的桶数量）
+//----------------------------------------
+uint32_t graphSceneKey()
+{
+  uint32_t key = SceneManager::mix(2166136261UL, graphChannel);
+  key = SceneManager::mix(key, graphTier);
+  return SceneManager::mix(key, history.version((SensorHistory::Tier)graphTier));
+}
+
+//----------------------------------------
+// 显示历史曲线页面
+//----------------------------------------
+void renderGraphScene(bool full)
+{
+  static SensorHistory::Summary cols[128];
+  const int plotTop = 18;       // 曲线区域上边界
+  const int plotBottom = 63;    // 曲线区域下边界
+
+  SensorHistory::Tier tier = (SensorHistory::Tier)graphTier;
+  SensorHistory::Channel channel = (SensorHistory::Channel)graphChannel;
+  uint16_t span = history.capacity(tier);
+
+  // 清空OLED显示屏缓冲区
+  u8g2.clearBuffer();
+  u8g2.setFont(u8g2_font_5x7_tr);
+
+  // 标题：通道名称和时间范围
+  u8g2.drawStr(0, 7, GRAPH_CHANNEL_NAMES[channel]);
+  u8g2.drawStr(100, 7, GRAPH_TIER_NAMES[tier]);
+
+  // 窗口统计直接由汇总桶计算
+  SensorHistory::Summary summary = history.summarize(tier, channel, span);
+  if (!summary.valid) {
+    u8g2.drawStr(0, 40, "No data yet");
+    u8g2.sendBuffer();
+    return;
+  }
+
+  char line[32];
+  snprintf(line, sizeof(line), "%.1f/%.1f/%.1f", summary.min, summary.avg, summary.max);
+  u8g2.drawStr(0, 15, line);
+
+  // 按显示宽度折叠成列，每列画出该时间段的最小-最大范围
+  uint8_t width = u8g2.getDisplayWidth();
+  history.columns(tier, channel, span, cols, width);
+
+  float low = summary.min;
+  float range = summary.max - summary.min;
+  if (range < 0.001f) range = 1.0f;
+  const int height = plotBottom - plotTop;
+
+  for (uint8_t x = 0; x < width; x++) {
+    if (!cols[x].valid) continue;
+    int yMin = plotBottom - (int)((cols[x].min - low) * height / range);
+    int yMax = plotBottom - (int)((cols[x].max - low) * height / range);
+    u8g2.drawVLine(x, yMax, yMin - yMax + 1);
+  }
+
   // 发送缓冲区内容到OLED显示屏
   u8g2.sendBuffer();
 }
@@ -866,19 +1450,36 @@ uint8_t PS_Empty()
 //----------------------------------------
 // 显示操作反馈
 //----------------------------------------
-void displayFeedback()
+void showFeedback(const char *message)
+{
+  scenes.toast(message, feedbackDisplayTime);
+}
+
+//----------------------------------------
+// 绘制定时提示（第二行以'\n'分隔）
+//----------------------------------------
+void renderToast(const char *text)
 {
   // 清空OLED显示屏缓冲区
   u8g2.clearBuffer();
   
-  // 使用中文字体显示反馈信息
+  // 使用中文字体显示提示信息
   u8g2.setFont(u8g2_font_wqy16_t_gb2312);
   
-  // 计算文本居中位置
-  int y = 35;
-  
-  u8g2.setCursor(0, y);
-  u8g2.print(feedbackMessage);
+  const char *lineBreak = strchr(text, '\n');
+  if (lineBreak == nullptr) {
+    u8g2.setCursor(0, 35);
+    u8g2.print(text);
+  } else {
+    char firstLine[SceneManager::TOAST_MAX_LEN];
+    size_t len = lineBreak - text;
+    memcpy(firstLine, text, len);
+    firstLine[len] = '\0';
+    u8g2.setCursor(0, 35);
+    u8g2.print(firstLine);
+    u8g2.setCursor(0, 55);
+    u8g2.print(lineBreak + 1);
+  }
   
   // 发送缓冲区内容到OLED显示屏
   u8g2.sendBuffer();
@@ -889,20 +1490,42 @@ void displayFeedback()
 //----------------------------------------
 void nextFingerId() {
   // 仅在指纹管理页面生效
-  if ((currentPage == 1 || currentPage == 2) && !enrollingFinger && !deletingFinger) {
+  if ((scenes.isCurrent(&SCENE_ADD_FINGER) || scenes.isCurrent(&SCENE_DELETE_FINGER)) && !enrollingFinger && !deletingFinger) {
     // 切换到下一个ID，循环切换
     fingerId = (fingerId % MAX_FINGER_ID) + 1;
   }
 }
 
 //----------------------------------------
-// 切换上一个指纹ID回调函数
+// 按键3短按：曲线页面切换通道，指纹页面切换ID
 //----------------------------------------
-void previousFingerId() {
-  // 仅在指纹管理页面生效，且未执行操作时
-  if ((currentPage == 1 || currentPage == 2) && !enrollingFinger && !deletingFinger) {
-    // 切换到上一个ID，循环切换
-    fingerId = (fingerId > 1) ? (fingerId - 1) : MAX_FINGER_ID;
+void onButton3Click() {
+  if (scenes.isCurrent(&SCENE_GRAPH)) {
+    graphChannel = (graphChannel + 1) % SensorHistory::CHANNEL_COUNT;
+  } else {
+    nextFingerId();
+  }
+}
+
+//----------------------------------------
+// 按键3双击：曲线页面切换时间范围，指纹页面执行操作
+//----------------------------------------
+void onButton3DoubleClick() {
+  if (scenes.isCurrent(&SCENE_GRAPH)) {
+    graphTier = (graphTier + 1) % SensorHistory::TIER_COUNT;
+  } else {
+    confirmFingerOperation();
+  }
+}
+
+//----------------------------------------
+// 切换上一个指纹ID回调函数
+//----------------------------------------
+void previousFingerId() {
+  // 仅在指纹管理页面生效，且未执行操作时
+  if ((scenes.isCurrent(&SCENE_ADD_FINGER) || scenes.isCurrent(&SCENE_DELETE_FINGER)) && !enrollingFinger && !deletingFinger) {
+    // 切换到上一个ID，循环切换
+    fingerId = (fingerId > 1) ? (fingerId - 1) : MAX_FINGER_ID;
   }
 }
 
@@ -911,309 +1534,845 @@ void previousFingerId() {
 //----------------------------------------
 void confirmFingerOperation() {
   // 仅在指纹管理页面生效，且未执行操作时
-  if ((currentPage == 1 || currentPage == 2) && !enrollingFinger && !deletingFinger) {
+  if ((scenes.isCurrent(&SCENE_ADD_FINGER) || scenes.isCurrent(&SCENE_DELETE_FINGER)) && !enrollingFinger && !deletingFinger) {
     // 设置操作状态并记录开始时间
-    if (currentPage == 1) {
+    if (scenes.isCurrent(&SCENE_ADD_FINGER)) {
       enrollingFinger = true; // 添加指纹
     } else {
       deletingFinger = true;  // 删除指纹
     }
     fingerOpStartTime = millis();
-    displayFingerPage(); // 更新页面提示正在处理
   }
 }
 
 //----------------------------------------
-// 连接阿里云物联网平台
+// 阿里云连接状态变化，提示到界面
 //----------------------------------------
-void connectToAliyun() {
-  if (!wifiConnected) return;  // 如果WiFi未连接，不尝试连接阿里云
-  
-  u8g2.clearBuffer();
-  u8g2.setFont(u8g2_font_wqy16_t_gb2312);
-  u8g2.setCursor(0, 35);
-  u8g2.print("连接阿里云中...");
-  u8g2.sendBuffer();
-  
-  // 尝试连接阿里云，重试5次
-  int retryCount = 0;
-  while (!mqttClient.connected() && retryCount < 5) {
-    Serial.println("连接阿里云MQTT服务器...");
-    
-    if (mqttClient.connect(CLIENT_ID, MQTT_USRNAME, MQTT_PASSWD)) {
-      Serial.println("成功连接到阿里云!");
+void onMqttStateChange(MqttConnection::State state, int error) {
+  switch (state) {
+    case MqttConnection::CONN_CONNECTING:
+      Serial.println("连接阿里云MQTT服务器...");
+      // 只在首次尝试时提示，重试期间不打扰当前页面
+      if (mqttConnection.failures() == 0) {
+        scenes.toast("连接阿里云中...", 1000);
+      }
+      break;
       
-      // 成功连接后订阅主题
-      mqttClient.subscribe(ALI_TOPIC_PROP_SET);
-      mqttClient.subscribe(ALI_TOPIC_PROP_POST_REPLY);
+    case MqttConnection::CONN_CONNECTED:
+      brokerResolver.connected();
+      Serial.printf("成功连接到%s!\n", brokerResolver.current().host);
+      scenes.toast("阿里云连接成功", 1000);
+      break;
       
-      u8g2.clearBuffer();
-      u8g2.setCursor(0, 35);
-      u8g2.print("阿里云连接成功");
-      u8g2.sendBuffer();
-      delay(1000);
+    case MqttConnection::CONN_BACKOFF: {
+      // 断线前发出的报文不会再收到应答
+      publishTracker.expireAll(onPublishExpired);
+      alarmChannel.requeue();
       
-      break;
-    } else {
-      retryCount++;
+      // 当前服务器连续失败，换下一个服务器立即重试
+      if (brokerResolver.failed()) {
+        Serial.printf("改连服务器%s:%u\n", brokerResolver.current().host, brokerResolver.current().port);
+        mqttConnection.retryNow();
+        break;
+      }
       Serial.print("连接失败，错误码：");
-      Serial.println(mqttClient.state());
-      delay(3000);
+      Serial.print(error);
+      Serial.print("，");
+      Serial.print(mqttConnection.backoffMs());
+      Serial.println("ms后重试");
+      
+      // 连续失败只提示一次
+      if (mqttConnection.failures() == 1) {
+        char message[SceneManager::TOAST_MAX_LEN];
+        snprintf(message, sizeof(message), "阿里云连接失败\n%lus后重试", (unsigned long)(mqttConnection.backoffMs() / 1000));
+        scenes.toast(message, 1500);
+      }
+      break;
     }
+      
+    case MqttConnection::CONN_WAIT_NETWORK:
+      publishTracker.expireAll(onPublishExpired);
+      alarmChannel.requeue();
+      Serial.println("等待WiFi连接...");
+      break;
+  }
+}
+
+//----------------------------------------
+// 每次连接前选择服务器：云端用三元组现场签名（时间同步后带时间戳），局域网服务器用它自己的账号
+//----------------------------------------
+bool signMqttCredentials() {
+  // 选择本次连接的服务器，有缓存的地址时直接按IP连接
+  IPAddress ip;
+  const BrokerResolver::Endpoint &endpoint = brokerResolver.select(ip);
+#ifdef MQTT_USE_ESP_MQTT
+  mqttClient.setCaCert(endpoint.tls ? mqttCaCert : nullptr);   // 先于setServer()，决定能否按IP连接
+#else
+  if (endpoint.tls) {
+    tlsClient.setHostname(endpoint.host);   // 按IP连接时用于SNI和证书校验
+    mqttClient.setClient(tlsClient);
+  } else {
+    mqttClient.setClient(espClient);
+  }
+#endif
+  mqttClient.setServer(endpoint.host, ip, endpoint.port);
+#ifdef MQTT_LAN_BROKER
+  if (endpoint.local) {
+    // 局域网连接不加密，三元组签名不能发给它
+    mqttConnection.setCredentials(identity.deviceName(), MQTT_LAN_USERNAME, MQTT_LAN_PASSWORD);
+    return true;
   }
+#endif
+  mqttConnection.setCredentials(identity.clientId(), identity.username(), identity.password());
+  identity.setSecureMode(endpoint.tls ? 2 : 3);
   
-  if (!mqttClient.connected()) {
-    u8g2.clearBuffer();
-    u8g2.setCursor(0, 35);
-    u8g2.print("阿里云连接失败");
-    u8g2.sendBuffer();
-    delay(1000);
+  if (!identity.sign(epochMillis())) {
+    Serial.println("生成阿里云连接签名失败");
+    return false;
   }
+  return true;
 }
 
+//----------------------------------------
+// 阿里云连接成功后订阅主题
+//----------------------------------------
+void onMqttConnected() {
+  // 成功连接后订阅主题
+  mqttClient.subscribe(ALI_TOPIC_PROP_SET);
+  mqttClient.subscribe(ALI_TOPIC_EVENT_POST_REPLY);  // 属性上报和报警事件的应答
+  mqttClient.subscribe(ALI_TOPIC_RRPC_REQUEST);
+  mqttClient.subscribe(ALI_TOPIC_PROP_HISTORY_POST_REPLY);
+  mqttClient.subscribe(ALI_TOPIC_DESIRED_GET_REPLY);
+#ifdef TELEMETRY_RAW_FRAME
+  mqttClient.subscribe(ALI_TOPIC_RAW_UP_REPLY);
+#endif
+  
+  // 每次启动第一次连上时上报启动时间线
+  if (bootTimeline.mark("mqtt")) {
+    reportBootTimeline();
+  }
+  
+  // 断线期间在云端设置的期望值一次取回；之后只上报与已上报值不同的属性，
+  // 断线前没有确认的上报在expireAll()时已经要求了全量同步
+  requestDesiredState();
+  
+  // 开机后首次连接时发送absentUsers默认值
+  static bool absentUsersAnnounced = false;
+  if (!absentUsersAnnounced && userCheckInStatus == 0) {
+    char statusBuffer[128];
+    sprintf(statusBuffer, "{\"id\":\"%u\",\"version\":\"1.0\",\"method\":\"" TSL_METHOD_PROPERTY_POST "\",\"params\":{\"" TSL_PROP_ABSENT_USERS "\":\"未开启查寝\"}}", postMsgId++);
+    absentUsersAnnounced = mqttClient.publish(ALI_TOPIC_PROP_POST, statusBuffer);
+  }
+}
 //----------------------------------------
 // MQTT回调函数-处理收到的消息
 //----------------------------------------
 void mqttCallback(char* topic, byte* payload, unsigned int length) {
-  Serial.print("收到消息 [");
-  Serial.print(topic);
-  Serial.print("] ");
+  // RRPC请求最先处理，执行后立即应答
+  const char *rrpcRequest = ALI_TOPIC_RRPC_REQUEST;
+  if (strncmp(topic, rrpcRequest, strlen(rrpcRequest) - 1) == 0) {
+    handleRrpcRequest(topic, payload, length);
+    return;
+  }
   
-  // 将payload转换为字符串
-  char message[length + 1];
-  for (unsigned int i = 0; i < length; i++) {
-    message[i] = (char)payload[i];
-    Serial.print((char)payload[i]);
+#ifdef TELEMETRY_RAW_FRAME
+  // 二进制上报的应答（由解析脚本从post_reply转换而来）
+  if (strcmp(topic, ALI_TOPIC_RAW_UP_REPLY) == 0) {
+    uint32_t id;
+    int code;
+    if (PropertyCodec::parseRawReply(payload, length, id, code)) {
+      if (code != 200) deferredLog.printf("上报被拒绝 id=%lu code=%d", (unsigned long)id, code);
+      publishTracker.acknowledge(id, code, millis());
+    }
+    return;
+  }
+#endif
+
+  // 日志延后输出，报文只记录开头部分
+  deferredLog.printf("收到消息 [%s] %u字节", topic, length);
+  deferredLog.line("  ", (const char *)payload, length, DEFERRED_LOG_ECHO);
+  
+  // 属性上报应答
+  if (strcmp(topic, ALI_TOPIC_PROP_POST_REPLY) == 0 || strcmp(topic, ALI_TOPIC_PROP_HISTORY_POST_REPLY) == 0) {
+    handlePostReply(payload, length);
+    return;
+  }
+  
+  // 期望属性值
+  if (strcmp(topic, ALI_TOPIC_DESIRED_GET_REPLY) == 0) {
+    handleDesiredReply(payload, length);
+    return;
+  }
+  
+  // 报警事件应答
+  if (isReplyTopic(topic, ALI_TOPIC_EVENT_FIRE_ALARM) || isReplyTopic(topic, ALI_TOPIC_EVENT_SMOKE_ALARM)) {
+    handleAlarmReply(payload, length);
+    return;
   }
-  message[length] = '\0';
-  Serial.println();
   
   // 处理属性设置请求 - 阿里云平台
   if (strcmp(topic, ALI_TOPIC_PROP_SET) == 0) {
-    DynamicJsonDocument doc(256);
-    DeserializationError error = deserializeJson(doc, message);
+    // 直接解析接收缓冲区，只保留过滤器中的字段；上一条消息的节点整体释放
+    JsonDocument &doc = inboundDoc;
+    doc.clear();
+    inboundJsonPool.reset();
+    DeserializationError error = deserializeJson(doc, (const char *)payload, length,
+                                                 DeserializationOption::Filter(inboundFilter));
     
     if (error) {
-      Serial.print("解析JSON失败: ");
-      Serial.println(error.c_str());
+      if (error == DeserializationError::NoMemory) inboundOverflows++;
+      deferredLog.printf("解析JSON失败: %s", error.c_str());
       return;
     }
     
-    // 提取消息ID
-    String msgId = doc["id"];
-    JsonObject params = doc["params"];
-    
-    // 处理查寝启动属性
-    if (params.containsKey("startCheckIn")) {
-      bool checkInFlag = (int)params["startCheckIn"] == 1;
-      
-      // 只在属性从0变为1时触发查寝（避免重复触发）
-      if (checkInFlag && !lastCheckInFlag && !checkInModeActive) {
-        startCheckInMode();
-        
-        // 上报正在查寝状态
-        char statusBuffer[128];
-        sprintf(statusBuffer, "{\"id\":\"%u\",\"version\":\"1.0\",\"method\":\"thing.event.property.post\",\"params\":{\"absentUsers\":\"正在查寝，请稍等...\"}}", postMsgId++);
-        mqttClient.publish(ALI_TOPIC_PROP_POST, statusBuffer);
-      }
-      lastCheckInFlag = checkInFlag;
-    }
-    
-    // 处理查寝重置属性
-    if (params.containsKey("resetCheckIn")) {
-      bool resetFlag = (int)params["resetCheckIn"] == 1;
-      
-      // 只在属性从0变为1时重置查寝状态
-      if (resetFlag && !lastResetCheckInFlag) {
-        // 重置查寝状态
-        checkInModeActive = false;
-        userCheckInStatus = 0;
-        
-        // 上报重置查寝状态
-        char statusBuffer[128];
-        sprintf(statusBuffer, "{\"id\":\"%u\",\"version\":\"1.0\",\"method\":\"thing.event.property.post\",\"params\":{\"absentUsers\":\"未开启查寝\",\"resetCheckIn\":0}}", postMsgId++);
-        mqttClient.publish(ALI_TOPIC_PROP_POST, statusBuffer);
-      }
-      lastResetCheckInFlag = resetFlag;
-    }
+    // 提取消息ID（下面的发布会覆盖接收缓冲区，先复制出来）
+    char msgId[24];
+    strlcpy(msgId, doc["id"] | "", sizeof(msgId));
     
-    // 处理设备控制
-    if (params.containsKey("lightState")) {
-      lightState = (int)params["lightState"] == 1;
-      digitalWrite(LIGHT_PIN, lightState ? HIGH : LOW);
+    // 按属性表逐个设置（每个键一次哈希查找，超出范围的值限制到边界）
+    PropertyRegistry::Summary summary = propertyRegistry.applyAll(doc["params"].as<JsonObjectConst>());
+    if (summary.clamped || summary.invalid) {
+      deferredLog.printf("属性设置: %u个已设置, %u个超出范围已限制, %u个类型错误",
+                         summary.applied, summary.clamped, summary.invalid);
     }
     
-    if (params.containsKey("fanState")) {
-      fanState = (int)params["fanState"] == 1;
-      fanManualControl = true; // 设为手动控制模式
-      digitalWrite(FAN_PIN, fanState ? HIGH : LOW);
-    }
-    
-    if (params.containsKey("pumpState")) {
-      pumpState = (int)params["pumpState"] == 1;
-      pumpManualControl = true; // 设为手动控制模式
-      digitalWrite(PUMP_PIN, pumpState ? HIGH : LOW);
-    }
-    
-    // 处理阈值设置
-    if (params.containsKey("temperatureThreshold")) {
-      temperatureThreshold = params["temperatureThreshold"];
-    }
+    // 发送属性设置响应（有类型错误的属性时返回460参数错误）
+    char responseBuf[64];
+    snprintf(responseBuf, sizeof(responseBuf), "{\"id\":\"%s\",\"code\":%d,\"data\":{}}",
+             msgId, summary.invalid ? 460 : 200);
+    mqttClient.publish(ALI_TOPIC_PROP_SET_REPLY, responseBuf);
+  }
+}
+
+//----------------------------------------
+// 属性设置函数（由propertyRegistry按属性名分发）
+//----------------------------------------
+void setStartCheckIn(PropertyValue value) {
+  // 只在属性从0变为1时触发查寝（避免重复触发）
+  if (value.b && !lastCheckInFlag && !checkInModeActive) {
+    startCheckInMode();
     
-    if (params.containsKey("humidityThreshold")) {
-      humidityThreshold = params["humidityThreshold"];
-    }
+    // 上报正在查寝状态
+    char statusBuffer[128];
+    sprintf(statusBuffer, "{\"id\":\"%u\",\"version\":\"1.0\",\"method\":\"" TSL_METHOD_PROPERTY_POST "\",\"params\":{\"" TSL_PROP_ABSENT_USERS "\":\"正在查寝，请稍等...\"}}", postMsgId++);
+    mqttClient.publish(ALI_TOPIC_PROP_POST, statusBuffer);
+  }
+  lastCheckInFlag = value.b;
+}
+
+void setResetCheckIn(PropertyValue value) {
+  // 只在属性从0变为1时重置查寝状态
+  if (value.b && !lastResetCheckInFlag) {
+    // 重置查寝状态
+    checkInModeActive = false;
+    userCheckInStatus = 0;
+    scenes.dispatch(UI_EVT_CHECKIN_END);
     
-    if (params.containsKey("lightThreshold")) {
-      lightThreshold = params["lightThreshold"];
+    // 上报重置查寝状态
+    char statusBuffer[128];
+    sprintf(statusBuffer, "{\"id\":\"%u\",\"version\":\"1.0\",\"method\":\"" TSL_METHOD_PROPERTY_POST "\",\"params\":{\"" TSL_PROP_ABSENT_USERS "\":\"未开启查寝\",\"" TSL_PROP_RESET_CHECK_IN "\":0}}", postMsgId++);
+    mqttClient.publish(ALI_TOPIC_PROP_POST, statusBuffer);
+  }
+  lastResetCheckInFlag = value.b;
+}
+
+void setLightState(PropertyValue value) {
+  lightState = value.b;
+  digitalWrite(LIGHT_PIN, lightState ? HIGH : LOW);
+}
+
+void setFanState(PropertyValue value) {
+  fanState = value.b;
+  fanManualControl = true; // 设为手动控制模式
+  digitalWrite(FAN_PIN, fanState ? HIGH : LOW);
+}
+
+void setPumpState(PropertyValue value) {
+  pumpState = value.b;
+  pumpManualControl = true; // 设为手动控制模式
+  digitalWrite(PUMP_PIN, pumpState ? HIGH : LOW);
+}
+
+void setTemperatureThreshold(PropertyValue value) { temperatureThreshold = value.f; }
+void setHumidityThreshold(PropertyValue value) { humidityThreshold = value.f; }
+void setLightThreshold(PropertyValue value) { lightThreshold = value.f; }
+void setDecibelThreshold(PropertyValue value) { decibelThreshold = value.i; }
+void setFlameThreshold(PropertyValue value) { flameThreshold = value.i; }
+void setSmokeThreshold(PropertyValue value) { smokeThreshold = value.i; }
+
+//----------------------------------------
+// 定时器任务中调用，只置标志
+//----------------------------------------
+void requestSensorPublish() {
+  publishDue = true;
+}
+
+//----------------------------------------
+// 发布传感器数据到阿里云（在loop()中调用）
+//----------------------------------------
+void publishSensorData() {
+  // 断网时仍然采样：传感器样本照常进批次，批次发不出去时进暂存队列
+  bool online = wifiLink.connected() && mqttClient.connected();
+  
+  // 取最近一次采样的快照，不再重复读传感器（SHT30软件I2C一次约15ms）
+  SensorData readings;
+  if (!sensorSnapshot.read(readings)) return;
+  
+  PropertyFrame frame;
+  fillPropertyFrame(frame, readings.temperature, readings.humidity, readings.lux,
+                    readings.flameValue, readings.mq2Value, readings.dB);
+
+  // 只上报超过死区或到期的属性，没有需要上报的就跳过
+  unsigned long now = millis();
+  PropertyMask mask = propertyTracker.select(frame, now);
+  // 期望值应用前先不报执行器和阈值，避免上报一次马上又被期望值改掉
+  if (desiredState.waiting(now)) mask &= ~liveOnlyProperties;
+
+  // 传感器读数带采集时间放入批次（时间没同步也照样放入，发送时再换算），阈值和执行器状态立即上报；
+  // 批次已满时，全部走普通属性上报
+  PropertyMask batched = mask & ~liveOnlyProperties;
+  if (batched && sampleBatch.add(uptimeMillis(), frame, batched, now)) {
+    propertyTracker.commit(frame, batched, now);
+  } else {
+    batched = 0;
+  }
+
+  PropertyMask live = mask & ~batched;
+  // 定义TELEMETRY_RAW_FRAME（build_flags加-DTELEMETRY_RAW_FRAME）时，实时属性上报改用二进制帧发到up_raw，
+  // 约为JSON的1/6。产品的数据格式需设为“透传/自定义”，并在控制台上传tsl/raw_parse.js作为解析脚本。
+#ifdef TELEMETRY_RAW_FRAME
+  if (live && online) {
+    // 二进制帧，按属性表顺序只写值
+    uint8_t rawBuf[PropertyCodec::RAW_HEADER_SIZE + THING_PROPERTY_COUNT * 4];
+    uint32_t id = postMsgId++;
+    size_t len = PropertyCodec::writeRawPost(rawBuf, sizeof(rawBuf), id, frame, live);
+    if (len <= sizeof(rawBuf) && mqttClient.publish(ALI_TOPIC_RAW_UP, rawBuf, len, 1)) {
+      publishTracker.track(ALI_TOPIC_RAW_UP, rawBuf, len, id, now);
+      propertyTracker.commit(frame, live, now);
     }
-    
-    if (params.containsKey("decibelThreshold")) {
-      decibelThreshold = params["decibelThreshold"];
+  }
+#else
+  if (live && online) {
+    // 按属性表一次写出完整报文
+    char jsonBuf[PROPERTY_POST_BUFFER];
+    size_t len = PropertyCodec::writePost(jsonBuf, sizeof(jsonBuf), postMsgId++, frame, live);
+    if (len >= sizeof(jsonBuf)) {
+      Serial.printf("属性上报报文过长(%u字节)，未发送\n", (unsigned)len);
+    } else if (publishTracked(ALI_TOPIC_PROP_POST, (const uint8_t *)jsonBuf, len)) {
+      // 发布成功后才记为已上报
+      propertyTracker.commit(frame, live, now);
     }
-    
-    if (params.containsKey("flameThreshold")) {
-      flameThreshold = params["flameThreshold"];
+  }
+#endif
+
+  if (sampleBatch.due(now)) {
+    flushSampleBatch(online);
+  }
+}
+
+/**
+ * 把批次中的样本合成一条history.post发送，离线或发送失败时放入暂存队列；
+ * 时间还没同步时样本原样暂存，等同步后补发时再换算时间
+ */
+void flushSampleBatch(bool online) {
+  uint64_t epochMs = epochMillis();
+  if (epochMs == 0) {
+    size_t len = sampleBatch.save((uint8_t *)historyBuf, sizeof(historyBuf), bootId);
+    if (len > sizeof(historyBuf)) {
+      Serial.printf("未定时样本过长(%u字节)，丢弃%u条样本\n", (unsigned)len, sampleBatch.count());
+    } else {
+      outbox.push(OUTBOX_TOPIC_UNTIMED, (const uint8_t *)historyBuf, len);
     }
-    
-    if (params.containsKey("smokeThreshold")) {
-      smokeThreshold = params["smokeThreshold"];
+    sampleBatch.clear();
+    return;
+  }
+
+  int64_t offsetMs = (int64_t)epochMs - (int64_t)uptimeMillis();
+  size_t len = sampleBatch.write(historyBuf, sizeof(historyBuf), postMsgId++, identity.productKey(),
+                                 identity.deviceName(), offsetMs);
+  if (len >= sizeof(historyBuf)) {
+    Serial.printf("批量上报报文过长(%u字节)，丢弃%u条样本\n", (unsigned)len, sampleBatch.count());
+    sampleBatch.clear();
+    return;
+  }
+  if (!online || !publishTracked(ALI_TOPIC_PROP_HISTORY_POST, (const uint8_t *)historyBuf, len)) {
+    outbox.push(ALI_TOPIC_PROP_HISTORY_POST, (const uint8_t *)historyBuf, len);
+  }
+  sampleBatch.clear();
+}
+
+/**
+ * 暂存队列补发回调
+ */
+bool publishOutboxRecord(const char *topic, const uint8_t *payload, size_t length) {
+  if (strcmp(topic, OUTBOX_TOPIC_UNTIMED) != 0) {
+    // 其余暂存的都是history.post，主题固定，不能直接跟踪回调里的临时主题指针
+    return publishTracked(ALI_TOPIC_PROP_HISTORY_POST, payload, length);
+  }
+
+  // 未定时样本：等时间同步后换算成UTC时间再发；上次开机留下的已经无法换算，丢弃
+  uint64_t epochMs = epochMillis();
+  if (epochMs == 0) return false;
+  if (!replayBatch.load(payload, length, bootId)) {
+    untimedDropped++;
+    deferredLog.printf("丢弃无法补时间的样本批次(%u字节)", (unsigned)length);
+    return true;
+  }
+  int64_t offsetMs = (int64_t)epochMs - (int64_t)uptimeMillis();
+  size_t len = replayBatch.write(historyBuf, sizeof(historyBuf), postMsgId++, identity.productKey(),
+                                 identity.deviceName(), offsetMs);
+  replayBatch.clear();
+  if (len >= sizeof(historyBuf)) {
+    untimedDropped++;
+    return true;
+  }
+  return publishTracked(ALI_TOPIC_PROP_HISTORY_POST, (const uint8_t *)historyBuf, len);
+}
+
+/**
+ * 以QoS1发布并登记到确认跟踪表（PubSubClient后端只支持QoS0，靠post_reply确认）
+ */
+bool publishTracked(const char *topic, const uint8_t *payload, size_t length) {
+  if (!mqttClient.publish(topic, payload, length, 1)) return false;
+  publishTracker.track(topic, payload, length, millis());
+  return true;
+}
+
+bool republishTracked(const char *topic, const uint8_t *payload, size_t length) {
+  return mqttClient.connected() && mqttClient.publish(topic, payload, length, 1);
+}
+
+/**
+ * 重发用尽：历史数据转入暂存队列以后补发；实时属性不补发旧值，改为安排一次全量同步
+ */
+bool onPublishExpired(const char *topic, const uint8_t *payload, size_t length) {
+  if (strcmp(topic, ALI_TOPIC_PROP_HISTORY_POST) == 0) {
+    return outbox.push(topic, payload, length);
+  }
+  propertyTracker.requestFullSync();
+  return true;
+}
+
+/**
+ * 处理属性上报应答，按id结束跟踪并统计时延
+ */
+void handlePostReply(const byte *payload, unsigned int length) {
+  inboundDoc.clear();
+  inboundJsonPool.reset();
+  DeserializationError error = deserializeJson(inboundDoc, (const char *)payload, length,
+                                               DeserializationOption::Filter(inboundFilter));
+  if (error) {
+    if (error == DeserializationError::NoMemory) inboundOverflows++;
+    return;
+  }
+  const char *id = inboundDoc["id"];
+  if (id == nullptr) return;
+  int code = inboundDoc["code"] | 0;
+  if (code != 200) {
+    deferredLog.printf("上报被拒绝 id=%s code=%d %s", id, code, (const char *)(inboundDoc["message"] | ""));
+  }
+  publishTracker.acknowledge(strtoul(id, nullptr, 10), code, millis());
+}
+
+/**
+ * 发送报警事件（QoS1，由alarmChannel自己跟踪应答）
+ */
+bool publishAlarmEvent(uint8_t kind, const uint8_t *payload, size_t length) {
+  const char *topic = kind == ALARM_FIRE ? ALI_TOPIC_EVENT_FIRE_ALARM : ALI_TOPIC_EVENT_SMOKE_ALARM;
+  return mqttClient.publish(topic, payload, length, 1);
+}
+
+/**
+ * 处理报警事件应答，统计从检测到确认的时延
+ */
+void handleAlarmReply(const byte *payload, unsigned int length) {
+  inboundDoc.clear();
+  inboundJsonPool.reset();
+  DeserializationError error = deserializeJson(inboundDoc, (const char *)payload, length,
+                                               DeserializationOption::Filter(inboundFilter));
+  if (error) {
+    if (error == DeserializationError::NoMemory) inboundOverflows++;
+    return;
+  }
+  const char *id = inboundDoc["id"];
+  if (id == nullptr) return;
+  int code = inboundDoc["code"] | 0;
+  if (code != 200) {
+    deferredLog.printf("报警事件被拒绝 id=%s code=%d %s", id, code, (const char *)(inboundDoc["message"] | ""));
+  }
+  alarmChannel.acknowledge(strtoul(id, nullptr, 10), code, millis());
+}
+
+/**
+ * RRPC控制请求：按属性表执行，回读执行器引脚得到实际状态，连同执行耗时同步应答
+ * 请求与property/set格式相同：{"id":"1","version":"1.0","method":"thing.service.property.set","params":{"fanState":1}}
+ * 应答：{"id":"1","code":200,"data":{"lightState":0,"fanState":1,...},"actuateUs":180}
+ */
+void handleRrpcRequest(const char *topic, const byte *payload, unsigned int length) {
+  unsigned long start = micros();
+  rrpcMetrics.requests++;
+  
+  // 应答主题由请求主题最后一级的messageId拼出（执行中的发布会覆盖接收缓冲区，先拼好）
+  char responseTopic[DeviceIdentity::TOPIC_MAX + 32];
+  size_t topicLen = snprintf(responseTopic, sizeof(responseTopic), "%s%s",
+                             ALI_TOPIC_RRPC_RESPONSE, strrchr(topic, '/') + 1);
+  if (topicLen >= sizeof(responseTopic)) return;
+  
+  inboundDoc.clear();
+  inboundJsonPool.reset();
+  DeserializationError error = deserializeJson(inboundDoc, (const char *)payload, length,
+                                               DeserializationOption::Filter(inboundFilter));
+  PropertyRegistry::Summary summary = {0, 0, 0, 0};
+  if (error) {
+    if (error == DeserializationError::NoMemory) inboundOverflows++;
+  } else {
+    summary = propertyRegistry.applyAll(inboundDoc["params"].as<JsonObjectConst>());
+  }
+  uint32_t actuateUs = micros() - start;
+  
+  // 回读执行器引脚，应答中是实际输出而不是请求的值
+  PropertyFrame frame;
+  fillPropertyFrame(frame, sensorData.temperature, sensorData.humidity, sensorData.lux,
+                    sensorData.flameValue, sensorData.mq2Value, sensorData.dB);
+  frame.lightState = digitalRead(LIGHT_PIN) == HIGH;
+  frame.fanState = digitalRead(FAN_PIN) == HIGH;
+  frame.pumpState = digitalRead(PUMP_PIN) == HIGH;
+  
+  bool rejected = error || summary.invalid;
+  char buf[PROPERTY_POST_BUFFER];
+  JsonOut out(buf, sizeof(buf));
+  out.raw("{\"id\":");
+  out.str(error ? "" : (const char *)(inboundDoc["id"] | ""));
+  out.raw(",\"code\":");
+  out.uinteger(rejected ? 460 : 200);
+  out.raw(",\"data\":");
+  PropertyCodec::writeParams(out, frame, liveOnlyProperties);
+  out.raw(",\"actuateUs\":");
+  out.uinteger(actuateUs);
+  out.raw('}');
+  if (!out.fits()) return;
+  mqttClient.publish(responseTopic, (const uint8_t *)buf, out.length());
+  
+  if (rejected) rrpcMetrics.rejected++;
+  rrpcMetrics.lastActuateUs = actuateUs;
+  rrpcMetrics.actuateSumUs += actuateUs;
+  if (actuateUs > rrpcMetrics.maxActuateUs) rrpcMetrics.maxActuateUs = actuateUs;
+  rrpcMetrics.lastReplyUs = micros() - start;
+  deferredLog.printf("RRPC %s 执行%luus 应答%luus", rejected ? "参数错误" : "完成",
+                     (unsigned long)actuateUs, (unsigned long)rrpcMetrics.lastReplyUs);
+}
+
+/**
+ * topic是否为postTopic对应的应答主题（postTopic加"_reply"）
+ */
+bool isReplyTopic(const char *topic, const char *postTopic) {
+  size_t len = strlen(postTopic);
+  return strncmp(topic, postTopic, len) == 0 && strcmp(topic + len, "_reply") == 0;
+}
+
+/**
+ * 建立下行报文的字段过滤器，解析时丢弃其余字段（例如post_reply中的data、set中的version），
+ * params只保留属性表中的可设置属性
+ */
+void buildInboundFilter() {
+  inboundFilter["id"] = true;
+  inboundFilter["code"] = true;
+  inboundFilter["message"] = true;
+  for (size_t i = 0; i < propertyRegistry.count(); i++) {
+    const char *name = propertyRegistry.at(i).name;
+    inboundFilter["params"][name] = true;
+    inboundFilter["data"][name]["value"] = true;    // desired/get_reply
+    inboundFilter["data"][name]["version"] = true;
+  }
+}
+
+/**
+ * 启动时间线发到自定义主题：{"boot":{"reset":1,"marks":{"setup":35,"armed":120,...}}}
+ */
+void reportBootTimeline() {
+  bootTimeline.print(Serial);
+  char buf[512];
+  int len = snprintf(buf, sizeof(buf), "{\"boot\":{\"reset\":%d,\"marks\":", (int)esp_reset_reason());
+  size_t marks = bootTimeline.write(buf + len, sizeof(buf) - len);
+  if (marks + 3 > sizeof(buf) - len) return;
+  strcpy(buf + len + marks, "}}");
+  mqttClient.publish(ALI_TOPIC_USER_UPDATE, buf);
+}
+
+/**
+ * 请求全部非命令类可设置属性的期望值
+ */
+void requestDesiredState() {
+  char buf[512];
+  uint32_t id = postMsgId++;
+  size_t len = desiredState.writeRequest(buf, sizeof(buf), id);
+  if (len >= sizeof(buf)) return;
+  if (mqttClient.publish(ALI_TOPIC_DESIRED_GET, buf)) {
+    desiredState.requested(id, millis());
+  }
+}
+
+/**
+ * 期望属性值应答：只应用比上次应用过的版本更新的值，执行器状态变化由属性跟踪器照常上报
+ * {"id":"1","code":200,"data":{"fanState":{"value":1,"version":3}}}
+ */
+void handleDesiredReply(const byte *payload, unsigned int length) {
+  inboundDoc.clear();
+  inboundJsonPool.reset();
+  DeserializationError error = deserializeJson(inboundDoc, (const char *)payload, length,
+                                               DeserializationOption::Filter(inboundFilter));
+  if (error) {
+    if (error == DeserializationError::NoMemory) inboundOverflows++;
+    return;
+  }
+  const char *id = inboundDoc["id"];
+  if (id == nullptr) return;
+  int code = inboundDoc["code"] | 0;
+  uint8_t applied = desiredState.applyReply(strtoul(id, nullptr, 10), code, inboundDoc["data"].as<JsonObjectConst>());
+  if (code != 200) {
+    deferredLog.printf("获取期望值失败 code=%d %s", code, (const char *)(inboundDoc["message"] | ""));
+  } else if (applied) {
+    deferredLog.printf("已应用%u个期望值", applied);
+  }
+}
+
+void rememberSetting(size_t index, PropertyValue value) {
+  desiredState.remember(index, value);
+}
+
+/**
+ * 把上报时延直方图、重发统计和显示性能指标发到自定义主题
+ */
+void reportDeviceMetrics() {
+  if (!mqttConnection.connected()) return;
+
+  PublishTracker::Stats st = publishTracker.stats();
+  const AlarmChannel::Stats &as = alarmChannel.stats();
+  const DesiredState::Stats &ds = desiredState.stats();
+  const WifiLink::Stats &ws = wifiLink.stats();
+  const BrokerResolver::Stats &bs = brokerResolver.stats();
+  const DisplayGovernor::Metrics &dm = displayGovernor.metrics();
+  char buf[1792];
+  int len = snprintf(buf, sizeof(buf),
+    "{\"uptime\":%lu,\"publish\":{\"inflight\":%u,\"tracked\":%lu,\"acked\":%lu,\"rejected\":%lu,"
+    "\"retransmits\":%lu,\"expired\":%lu,\"overflow\":%lu,\"latencyAvgMs\":%lu,\"latencyMaxMs\":%lu,"
+    "\"latencyHist\":{\"bounds\":[",
+    millis() / 1000, publishTracker.inflight(), (unsigned long)st.tracked, (unsigned long)st.acked,
+    (unsigned long)st.rejected, (unsigned long)st.retransmits, (unsigned long)st.expired,
+    (unsigned long)st.overflow, (unsigned long)(st.acked ? st.latencySumMs / st.acked : 0),
+    (unsigned long)st.latencyMaxMs);
+  for (uint8_t i = 0; i + 1 < PublishTracker::LATENCY_BUCKETS && len < (int)sizeof(buf); i++) {
+    len += snprintf(buf + len, sizeof(buf) - len, "%s%lu", i ? "," : "", (unsigned long)PublishTracker::bucketLimitMs(i));
+  }
+  for (uint8_t i = 0; i < PublishTracker::LATENCY_BUCKETS && len < (int)sizeof(buf); i++) {
+    len += snprintf(buf + len, sizeof(buf) - len, "%s%lu", i ? "," : "],\"counts\":[", (unsigned long)st.histogram[i]);
+  }
+  if (len < (int)sizeof(buf)) {
+    len += snprintf(buf + len, sizeof(buf) - len,
+      "]}},\"outbox\":{\"ram\":%u,\"flash\":%u,\"dropped\":%lu,\"untimedDropped\":%lu},"
+      "\"inbound\":{\"poolPeak\":%u,\"overflows\":%lu,\"logDropped\":%lu},"
+      "\"alarm\":{\"pending\":%u,\"raised\":%lu,\"acked\":%lu,\"rejected\":%lu,\"retransmits\":%lu,"
+      "\"dropped\":%lu,\"coalesced\":%lu,\"lastMs\":%lu,\"avgMs\":%lu,\"maxMs\":%lu},"
+      "\"rrpc\":{\"requests\":%lu,\"rejected\":%lu,\"lastActuateUs\":%lu,\"avgActuateUs\":%lu,"
+      "\"maxActuateUs\":%lu,\"lastReplyUs\":%lu},"
+      "\"wifi\":{\"rssi\":%d,\"connects\":%lu,\"fast\":%lu,\"scans\":%lu,\"disconnects\":%lu,"
+      "\"lastMs\":%lu,\"maxMs\":%lu,\"reason\":%u},"
+      "\"broker\":{\"endpoint\":%u,\"lookups\":%lu,\"lookupFailures\":%lu,\"lastLookupMs\":%lu,"
+      "\"cachedConnects\":%lu,\"failovers\":%lu,\"failbacks\":%lu},"
+      "\"desired\":{\"requests\":%lu,\"replies\":%lu,\"applied\":%lu,\"stale\":%lu,\"timeouts\":%lu},"
+      "\"display\":{\"avgFrameUs\":%lu,\"maxFrameUs\":%lu,\"loopUs\":%lu,\"frames\":%lu,\"dropped\":%lu}}",
+      (unsigned)outbox.ramBytes(), (unsigned)outbox.flashBytes(), (unsigned long)outbox.dropped(),
+      (unsigned long)untimedDropped,
+      (unsigned)inboundJsonPool.peak(), (unsigned long)inboundOverflows, (unsigned long)deferredLog.dropped(),
+      alarmChannel.pending(), (unsigned long)as.raised, (unsigned long)as.acked, (unsigned long)as.rejected,
+      (unsigned long)as.retransmits, (unsigned long)as.dropped, (unsigned long)as.coalesced,
+      (unsigned long)as.lastLatencyMs,
+      (unsigned long)(as.acked ? as.latencySumMs / as.acked : 0), (unsigned long)as.maxLatencyMs,
+      (unsigned long)rrpcMetrics.requests, (unsigned long)rrpcMetrics.rejected,
+      (unsigned long)rrpcMetrics.lastActuateUs,
+      (unsigned long)(rrpcMetrics.requests ? rrpcMetrics.actuateSumUs / rrpcMetrics.requests : 0),
+      (unsigned long)rrpcMetrics.maxActuateUs, (unsigned long)rrpcMetrics.lastReplyUs,
+      (int)WiFi.RSSI(), (unsigned long)ws.connects, (unsigned long)ws.fastConnects, (unsigned long)ws.scans,
+      (unsigned long)ws.disconnects, (unsigned long)ws.lastConnectMs, (unsigned long)ws.maxConnectMs, ws.lastReason,
+      brokerResolver.currentIndex(), (unsigned long)bs.lookups, (unsigned long)bs.lookupFailures,
+      (unsigned long)bs.lastLookupMs, (unsigned long)bs.cachedConnects, (unsigned long)bs.failovers,
+      (unsigned long)bs.failbacks,
+      (unsigned long)ds.requests, (unsigned long)ds.replies, (unsigned long)ds.applied,
+      (unsigned long)ds.stale, (unsigned long)ds.timeouts,
+      (unsigned long)dm.avgFrameUs, (unsigned long)dm.maxFrameUs, (unsigned long)dm.loopUs,
+      (unsigned long)dm.frames, (unsigned long)dm.dropped);
+  }
+#ifndef MQTT_USE_ESP_MQTT
+  // TLS握手耗时：不带会话的完整握手和带会话的复用握手分开统计
+  if (len < (int)sizeof(buf) - 1 && tlsClient.hasCaCert()) {
+    const TlsClient::Metrics &tm = tlsClient.metrics();
+    uint32_t fullCount = tm.handshakes - tm.resumeOffers;
+    len--; // 去掉结尾的'}'，追加tls字段
+    len += snprintf(buf + len, sizeof(buf) - len,
+      ",\"tls\":{\"handshakes\":%lu,\"resumed\":%lu,\"failures\":%lu,\"lastMs\":%lu,"
+      "\"avgFullMs\":%lu,\"avgResumeMs\":%lu,\"lastError\":%d}}",
+      (unsigned long)tm.handshakes, (unsigned long)tm.resumeOffers, (unsigned long)tm.failures,
+      (unsigned long)tm.lastHandshakeMs,
+      (unsigned long)(fullCount ? tm.fullTotalMs / fullCount : 0),
+      (unsigned long)(tm.resumeOffers ? tm.resumeTotalMs / tm.resumeOffers : 0), tm.lastError);
+  }
+#endif
+  if (len >= (int)sizeof(buf)) return;
+  mqttClient.publish(ALI_TOPIC_USER_UPDATE, buf);
+}
+
+/**
+ * 开机以来的毫秒数（esp_timer为64位，不会像millis()那样约49天回绕）
+ */
+uint64_t uptimeMillis() {
+  return (uint64_t)(esp_timer_get_time() / 1000);
+}
+
+/**
+ * MQTT的CA证书：LittleFS中有证书文件时用文件，否则用编译进固件的阿里云根证书
+ */
+const char *loadMqttCaCert() {
+  File file = LittleFS.open(MQTT_CA_CERT_PATH, "r");
+  if (!file) return ALIYUN_ROOT_CA_PEM;
+
+  size_t size = file.size();
+  char *pem = (char *)malloc(size + 1);   // 连接期间一直使用，不释放
+  if (pem != nullptr) {
+    size_t got = file.read((uint8_t *)pem, size);
+    pem[got] = '\0';
+    if (strstr(pem, "-----BEGIN CERTIFICATE-----") == nullptr) {
+      free(pem);
+      pem = nullptr;
     }
-    
-    // 发送属性设置响应
-    char responseBuf[100];
-    sprintf(responseBuf, "{\"id\":\"%s\",\"code\":200,\"data\":{}}", msgId.c_str());
-    mqttClient.publish(ALI_TOPIC_PROP_POST_REPLY, responseBuf);
   }
+  file.close();
+  if (pem == nullptr) {
+    Serial.println(MQTT_CA_CERT_PATH "不是PEM证书，使用内置根证书");
+    return ALIYUN_ROOT_CA_PEM;
+  }
+  Serial.println("使用LittleFS中的CA证书");
+  return pem;
 }
 
-//----------------------------------------
-// 发布传感器数据到阿里云
-//----------------------------------------
-void publishSensorData() {
-  if (!wifiConnected || !mqttClient.connected()) return;
-  
-  // 读取传感器数据
-  float temperature = 0, humidity = 0, lux = 0;
-  int flameValue = 0, mq2Value = 0, dB = 0;
-  readSensors(temperature, humidity, lux, flameValue, mq2Value, dB);
-  
-  // 构建阿里云格式JSON
+/**
+ * 当前UTC毫秒时间（SNTP同步前返回0）
+ */
+uint64_t epochMillis() {
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  if (tv.tv_sec < 1600000000) return 0; // 还没同步
+  return (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+/**
+ * 把传感器读数和当前设备状态、阈值填入属性帧
+ */
+void fillPropertyFrame(PropertyFrame &frame, float temperature, float humidity, float lux,
+                       int flameValue, int mq2Value, int dB) {
+  frame.temperature = temperature;
+  frame.humidity = humidity;
+  frame.light = lux;
+  frame.flame = flameValue;
+  frame.smoke = mq2Value;
+  frame.noise = dB;
+  frame.lightState = lightState;
+  frame.fanState = fanState;
+  frame.pumpState = pumpState;
+  frame.temperatureThreshold = temperatureThreshold;
+  frame.humidityThreshold = humidityThreshold;
+  frame.lightThreshold = lightThreshold;
+  frame.flameThreshold = flameThreshold;
+  frame.smokeThreshold = smokeThreshold;
+  frame.decibelThreshold = decibelThreshold;
+}
+
+#ifdef PROPERTY_CODEC_BENCH
+/**
+ * 对比原sprintf两次格式化和属性表编码器的耗时（编译时加 -DPROPERTY_CODEC_BENCH，启动时串口输出）
+ */
+void benchmarkPropertyCodec() {
+  const int rounds = 1000;
+  PropertyFrame frame;
+  fillPropertyFrame(frame, 26.4f, 58.2f, 312.5f, 3, 12, 45);
   char params[350];
-  sprintf(params, "{"
-    "\"temperature\":%.1f,"
-    "\"humidity\":%.1f,"
-    "\"light\":%.1f,"
-    "\"flame\":%d,"
-    "\"smoke\":%d,"
-    "\"noise\":%d,"
-    "\"lightState\":%d,"
-    "\"fanState\":%d,"
-    "\"pumpState\":%d,"
-    "\"temperatureThreshold\":%.1f,"
-    "\"humidityThreshold\":%.1f,"
-    "\"lightThreshold\":%.1f,"
-    "\"flameThreshold\":%d,"
-    "\"smokeThreshold\":%d,"
-    "\"decibelThreshold\":%d"
-    "}",
-    temperature, humidity, lux, 
-    flameValue, mq2Value, dB,
-    lightState ? 1 : 0,
-    fanState ? 1 : 0,
-    pumpState ? 1 : 0,
-    temperatureThreshold, humidityThreshold, lightThreshold,
-    flameThreshold, smokeThreshold, decibelThreshold
-  );
-  
-  // 构建完整的JSON消息
   char jsonBuf[600];
-  sprintf(jsonBuf, ALI_TOPIC_PROP_FORMAT, postMsgId++, params);
-  
-  // 发布到阿里云
-  mqttClient.publish(ALI_TOPIC_PROP_POST, jsonBuf);
+  volatile size_t sink = 0;
+
+  unsigned long t0 = micros();
+  for (int i = 0; i < rounds; i++) {
+    sprintf(params, "{"
+      "\"temperature\":%.1f,\"humidity\":%.1f,\"light\":%.1f,"
+      "\"flame\":%d,\"smoke\":%d,\"noise\":%d,"
+      "\"lightState\":%d,\"fanState\":%d,\"pumpState\":%d,"
+      "\"temperatureThreshold\":%.1f,\"humidityThreshold\":%.1f,\"lightThreshold\":%.1f,"
+      "\"flameThreshold\":%d,\"smokeThreshold\":%d,\"decibelThreshold\":%d"
+      "}",
+      frame.temperature, frame.humidity, frame.light,
+      (int)frame.flame, (int)frame.smoke, (int)frame.noise,
+      frame.lightState ? 1 : 0, frame.fanState ? 1 : 0, frame.pumpState ? 1 : 0,
+      frame.temperatureThreshold, frame.humidityThreshold, frame.lightThreshold,
+      (int)frame.flameThreshold, (int)frame.smokeThreshold, (int)frame.decibelThreshold);
+    sink += sprintf(jsonBuf, ALI_TOPIC_PROP_FORMAT, (unsigned)i, params);
+  }
+  unsigned long sprintfUs = micros() - t0;
+
+  t0 = micros();
+  for (int i = 0; i < rounds; i++) {
+    sink += PropertyCodec::writePost(jsonBuf, sizeof(jsonBuf), i, frame);
+  }
+  unsigned long codecUs = micros() - t0;
+
+  Serial.printf("属性编码基准(%d次): sprintf %.2fus/次, 属性表 %.2fus/次\n",
+                rounds, (float)sprintfUs / rounds, (float)codecUs / rounds);
+  (void)sink;
 }
+#endif
 
 //----------------------------------------
 // WiFi相关函数实现
 //----------------------------------------
 /**
- * 连接WiFi网络
+ * 配置WiFi网络并开始连接，连接结果由WiFi事件通知
  */
-void connectToWiFi() {
-  // 显示正在连接WiFi的信息
-  u8g2.clearBuffer();
-  u8g2.setFont(u8g2_font_wqy16_t_gb2312);
-  u8g2.setCursor(0, 30);
-  u8g2.print("正在连接WiFi...");
-  u8g2.sendBuffer();
-  
-  // 开始WiFi连接
-  WiFi.begin(ssid, password);
-  
-  // 等待连接，最多等待10秒
-  unsigned long startTime = millis();
-  while (WiFi.status() != WL_CONNECTED && millis() - startTime < 10000) {
-    delay(500);
-  }
-  
-  // 判断连接结果
-  if (WiFi.status() == WL_CONNECTED) {
-    wifiConnected = true;
-    wifiSignalStrength = WiFi.RSSI();
-    
-    // 显示连接成功信息
-    u8g2.clearBuffer();
-    u8g2.setFont(u8g2_font_wqy16_t_gb2312);
-    u8g2.setCursor(0, 30);
-    u8g2.print("WiFi连接成功");
-    u8g2.setCursor(0, 50);
-    u8g2.print("IP: ");
-    u8g2.print(WiFi.localIP().toString().c_str());
-    u8g2.sendBuffer();
-    delay(2000);
-    
-    // WiFi连接成功后，连接阿里云
-    connectToAliyun();
-  } else {
-    wifiConnected = false;
-    
-    // 显示连接失败信息
-    u8g2.clearBuffer();
-    u8g2.setFont(u8g2_font_wqy16_t_gb2312);
-    u8g2.setCursor(0, 30);
-    u8g2.print("WiFi连接失败");
-    u8g2.setCursor(0, 50);
-    u8g2.print("请检查网络");
-    u8g2.sendBuffer();
-    delay(2000);
+void beginWiFi() {
+  for (size_t i = 0; i < sizeof(wifiNetworks) / sizeof(wifiNetworks[0]); i++) {
+    wifiLink.addNetwork(wifiNetworks[i][0], wifiNetworks[i][1]);
   }
+#ifdef WIFI_STATIC_IP
+  wifiLink.setStaticIp(wifiStaticIp, wifiGateway, wifiSubnet, wifiDns);
+#else
+  // 软复位后沿用上次的DHCP地址，连上AP即可通信
+  wifiLink.reuseLease(true);
+#endif
+  wifiLink.onStateChange(onWifiStateChange);
+  wifiLink.begin();
 }
 
 /**
- * 检查WiFi连接状态
+ * WiFi连接状态变化：连上后跳过退避立即连接MQTT
  */
-void checkWiFiStatus() {
-  // 检查当前WiFi状态
-  if (WiFi.status() == WL_CONNECTED) {
-    wifiConnected = true;
-    wifiSignalStrength = WiFi.RSSI(); // 更新信号强度
-  } else {
-    wifiConnected = false;
-    
-    // 如果以前连接成功但现在断开，则尝试重连
-    static bool lastWifiState = false;
-    if (lastWifiState) {
-      WiFi.disconnect();
-      delay(1000);
-      WiFi.begin(ssid, password);
+void onWifiStateChange(WifiLink::State state) {
+  const WifiLink::Stats &st = wifiLink.stats();
+  switch (state) {
+    case WifiLink::LINK_CONNECTED: {
+      bootTimeline.mark("wifi");
+      Serial.printf("WiFi已连接 %s IP: %s 用时%lums（快速重连%lu/%lu次）\n", wifiLink.ssid(),
+                    WiFi.localIP().toString().c_str(), (unsigned long)st.lastConnectMs,
+                    (unsigned long)st.fastConnects, (unsigned long)st.connects);
+      char message[SceneManager::TOAST_MAX_LEN];
+      snprintf(message, sizeof(message), "WiFi已连接\n%s", WiFi.localIP().toString().c_str());
+      scenes.toast(message, 1500);
+      mqttConnection.retryNow();
+      break;
     }
-    lastWifiState = wifiConnected;
-  }
-  
-  // 如果WiFi重新连接上，连接MQTT
-  if (wifiConnected && !mqttClient.connected()) {
-    connectToAliyun();
+    case WifiLink::LINK_SCANNING:
+      Serial.println("正在扫描WiFi...");
+      break;
+    case WifiLink::LINK_BACKOFF:
+      Serial.printf("没有可用的WiFi（原因%u），稍后重试\n", st.lastReason);
+      break;
+    default:
+      break;
   }
 }
 
@@ -1229,19 +2388,12 @@ void startCheckInMode() {
   // 重置所有指纹打卡状态
   memset(fingerCheckedIn, false, sizeof(fingerCheckedIn));
   
-  // 显示提示信息
-  u8g2.clearBuffer();
-  u8g2.setFont(u8g2_font_wqy16_t_gb2312);
-  u8g2.setCursor(0, 35);
-  u8g2.print("查寝开始");
-  u8g2.setCursor(0, 55);
-  u8g2.print("请所有人指纹打卡");
-  u8g2.sendBuffer();
+  // 切换到查寝页面并显示提示信息
+  scenes.dispatch(UI_EVT_CHECKIN_START);
+  scenes.toast("查寝开始\n请所有人指纹打卡", 1500);
   
   // 启动蜂鸣器提示一声
-  digitalWrite(BUZZER_PIN, HIGH);
-  delay(200);
-  digitalWrite(BUZZER_PIN, LOW);
+  startChirp(1, 200, 0);
 }
 
 //----------------------------------------
@@ -1264,32 +2416,17 @@ void handleCheckInMode() {
     // 查寝时间结束或全员已打卡
     userCheckInStatus = 2; // 设置为查寝已完成
     
-    // 显示结束原因
-    u8g2.clearBuffer();
-    u8g2.setFont(u8g2_font_wqy16_t_gb2312);
-    u8g2.setCursor(0, 35);
-    u8g2.print("查寝结束");
-    u8g2.setCursor(0, 55);
-    u8g2.print(allCheckedIn ? "全员已打卡" : "时间已到");
-    u8g2.sendBuffer();
+    // 返回原页面并显示结束原因
+    scenes.dispatch(UI_EVT_CHECKIN_END);
+    scenes.toast(allCheckedIn ? "查寝结束\n全员已打卡" : "查寝结束\n时间已到", feedbackDisplayTime);
     
     // 发出蜂鸣器提示音
     if (allCheckedIn) {
       // 全员打卡成功，发出快速三声提示
-      for (int i = 0; i < 3; i++) {
-        digitalWrite(BUZZER_PIN, HIGH);
-        delay(100);
-        digitalWrite(BUZZER_PIN, LOW);
-        delay(100);
-      }
+      startChirp(3, 100, 100);
     } else {
       // 时间到，发出两声提示
-      for (int i = 0; i < 2; i++) {
-        digitalWrite(BUZZER_PIN, HIGH);
-        delay(200);
-        digitalWrite(BUZZER_PIN, LOW);
-        delay(200);
-      }
+      startChirp(2, 200, 200);
     }
     
     // 上报查寝结果
@@ -1320,35 +2457,36 @@ void handleCheckInMode() {
           // 将该指纹ID标记为已打卡
           fingerCheckedIn[matchedId] = true;
           
-          // 显示打卡成功信息
-          u8g2.clearBuffer();
-          u8g2.setFont(u8g2_font_wqy16_t_gb2312);
-          u8g2.setCursor(0, 35);
-          u8g2.print("ID");
-          u8g2.print(matchedId);
-          u8g2.print("打卡成功");
-          u8g2.sendBuffer();
+          // 显示打卡成功信息（1秒后自动返回查寝页面）
+          char message[SceneManager::TOAST_MAX_LEN];
+          snprintf(message, sizeof(message), "ID%d打卡成功", matchedId);
+          scenes.toast(message, 1000);
           
           // 蜂鸣器提示一声
-          digitalWrite(BUZZER_PIN, HIGH);
-          delay(100);
-          digitalWrite(BUZZER_PIN, LOW);
-          
-          // 延迟一秒
-          delay(1000);
+          startChirp(1, 100, 0);
         }
       }
     }
   }
   
-  // 显示查寝页面，包括倒计时和已打卡状态
-  displayCheckInPage();
+}
+
+//----------------------------------------
+// 查寝页面绑定状态（剩余秒数和打卡情况）
+//----------------------------------------
+uint32_t checkInSceneKey() {
+  uint32_t checkedMask = 0;
+  for (int i = 1; i <= MAX_FINGER_ID; i++) {
+    if (fingerCheckedIn[i]) checkedMask |= 1UL << i;
+  }
+  uint32_t elapsedSeconds = (millis() - checkInStartTime) / 1000;
+  return SceneManager::mix(SceneManager::mix(2166136261UL, elapsedSeconds), checkedMask);
 }
 
 //----------------------------------------
 // 显示查寝页面
 //----------------------------------------
-void displayCheckInPage() {
+void renderCheckInScene(bool full) {
   // 获取当前时间和剩余时间（秒）
   unsigned long currentTime = millis();
   int remainingSeconds = max(0, (int)((checkInDuration - (currentTime - checkInStartTime)) / 1000));
@@ -1406,7 +2544,7 @@ void displayCheckInPage() {
 // 上报查寝结果
 //----------------------------------------
 void reportCheckInResult() {
-  if (!wifiConnected || !mqttClient.connected()) return;
+  if (!wifiLink.connected() || !mqttClient.connected()) return;
   
   // 创建JSON对象
   DynamicJsonDocument doc(512);
@@ -1414,7 +2552,7 @@ void reportCheckInResult() {
   // 设置消息基本信息
   doc["id"] = String(postMsgId++);
   doc["version"] = "1.0";
-  doc["method"] = "thing.event.property.post";
+  doc["method"] = TSL_METHOD_PROPERTY_POST;
   
   // 构造未打卡人员ID字符串
   bool hasAbsent = false;
@@ -1431,8 +2569,8 @@ void reportCheckInResult() {
   
   // 如果没有未打卡人员，显示"全员已打卡"
   JsonObject params = doc.createNestedObject("params");
-  params["absentUsers"] = hasAbsent ? absentString : "全员已打卡";
-  params["startCheckIn"] = 0;
+  params[TSL_PROP_ABSENT_USERS] = hasAbsent ? absentString : "全员已打卡";
+  params[TSL_PROP_START_CHECK_IN] = 0;
   
   // 序列化JSON
   char jsonBuffer[512];
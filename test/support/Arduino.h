@@ -0,0 +1,71 @@
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+// 主机单元测试用的Arduino替身（pio test -e native）
+// 只提供被测模块用到的部分；millis()和random()由测试控制，结果可重复。
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+typedef uint8_t byte;
+
+namespace native {
+
+// 测试时钟，由测试推进
+inline unsigned long &ticks() {
+    static unsigned long now = 0;
+    return now;
+}
+
+inline void advance(unsigned long ms) { ticks() += ms; }
+
+// 固定种子的线性同余序列，测试之间可用seed()重置
+inline uint32_t &randomState() {
+    static uint32_t state = 1;
+    return state;
+}
+
+inline void seed(uint32_t value) { randomState() = value; }
+
+}
+
+inline unsigned long millis() { return native::ticks(); }
+
+inline long random(long howbig) {
+    if (howbig <= 0) return 0;
+    uint32_t &state = native::randomState();
+    state = state * 1103515245UL + 12345UL;
+    return (long)((state >> 8) % (uint32_t)howbig);
+}
+
+inline void *ps_malloc(size_t size) { return malloc(size); }
+
+#if !defined(__GLIBC__) || !__GLIBC_PREREQ(2, 38)
+inline size_t strlcpy(char *dst, const char *src, size_t size) {
+    size_t len = strlen(src);
+    if (size > 0) {
+        size_t n = len < size - 1 ? len : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return len;
+}
+#endif
+
+class IPAddress {
+private:
+    uint32_t _addr;
+
+public:
+    IPAddress() : _addr(0) {}
+    IPAddress(uint32_t addr) : _addr(addr) {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+        : _addr(a | (b << 8) | (c << 16) | ((uint32_t)d << 24)) {}
+    operator uint32_t() const { return _addr; }
+};
+
+#endif // NATIVE_ARDUINO_H
@@ -0,0 +1,159 @@
+#ifndef NATIVE_FS_H
+#define NATIVE_FS_H
+
+// 主机单元测试用的文件系统替身：文件内容保存在内存中，
+// 对象一直存在，重新创建被测对象即可模拟重启后扫描上次留下的文件。
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace fs {
+
+struct MemoryNode {
+    std::string path;
+    bool directory;
+    std::vector<uint8_t> data;
+};
+
+typedef std::map<std::string, std::shared_ptr<MemoryNode> > MemoryNodes;
+
+class File {
+private:
+    std::shared_ptr<MemoryNode> _node;
+    MemoryNodes *_nodes;
+    size_t *_used;
+    size_t _capacity;
+    size_t _pos;
+    size_t _next;               // 目录遍历位置
+
+public:
+    File() : _nodes(nullptr), _used(nullptr), _capacity(0), _pos(0), _next(0) {}
+    File(std::shared_ptr<MemoryNode> node, MemoryNodes *nodes, size_t *used, size_t capacity, bool append)
+        : _node(node), _nodes(nodes), _used(used), _capacity(capacity),
+          _pos(append ? node->data.size() : 0), _next(0) {}
+
+    operator bool() const { return (bool)_node; }
+
+    size_t size() const { return _node ? _node->data.size() : 0; }
+    size_t position() const { return _pos; }
+    bool seek(size_t pos) {
+        if (!_node || pos > _node->data.size()) return false;
+        _pos = pos;
+        return true;
+    }
+
+    size_t read(uint8_t *buf, size_t len) {
+        if (!_node || _node->directory) return 0;
+        size_t left = _node->data.size() - _pos;
+        if (len > left) len = left;
+        memcpy(buf, _node->data.data() + _pos, len);
+        _pos += len;
+        return len;
+    }
+
+    // 超过容量时只写入放得下的部分，与闪存写满时相同
+    size_t write(const uint8_t *buf, size_t len) {
+        if (!_node || _node->directory) return 0;
+        if (*_used + len > _capacity) len = *_used < _capacity ? _capacity - *_used : 0;
+        _node->data.insert(_node->data.end(), buf, buf + len);
+        *_used += len;
+        _pos = _node->data.size();
+        return len;
+    }
+
+    void close() { _node.reset(); }
+
+    bool isDirectory() const { return _node && _node->directory; }
+    const char *name() const {
+        if (!_node) return "";
+        size_t slash = _node->path.rfind('/');
+        return _node->path.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+    }
+
+    // 按文件名顺序返回目录下的下一个文件
+    File openNextFile() {
+        if (!isDirectory()) return File();
+        std::string prefix = _node->path + "/";
+        size_t index = 0;
+        for (MemoryNodes::iterator it = _nodes->begin(); it != _nodes->end(); ++it) {
+            const std::string &path = it->first;
+            if (path.compare(0, prefix.size(), prefix) != 0) continue;
+            if (path.find('/', prefix.size()) != std::string::npos) continue;
+            if (index++ == _next) {
+                _next++;
+                return File(it->second, _nodes, _used, _capacity, false);
+            }
+        }
+        return File();
+    }
+};
+
+class FS {
+private:
+    MemoryNodes _nodes;
+    size_t _used;
+    size_t _capacity;
+
+public:
+    FS() : _used(0), _capacity((size_t)-1) {}
+
+    bool begin(bool = false) { return true; }
+
+    // 清空全部文件（对应LittleFS.format()）
+    bool format() {
+        _nodes.clear();
+        _used = 0;
+        return true;
+    }
+
+    // 测试用：限制可写入的总字节数
+    void setCapacity(size_t bytes) { _capacity = bytes; }
+    size_t usedBytes() const { return _used; }
+
+    bool exists(const char *path) const { return _nodes.count(path) > 0; }
+
+    bool mkdir(const char *path) {
+        std::shared_ptr<MemoryNode> node(new MemoryNode());
+        node->path = path;
+        node->directory = true;
+        _nodes[path] = node;
+        return true;
+    }
+
+    File open(const char *path, const char *mode = "r") {
+        MemoryNodes::iterator it = _nodes.find(path);
+        if (mode[0] == 'r') {
+            if (it == _nodes.end()) return File();
+            return File(it->second, &_nodes, &_used, _capacity, false);
+        }
+        if (it == _nodes.end() || mode[0] == 'w') {
+            if (it != _nodes.end()) _used -= it->second->data.size();
+            std::shared_ptr<MemoryNode> node(new MemoryNode());
+            node->path = path;
+            node->directory = false;
+            it = _nodes.insert(std::make_pair(std::string(path), node)).first;
+            it->second = node;
+        }
+        return File(it->second, &_nodes, &_used, _capacity, true);
+    }
+
+    bool remove(const char *path) {
+        MemoryNodes::iterator it = _nodes.find(path);
+        if (it == _nodes.end()) return false;
+        _used -= it->second->data.size();
+        _nodes.erase(it);
+        return true;
+    }
+};
+
+}
+
+using fs::FS;
+using fs::File;
+
+#endif // NATIVE_FS_H
@@ -0,0 +1,17 @@
+#ifndef NATIVE_LITTLEFS_H
+#define NATIVE_LITTLEFS_H
+
+#include "FS.h"
+
+namespace native {
+
+inline fs::FS &littleFs() {
+    static fs::FS instance;
+    return instance;
+}
+
+}
+
+#define LittleFS (native::littleFs())
+
+#endif // NATIVE_LITTLEFS_H
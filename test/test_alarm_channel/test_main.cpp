@@ -0,0 +1,154 @@
+// 报警判定与报警事件队列：阈值附近抖动时的事件数量、断网期间触发/解除的合并
+// 主机上运行：pio test -e native -f test_alarm_channel
+
+#include <unity.h>
+#include <Arduino.h>
+#include <string>
+#include <vector>
+#include "AlarmChannel.h"
+#include "AlarmLatch.h"
+
+#define THRESHOLD 50
+#define HYSTERESIS 5
+#define HOLD_MS 5000
+#define SAMPLE_MS 100
+
+static const AlarmChannel::Kind KINDS[] = {
+    {"thing.event.fireAlarm.post", "flame"},
+    {"thing.event.smokeAlarm.post", "smoke"},
+};
+
+static AlarmChannel *channel;
+static AlarmLatch *latch;
+static std::vector<std::string> sent;
+
+static bool collect(uint8_t kind, const uint8_t *payload, size_t length) {
+    (void)kind;
+    sent.push_back(std::string((const char *)payload, length));
+    return true;
+}
+
+// 事件中的报警状态
+static int stateOf(const std::string &payload) {
+    size_t pos = payload.find("\"state\":");
+    TEST_ASSERT_TRUE(pos != std::string::npos);
+    return payload[pos + 8] - '0';
+}
+
+// 按main.cpp的sampleSensors()：采样一次，状态变化时生成事件
+static void sample(int32_t value) {
+    native::advance(SAMPLE_MS);
+    bool was = latch->active();
+    bool active = latch->update(value, THRESHOLD, millis());
+    if (active != was) {
+        AlarmChannel::Snapshot snapshot = {value, THRESHOLD, 25.0f};
+        channel->raise(0, active, snapshot, 0, millis());
+    }
+}
+
+void setUp(void) {
+    native::advance(1000);
+    channel = new AlarmChannel(KINDS, 2, 2000, 30000);
+    latch = new AlarmLatch(HYSTERESIS, HOLD_MS);
+    sent.clear();
+}
+
+void tearDown(void) {
+    delete latch;
+    delete channel;
+}
+
+// 超过阈值立即触发，回落后要保持HOLD_MS才解除，中途再超过下限重新计时
+void test_latch_raises_immediately_and_holds_clear(void) {
+    TEST_ASSERT_FALSE(latch->update(THRESHOLD, THRESHOLD, millis()));
+    TEST_ASSERT_TRUE(latch->update(THRESHOLD + 1, THRESHOLD, millis()));
+
+    // 在回差范围内不开始计时
+    native::advance(HOLD_MS * 2);
+    TEST_ASSERT_TRUE(latch->update(THRESHOLD - HYSTERESIS + 1, THRESHOLD, millis()));
+
+    TEST_ASSERT_TRUE(latch->update(THRESHOLD - HYSTERESIS, THRESHOLD, millis()));
+    native::advance(HOLD_MS - 1);
+    TEST_ASSERT_TRUE(latch->update(0, THRESHOLD, millis()));
+    TEST_ASSERT_TRUE(latch->update(THRESHOLD - 1, THRESHOLD, millis()));   // 回到回差范围，重新计时
+    TEST_ASSERT_TRUE(latch->update(0, THRESHOLD, millis()));
+    native::advance(HOLD_MS - 1);
+    TEST_ASSERT_TRUE(latch->update(0, THRESHOLD, millis()));
+    native::advance(1);
+    TEST_ASSERT_FALSE(latch->update(0, THRESHOLD, millis()));
+}
+
+// 读数每次采样都在阈值两侧跳动一分钟：在线时只有一次触发，没有解除
+void test_flapping_reading_raises_once(void) {
+    for (int i = 0; i < 600; i++) {
+        sample(i % 2 ? THRESHOLD + 1 : THRESHOLD - 1);
+        channel->service(true, millis(), collect);
+    }
+    // 没有应答，只有同一条触发的重发
+    TEST_ASSERT_EQUAL(1, channel->stats().raised);
+    TEST_ASSERT_EQUAL(sent.size() - 1, channel->stats().retransmits);
+    for (size_t i = 0; i < sent.size(); i++) TEST_ASSERT_EQUAL(1, stateOf(sent[i]));
+}
+
+// 断网期间反复越过阈值且每次都满足解除条件：队列不会满，恢复后平台按顺序收到最终状态
+void test_offline_flapping_coalesces(void) {
+    for (int cycle = 0; cycle < 20; cycle++) {
+        sample(THRESHOLD + 10);
+        for (uint32_t t = 0; t <= HOLD_MS; t += SAMPLE_MS) sample(0);
+    }
+    TEST_ASSERT_FALSE(latch->active());
+    TEST_ASSERT_EQUAL(2, channel->pending());
+    TEST_ASSERT_EQUAL(0, channel->stats().dropped);
+    TEST_ASSERT_EQUAL(19, channel->stats().coalesced);
+
+    channel->service(true, millis(), collect);
+    TEST_ASSERT_EQUAL(2, sent.size());
+    TEST_ASSERT_EQUAL(1, stateOf(sent[0]));
+    TEST_ASSERT_EQUAL(0, stateOf(sent[1]));
+
+    // 保留的是最早那条触发（检测时延从第一次越过阈值算起）和最后一条解除
+    TEST_ASSERT_TRUE(channel->acknowledge(1, 200, millis()));
+    TEST_ASSERT_TRUE(channel->acknowledge(channel->stats().raised, 200, millis()));
+    TEST_ASSERT_EQUAL(0, channel->pending());
+}
+
+// 已经发出过的解除可能已被平台收到，断线重连后也不合并
+void test_sent_clear_is_not_coalesced(void) {
+    AlarmChannel::Snapshot snapshot = {60, THRESHOLD, 25.0f};
+    channel->raise(0, true, snapshot, 0, millis());
+    channel->raise(0, false, snapshot, 0, millis());
+    channel->service(true, millis(), collect);
+    TEST_ASSERT_EQUAL(2, sent.size());
+
+    channel->requeue();
+    channel->raise(0, true, snapshot, 0, millis());
+    TEST_ASSERT_EQUAL(0, channel->stats().coalesced);
+    TEST_ASSERT_EQUAL(3, channel->pending());
+
+    sent.clear();
+    channel->service(true, millis(), collect);
+    TEST_ASSERT_EQUAL(3, sent.size());
+    TEST_ASSERT_EQUAL(1, stateOf(sent[0]));
+    TEST_ASSERT_EQUAL(0, stateOf(sent[1]));
+    TEST_ASSERT_EQUAL(1, stateOf(sent[2]));
+}
+
+// 合并只针对同一种报警
+void test_coalesce_is_per_kind(void) {
+    AlarmChannel::Snapshot snapshot = {60, THRESHOLD, 25.0f};
+    channel->raise(0, true, snapshot, 0, millis());
+    channel->raise(0, false, snapshot, 0, millis());
+    channel->raise(1, true, snapshot, 0, millis());
+    TEST_ASSERT_EQUAL(3, channel->pending());
+    TEST_ASSERT_EQUAL(0, channel->stats().coalesced);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_latch_raises_immediately_and_holds_clear);
+    RUN_TEST(test_flapping_reading_raises_once);
+    RUN_TEST(test_offline_flapping_coalesces);
+    RUN_TEST(test_sent_clear_is_not_coalesced);
+    RUN_TEST(test_coalesce_is_per_kind);
+    return UNITY_END();
+}
@@ -0,0 +1,353 @@
+// 下行property/set解析：语料、变异模糊测试和主机上的耗时基准
+// 主机上运行：pio test -e native -f test_inbound_parser
+// 语料在corpus/下，文件名前缀表示预期结果：
+//   apply_   解析成功，没有类型错误，至少设置了一个属性
+//   ignore_  没有设置任何属性（解析失败也可以）
+//   reject_  解析失败，或有类型错误的属性
+//   any_     只检查通用约束（不崩溃、不越界、设置的值在范围内）
+
+#include <unity.h>
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <dirent.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "StaticJsonPool.h"
+#include "PropertyRegistry.h"
+
+// 与main.cpp中的INBOUND_JSON_POOL相同；ArduinoJson的节点里有指针，64位主机上按指针宽度放大
+#define INBOUND_JSON_POOL (4096 * sizeof(void *) / 4)
+#define FUZZ_ROUNDS 2000                // 每条语料的变异次数
+#define BENCH_ROUNDS 20000
+
+static void ignoreValue(PropertyValue) {}
+
+// 与main.cpp中的SETTABLE_PROPERTIES相同的属性，设置函数换成空函数，通过onApplied记录
+static const SettableProperty SETTABLE[] = {
+    TSL_SETTABLE(startCheckIn,         ignoreValue, SETTABLE_COMMAND),
+    TSL_SETTABLE(resetCheckIn,         ignoreValue, SETTABLE_COMMAND),
+    TSL_SETTABLE(lightState,           ignoreValue, 0),
+    TSL_SETTABLE(fanState,             ignoreValue, 0),
+    TSL_SETTABLE(pumpState,            ignoreValue, 0),
+    TSL_SETTABLE(temperatureThreshold, ignoreValue, SETTABLE_RETAINED),
+    TSL_SETTABLE(humidityThreshold,    ignoreValue, SETTABLE_RETAINED),
+    TSL_SETTABLE(lightThreshold,       ignoreValue, SETTABLE_RETAINED),
+    TSL_SETTABLE(decibelThreshold,     ignoreValue, SETTABLE_RETAINED),
+    TSL_SETTABLE(flameThreshold,       ignoreValue, SETTABLE_RETAINED),
+    TSL_SETTABLE(smokeThreshold,       ignoreValue, SETTABLE_RETAINED),
+};
+static PropertyRegistry registry(SETTABLE, sizeof(SETTABLE) / sizeof(SETTABLE[0]));
+
+alignas(void *) static uint8_t poolBuf[INBOUND_JSON_POOL];
+static StaticJsonPool pool(poolBuf, sizeof(poolBuf));
+static JsonDocument doc(&pool);
+static JsonDocument filter;
+
+struct Applied {
+    size_t index;
+    PropertyValue value;
+};
+static std::vector<Applied> applied;
+
+static void recordApplied(size_t index, PropertyValue value) {
+    Applied entry = {index, value};
+    applied.push_back(entry);
+}
+
+struct Outcome {
+    DeserializationError error;
+    PropertyRegistry::Summary summary;
+};
+
+// 与main.cpp中buildInboundFilter()相同
+static void buildFilter() {
+    filter["id"] = true;
+    filter["code"] = true;
+    filter["message"] = true;
+    for (size_t i = 0; i < registry.count(); i++) {
+        const char *name = registry.at(i).name;
+        filter["params"][name] = true;
+        filter["data"][name]["value"] = true;
+        filter["data"][name]["version"] = true;
+    }
+}
+
+// 与mqttCallback()中property/set的处理相同
+static Outcome handle(const uint8_t *payload, size_t length) {
+    Outcome out = {DeserializationError::Ok, {0, 0, 0, 0}};
+    applied.clear();
+    doc.clear();
+    pool.reset();
+    out.error = deserializeJson(doc, (const char *)payload, length, DeserializationOption::Filter(filter));
+    if (!out.error) {
+        out.summary = registry.applyAll(doc["params"].as<JsonObjectConst>());
+    }
+    return out;
+}
+
+// 放进大小正好的堆缓冲再解析，越界读能被AddressSanitizer发现；报文不以'\0'结尾
+static Outcome handle(const std::vector<uint8_t> &payload) {
+    uint8_t *exact = new uint8_t[payload.size() + 1];
+    if (!payload.empty()) memcpy(exact, payload.data(), payload.size());
+    Outcome out = handle(exact, payload.size());
+    delete[] exact;
+    return out;
+}
+
+// 任何输入都必须满足的约束
+static void checkInvariants(const Outcome &out, const char *name) {
+    TEST_ASSERT_TRUE_MESSAGE(pool.peak() <= pool.capacity(), name);
+    TEST_ASSERT_TRUE_MESSAGE(applied.size() == out.summary.applied, name);
+    for (size_t i = 0; i < applied.size(); i++) {
+        const SettableProperty &prop = registry.at(applied[i].index);
+        PropertyValue v = applied[i].value;
+        if (prop.type == PROP_FLOAT) {
+            TEST_ASSERT_TRUE_MESSAGE(!isnan(v.f) && v.f >= prop.minValue && v.f <= prop.maxValue, name);
+        } else if (prop.type == PROP_INT) {
+            TEST_ASSERT_TRUE_MESSAGE(v.i >= (int32_t)prop.minValue && v.i <= (int32_t)prop.maxValue, name);
+        }
+    }
+}
+
+static std::string corpusDir() {
+    std::string file = __FILE__;
+    size_t slash = file.rfind('/');
+    return (slash == std::string::npos ? std::string(".") : file.substr(0, slash)) + "/corpus";
+}
+
+static std::vector<uint8_t> readFile(const std::string &path) {
+    std::vector<uint8_t> data;
+    FILE *f = fopen(path.c_str(), "rb");
+    if (f == nullptr) return data;
+    uint8_t buf[512];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) data.insert(data.end(), buf, buf + n);
+    fclose(f);
+    return data;
+}
+
+struct CorpusEntry {
+    std::string name;
+    std::vector<uint8_t> data;
+};
+
+static std::vector<CorpusEntry> loadCorpus() {
+    std::vector<CorpusEntry> corpus;
+    std::string dir = corpusDir();
+    DIR *d = opendir(dir.c_str());
+    if (d == nullptr) return corpus;
+    struct dirent *entry;
+    while ((entry = readdir(d)) != nullptr) {
+        std::string name = entry->d_name;
+        if (name.size() < 5 || name.compare(name.size() - 5, 5, ".json") != 0) continue;
+        CorpusEntry item = {name, readFile(dir + "/" + name)};
+        corpus.push_back(item);
+    }
+    closedir(d);
+    return corpus;
+}
+
+static bool startsWith(const std::string &s, const char *prefix) {
+    return s.compare(0, strlen(prefix), prefix) == 0;
+}
+
+static std::vector<uint8_t> bytes(const char *text) {
+    return std::vector<uint8_t>(text, text + strlen(text));
+}
+
+// 取某个属性设置的值，没有设置时测试失败
+static PropertyValue appliedValue(const char *name) {
+    for (size_t i = 0; i < applied.size(); i++) {
+        if (strcmp(registry.at(applied[i].index).name, name) == 0) return applied[i].value;
+    }
+    TEST_FAIL_MESSAGE(name);
+    PropertyValue none;
+    none.i = 0;
+    return none;
+}
+
+void setUp(void) {
+    native::seed(2024);
+}
+
+void tearDown(void) {
+}
+
+// 过滤器只留下已知字段，params中只有可设置属性
+void test_filter_drops_unknown_fields(void) {
+    Outcome out = handle(bytes("{\"id\":\"7\",\"version\":\"1.0\",\"sys\":{\"ack\":0},"
+                               "\"params\":{\"smokeThreshold\":30,\"temperature\":20,\"absentUsers\":\"x\"},"
+                               "\"method\":\"thing.service.property.set\"}"));
+    TEST_ASSERT_FALSE(out.error);
+    TEST_ASSERT_TRUE(doc["sys"].isNull());
+    TEST_ASSERT_TRUE(doc["version"].isNull());
+    TEST_ASSERT_TRUE(doc["method"].isNull());
+    TEST_ASSERT_EQUAL_STRING("7", doc["id"].as<const char *>());
+    TEST_ASSERT_EQUAL(1, doc["params"].as<JsonObjectConst>().size());
+    TEST_ASSERT_EQUAL(1, out.summary.applied);
+    TEST_ASSERT_EQUAL(0, out.summary.unknown);
+}
+
+// 设置函数收到的值与报文一致
+void test_values_reach_setters(void) {
+    Outcome out = handle(bytes("{\"id\":\"2\",\"params\":{\"fanState\":1,\"lightState\":false,"
+                               "\"temperatureThreshold\":28.5,\"flameThreshold\":40}}"));
+    TEST_ASSERT_FALSE(out.error);
+    TEST_ASSERT_EQUAL(4, out.summary.applied);
+    TEST_ASSERT_EQUAL(0, out.summary.clamped);
+    TEST_ASSERT_TRUE(appliedValue("fanState").b);
+    TEST_ASSERT_FALSE(appliedValue("lightState").b);
+    TEST_ASSERT_EQUAL_FLOAT(28.5f, appliedValue("temperatureThreshold").f);
+    TEST_ASSERT_EQUAL(40, appliedValue("flameThreshold").i);
+}
+
+// 超出范围的值限制到边界
+void test_out_of_range_values_are_clamped(void) {
+    Outcome out = handle(bytes("{\"params\":{\"temperatureThreshold\":1000,\"flameThreshold\":-5,\"lightState\":7}}"));
+    TEST_ASSERT_FALSE(out.error);
+    TEST_ASSERT_EQUAL(3, out.summary.applied);
+    TEST_ASSERT_EQUAL(3, out.summary.clamped);
+    TEST_ASSERT_EQUAL_FLOAT(125.0f, appliedValue("temperatureThreshold").f);
+    TEST_ASSERT_EQUAL(0, appliedValue("flameThreshold").i);
+    TEST_ASSERT_TRUE(appliedValue("lightState").b);
+}
+
+// 取某个属性是否被设置过
+static bool wasApplied(const char *name) {
+    for (size_t i = 0; i < applied.size(); i++) {
+        if (strcmp(registry.at(applied[i].index).name, name) == 0) return true;
+    }
+    return false;
+}
+
+// 超出int32的整数和过深的嵌套：不论ArduinoJson把它们存成int64、浮点数还是直接报错，都不能设置属性
+void test_unrepresentable_values_are_not_applied(void) {
+    Outcome out = handle(bytes("{\"params\":{\"smokeThreshold\":99999999999,\"fanState\":1}}"));
+    TEST_ASSERT_FALSE(wasApplied("smokeThreshold"));
+    TEST_ASSERT_TRUE(out.error || out.summary.invalid == 1);
+
+    std::string deep = "{\"params\":{\"lightState\":";
+    for (int i = 0; i < 64; i++) deep += '[';
+    for (int i = 0; i < 64; i++) deep += ']';
+    deep += "}}";
+    out = handle(bytes(deep.c_str()));
+    TEST_ASSERT_FALSE(wasApplied("lightState"));
+    TEST_ASSERT_TRUE(out.error || out.summary.invalid == 1);
+
+    // 下溢的指数可能解析成0，也可能报错；只要设置了就必须在范围内（checkInvariants）
+    out = handle(bytes("{\"params\":{\"humidityThreshold\":1e-400}}"));
+    checkInvariants(out, "1e-400");
+    TEST_ASSERT_EQUAL(0, out.summary.invalid);
+}
+
+// 语料逐条检查预期结果
+void test_corpus(void) {
+    std::vector<CorpusEntry> corpus = loadCorpus();
+    TEST_ASSERT_TRUE_MESSAGE(corpus.size() >= 30, corpusDir().c_str());
+    for (size_t i = 0; i < corpus.size(); i++) {
+        const char *name = corpus[i].name.c_str();
+        Outcome out = handle(corpus[i].data);
+        checkInvariants(out, name);
+        if (startsWith(corpus[i].name, "apply_")) {
+            TEST_ASSERT_FALSE_MESSAGE(out.error, name);
+            TEST_ASSERT_TRUE_MESSAGE(out.summary.invalid == 0 && out.summary.applied > 0, name);
+        } else if (startsWith(corpus[i].name, "ignore_")) {
+            TEST_ASSERT_TRUE_MESSAGE(out.summary.applied == 0, name);
+        } else if (startsWith(corpus[i].name, "reject_")) {
+            TEST_ASSERT_TRUE_MESSAGE(out.error || out.summary.invalid > 0, name);
+        }
+    }
+}
+
+// 对每条语料随机改字节、删除、复制片段或截断，解析结果不做要求，只检查通用约束
+void test_fuzz_mutations(void) {
+    static const char TOKENS[] = "{}[]\":,.-+eE0123456789tfnu\\ ";
+    std::vector<CorpusEntry> corpus = loadCorpus();
+    TEST_ASSERT_TRUE(corpus.size() > 0);
+    uint32_t runs = 0, parsed = 0;
+    for (size_t c = 0; c < corpus.size(); c++) {
+        const std::vector<uint8_t> &seedData = corpus[c].data;
+        if (seedData.empty()) continue;
+        for (int round = 0; round < FUZZ_ROUNDS; round++) {
+            std::vector<uint8_t> data = seedData;
+            int edits = 1 + random(4);
+            for (int e = 0; e < edits && !data.empty(); e++) {
+                size_t pos = random(data.size());
+                switch (random(5)) {
+                case 0:
+                    data[pos] = TOKENS[random(sizeof(TOKENS) - 1)];
+                    break;
+                case 1:
+                    data[pos] = (uint8_t)random(256);
+                    break;
+                case 2: {
+                    size_t len = 1 + random(16);
+                    if (pos + len > data.size()) len = data.size() - pos;
+                    data.erase(data.begin() + pos, data.begin() + pos + len);
+                    break;
+                }
+                case 3: {
+                    size_t len = 1 + random(32);
+                    if (pos + len > data.size()) len = data.size() - pos;
+                    std::vector<uint8_t> piece(data.begin() + pos, data.begin() + pos + len);
+                    data.insert(data.begin() + random(data.size() + 1), piece.begin(), piece.end());
+                    break;
+                }
+                default:
+                    data.resize(pos);
+                    break;
+                }
+            }
+            Outcome out = handle(data);
+            checkInvariants(out, corpus[c].name.c_str());
+            runs++;
+            if (!out.error) parsed++;
+        }
+    }
+    char message[96];
+    snprintf(message, sizeof(message), "fuzz: %u inputs, %u parsed", (unsigned)runs, (unsigned)parsed);
+    TEST_MESSAGE(message);
+}
+
+// 主机上的耗时基准，只作对比用（数值与ESP32不同），同时报告内存池峰值
+static void bench(const char *label, const char *payload) {
+    std::vector<uint8_t> data = bytes(payload);
+    size_t peak = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < BENCH_ROUNDS; i++) {
+        Outcome out = handle(data.data(), data.size());
+        TEST_ASSERT_FALSE(out.error);
+        if (pool.peak() > peak) peak = pool.peak();
+    }
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    char message[128];
+    snprintf(message, sizeof(message), "%s: %u bytes, %.2f us/msg, pool peak %u/%u",
+             label, (unsigned)data.size(), us / BENCH_ROUNDS, (unsigned)peak, (unsigned)pool.capacity());
+    TEST_MESSAGE(message);
+}
+
+void test_benchmark(void) {
+    bench("single", "{\"method\":\"thing.service.property.set\",\"id\":\"1234567\","
+                    "\"params\":{\"fanState\":1},\"version\":\"1.0.0\"}");
+    bench("all", "{\"method\":\"thing.service.property.set\",\"id\":\"1234568\",\"params\":{"
+                 "\"lightState\":1,\"fanState\":0,\"pumpState\":1,\"temperatureThreshold\":28.5,"
+                 "\"humidityThreshold\":65,\"lightThreshold\":300,\"flameThreshold\":40,"
+                 "\"smokeThreshold\":55,\"decibelThreshold\":70},\"version\":\"1.0.0\"}");
+}
+
+int main(int argc, char **argv) {
+    registry.onApplied(recordApplied);
+    if (!registry.begin()) return 1;
+    buildFilter();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_filter_drops_unknown_fields);
+    RUN_TEST(test_values_reach_setters);
+    RUN_TEST(test_out_of_range_values_are_clamped);
+    RUN_TEST(test_unrepresentable_values_are_not_applied);
+    RUN_TEST(test_corpus);
+    RUN_TEST(test_fuzz_mutations);
+    RUN_TEST(test_benchmark);
+    return UNITY_END();
+}
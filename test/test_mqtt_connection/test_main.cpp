@@ -0,0 +1,273 @@
+// MQTT连接状态机：指数退避、随机抖动，以及服务器反复闪断时的重连频率
+// 主机上运行：pio test -e native -f test_mqtt_connection
+
+#include <unity.h>
+#include <Arduino.h>
+#include "MqttConnection.h"
+
+#define MIN_BACKOFF 2000
+#define MAX_BACKOFF 120000
+#define CONNECT_TIMEOUT 15000
+#define STABLE_MS 30000
+#define STEP_MS 10
+
+// 模拟的服务器：可以拒绝连接、异步应答，或接受后在若干毫秒内断开（闪断）
+class FakeBroker : public MqttTransport {
+public:
+    bool accepting;
+    bool async;                 // connect()返回PENDING，asyncDelayMs后才有结果
+    uint32_t asyncDelayMs;
+    uint32_t dropAfterMs;       // 连上后多久断开，0表示不断开
+    uint32_t connects;          // connect()调用次数
+    uint32_t sessions;          // 成功建立的连接数
+    bool lingering;             // 像PubSubTransport的连接任务：disconnect()不能打断进行中的连接
+    bool up;
+    bool pending;
+    bool aborted;
+    uint32_t delayMs;           // 本次异步连接的延迟（connect()时取asyncDelayMs）
+    unsigned long since;
+
+    FakeBroker()
+        : accepting(false), async(false), asyncDelayMs(0), dropAfterMs(0),
+          connects(0), sessions(0), lingering(false), up(false), pending(false), aborted(false), delayMs(0), since(0) {}
+
+    // 异步连接到时给出结果；已被放弃的连接结束后保持断开
+    void progress() {
+        if (pending && millis() - since >= delayMs) {
+            pending = false;
+            if (accepting && !aborted) {
+                up = true;
+                sessions++;
+                since = millis();
+            }
+        }
+    }
+
+    void begin(const char *, uint16_t, MessageCallback) override {}
+    void setServer(const char *, const IPAddress &, uint16_t) override {}
+
+    ConnectResult connect(const char *, const char *, const char *) override {
+        TEST_ASSERT_FALSE(pending);
+        connects++;
+        since = millis();
+        if (async) {
+            pending = true;
+            aborted = false;
+            delayMs = asyncDelayMs;
+            return TRANSPORT_CONNECT_PENDING;
+        }
+        if (!accepting) return TRANSPORT_CONNECT_FAILED;
+        up = true;
+        sessions++;
+        return TRANSPORT_CONNECT_OK;
+    }
+
+    bool connected() override {
+        progress();
+        if (up && dropAfterMs > 0 && millis() - since >= dropAfterMs) up = false;
+        return up;
+    }
+    bool connecting() override {
+        progress();
+        return pending;
+    }
+    void disconnect() override {
+        up = false;
+        if (lingering) {
+            aborted = true;
+        } else {
+            pending = false;
+        }
+    }
+    void loop() override {}
+    bool publish(const char *, const uint8_t *, size_t, uint8_t) override { return up; }
+    using MqttTransport::publish;
+    bool subscribe(const char *, uint8_t) override { return up; }
+    int state() override { return up ? 0 : -2; }
+};
+
+static FakeBroker *broker;
+static MqttConnection *connection;
+
+static void run(unsigned long ms, bool networkUp = true) {
+    for (unsigned long t = 0; t < ms; t += STEP_MS) {
+        native::advance(STEP_MS);
+        connection->loop(networkUp);
+    }
+}
+
+// 运行到下一次connect()调用，返回等待的时间
+static unsigned long untilNextAttempt() {
+    uint32_t before = broker->connects;
+    unsigned long start = millis();
+    while (broker->connects == before && millis() - start < 10UL * MAX_BACKOFF) {
+        native::advance(STEP_MS);
+        connection->loop(true);
+    }
+    TEST_ASSERT_TRUE(broker->connects > before);
+    return millis() - start;
+}
+
+void setUp(void) {
+    native::seed(42);
+    native::advance(1000);
+    broker = new FakeBroker();
+    connection = new MqttConnection(*broker, MIN_BACKOFF, MAX_BACKOFF, CONNECT_TIMEOUT, STABLE_MS);
+}
+
+void tearDown(void) {
+    delete connection;
+    delete broker;
+}
+
+// 网络可用后立即尝试，不等退避
+void test_connects_immediately_when_network_comes_up(void) {
+    broker->accepting = true;
+    run(STEP_MS, false);
+    TEST_ASSERT_EQUAL(0, broker->connects);
+    run(STEP_MS);
+    TEST_ASSERT_EQUAL(1, broker->connects);
+    TEST_ASSERT_TRUE(connection->connected());
+}
+
+// 服务器不可达：等待时间每次翻倍，落在[b/2, b]内，最后停在上限
+void test_backoff_doubles_with_jitter_and_caps(void) {
+    run(STEP_MS);
+    uint32_t expected = MIN_BACKOFF;
+    for (int i = 0; i < 10; i++) {
+        uint32_t backoff = connection->backoffMs();
+        TEST_ASSERT_TRUE(backoff >= expected / 2);
+        TEST_ASSERT_TRUE(backoff <= expected);
+        unsigned long waited = untilNextAttempt();
+        TEST_ASSERT_TRUE(waited >= backoff);
+        TEST_ASSERT_TRUE(waited <= backoff + STEP_MS);
+        expected = expected * 2 > MAX_BACKOFF ? MAX_BACKOFF : expected * 2;
+    }
+    TEST_ASSERT_EQUAL(MqttConnection::CONN_BACKOFF, connection->state());
+    TEST_ASSERT_EQUAL(11, connection->failures());
+}
+
+// 抖动使多台设备的重连时间分散开
+void test_jitter_spreads_retries(void) {
+    uint32_t lo = MAX_BACKOFF, hi = 0;
+    for (int i = 0; i < 50; i++) {
+        FakeBroker down;
+        MqttConnection device(down, MIN_BACKOFF, MAX_BACKOFF, CONNECT_TIMEOUT, STABLE_MS);
+        device.loop(true);
+        if (device.backoffMs() < lo) lo = device.backoffMs();
+        if (device.backoffMs() > hi) hi = device.backoffMs();
+    }
+    TEST_ASSERT_TRUE(hi - lo >= MIN_BACKOFF / 4);
+}
+
+// 服务器接受连接后很快断开：退避照样增长，重连频率受控
+void test_flapping_broker_backs_off(void) {
+    broker->accepting = true;
+    broker->dropAfterMs = 500;
+    run(30UL * 60 * 1000);
+
+    // 一直用最短退避时30分钟会重连近千次；指数退避后大部分时间等在上限
+    TEST_ASSERT_TRUE(broker->sessions > 5);
+    TEST_ASSERT_TRUE(broker->connects < 40);
+    TEST_ASSERT_TRUE(connection->backoffMs() >= MAX_BACKOFF / 2);
+}
+
+// 连接保持stableMs后失败次数清零，下次断开从最短退避开始
+void test_stable_session_resets_backoff(void) {
+    run(STEP_MS);
+    for (int i = 0; i < 5; i++) untilNextAttempt();
+    TEST_ASSERT_TRUE(connection->failures() >= 5);
+
+    broker->accepting = true;
+    untilNextAttempt();
+    TEST_ASSERT_TRUE(connection->connected());
+    run(STABLE_MS - 100);
+    TEST_ASSERT_TRUE(connection->failures() > 0);
+    run(200);
+    TEST_ASSERT_EQUAL(0, connection->failures());
+
+    broker->up = false;
+    run(STEP_MS);
+    TEST_ASSERT_EQUAL(MqttConnection::CONN_BACKOFF, connection->state());
+    TEST_ASSERT_TRUE(connection->backoffMs() <= MIN_BACKOFF);
+}
+
+// 断网时停止重试，恢复后立即连接
+void test_network_loss_pauses_retries(void) {
+    run(STEP_MS);
+    uint32_t attempts = broker->connects;
+    run(10UL * 60 * 1000, false);
+    TEST_ASSERT_EQUAL(attempts, broker->connects);
+    TEST_ASSERT_EQUAL(MqttConnection::CONN_WAIT_NETWORK, connection->state());
+
+    broker->accepting = true;
+    run(STEP_MS);
+    TEST_ASSERT_TRUE(connection->connected());
+}
+
+// 异步后端超时没有结果按失败处理
+void test_async_connect_times_out(void) {
+    broker->async = true;
+    broker->asyncDelayMs = 60000;
+    broker->accepting = true;
+    run(STEP_MS);
+    TEST_ASSERT_EQUAL(MqttConnection::CONN_CONNECTING, connection->state());
+    run(CONNECT_TIMEOUT);
+    TEST_ASSERT_EQUAL(MqttConnection::CONN_BACKOFF, connection->state());
+    TEST_ASSERT_EQUAL(1, connection->failures());
+
+    broker->asyncDelayMs = 300;
+    untilNextAttempt();
+    run(400);
+    TEST_ASSERT_TRUE(connection->connected());
+}
+
+// 超时放弃的连接在后端还没结束时，不发起下一次连接
+void test_waits_for_abandoned_connect(void) {
+    broker->async = true;
+    broker->lingering = true;
+    broker->asyncDelayMs = CONNECT_TIMEOUT + 8000;
+    broker->accepting = true;
+    run(STEP_MS);
+    unsigned long start = millis();
+    run(CONNECT_TIMEOUT);
+    TEST_ASSERT_EQUAL(MqttConnection::CONN_BACKOFF, connection->state());
+
+    // 退避时间早已过去，但上一次连接还占着后端
+    run(5000);
+    TEST_ASSERT_EQUAL(1, broker->connects);
+    TEST_ASSERT_EQUAL(0, broker->sessions);
+
+    // 后端结束后立即重试，放弃的那次连接不会被当成成功
+    broker->asyncDelayMs = 300;
+    untilNextAttempt();
+    TEST_ASSERT_TRUE(millis() - start >= CONNECT_TIMEOUT + 8000);
+    run(400);
+    TEST_ASSERT_TRUE(connection->connected());
+    TEST_ASSERT_EQUAL(1, broker->sessions);
+}
+
+// retryNow()跳过剩余的退避时间
+void test_retry_now_skips_backoff(void) {
+    run(STEP_MS);
+    for (int i = 0; i < 6; i++) untilNextAttempt();
+    TEST_ASSERT_TRUE(connection->backoffMs() > 10000);
+    uint32_t attempts = broker->connects;
+    connection->retryNow();
+    run(STEP_MS);
+    TEST_ASSERT_EQUAL(attempts + 1, broker->connects);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_connects_immediately_when_network_comes_up);
+    RUN_TEST(test_backoff_doubles_with_jitter_and_caps);
+    RUN_TEST(test_jitter_spreads_retries);
+    RUN_TEST(test_flapping_broker_backs_off);
+    RUN_TEST(test_stable_session_resets_backoff);
+    RUN_TEST(test_network_loss_pauses_retries);
+    RUN_TEST(test_async_connect_times_out);
+    RUN_TEST(test_waits_for_abandoned_connect);
+    RUN_TEST(test_retry_now_skips_backoff);
+    return UNITY_END();
+}
@@ -0,0 +1,177 @@
+// 样本批次：时间同步前采集的样本经暂存队列补发时换算成UTC时间
+// 主机上运行：pio test -e native -f test_sample_batch
+
+#include <unity.h>
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <map>
+#include <string>
+#include "SampleBatch.h"
+#include "Outbox.h"
+
+#define UNTIMED_TOPIC "local/untimed_samples"
+#define SAMPLE_INTERVAL 4000                // 断网期间每4秒一条样本
+#define SMOKE_MASK ((PropertyMask)1 << 4)    // 用smoke的值给样本编号
+#define BOOT_ID 0x1234u
+#define SYNC_EPOCH 1700000000000ULL         // 恢复联网后SNTP给出的时间
+
+static SampleBatch *batch;
+static SampleBatch *replay;
+static Outbox *outbox;
+static uint64_t uptimeMs;                   // 设备开机以来的毫秒数
+static uint64_t epochMs;                    // 0表示还没同步
+static std::map<int, uint64_t> delivered;   // 样本编号 -> 发出的时间戳
+static uint32_t dropped;
+
+// 按main.cpp的flushSampleBatch()：时间没同步时原样暂存
+static void flush() {
+    static uint8_t buf[4096];
+    size_t len = batch->save(buf, sizeof(buf), BOOT_ID);
+    TEST_ASSERT_TRUE(len <= sizeof(buf));
+    TEST_ASSERT_TRUE(outbox->push(UNTIMED_TOPIC, buf, len));
+    batch->clear();
+}
+
+// 从history.post报文中取出每条样本的编号和时间
+static void collectTimes(const char *json) {
+    const char *p = json;
+    while ((p = strstr(p, "\"smoke\":{\"value\":")) != nullptr) {
+        int index;
+        unsigned long long time;
+        TEST_ASSERT_EQUAL(2, sscanf(p, "\"smoke\":{\"value\":%d,\"time\":%llu}", &index, &time));
+        TEST_ASSERT_TRUE(delivered.find(index) == delivered.end());
+        delivered[index] = time;
+        p++;
+    }
+}
+
+// 按main.cpp的publishOutboxRecord()：同步后读回样本，换算时间写成history.post
+static bool send(const char *topic, const uint8_t *payload, size_t length) {
+    TEST_ASSERT_EQUAL_STRING(UNTIMED_TOPIC, topic);
+    if (epochMs == 0) return false;
+    if (!replay->load(payload, length, BOOT_ID)) {
+        dropped++;
+        return true;
+    }
+    static char json[8192];
+    size_t len = replay->write(json, sizeof(json), 1, "pk", "dev", (int64_t)epochMs - (int64_t)uptimeMs);
+    TEST_ASSERT_TRUE(len < sizeof(json));
+    replay->clear();
+    collectTimes(json);
+    return true;
+}
+
+// 推进设备时间（同步后UTC时间一起走）
+static void advance(uint32_t ms) {
+    native::advance(ms);
+    uptimeMs += ms;
+    if (epochMs) epochMs += ms;
+}
+
+// 断网采样hours小时，返回样本条数
+static int sampleOffline(uint32_t hours) {
+    int count = 0;
+    for (uint32_t t = 0; t < hours * 3600000UL; t += SAMPLE_INTERVAL) {
+        advance(SAMPLE_INTERVAL);
+        PropertyFrame frame = PropertyFrame();
+        frame.smoke = count++;
+        TEST_ASSERT_TRUE(batch->add(uptimeMs, frame, SMOKE_MASK, millis()));
+        if (batch->due(millis())) flush();
+        outbox->service(false, millis(), send);
+    }
+    if (batch->count() > 0) flush();
+    return count;
+}
+
+static void drainAll() {
+    for (int i = 0; i < 100000 && !outbox->empty(); i++) {
+        advance(250);
+        outbox->service(true, millis(), send);
+    }
+}
+
+void setUp(void) {
+    LittleFS.format();
+    LittleFS.setCapacity((size_t)-1);
+    native::advance(1000);
+    uptimeMs = 5000;
+    epochMs = 0;
+    delivered.clear();
+    dropped = 0;
+    batch = new SampleBatch(8, 30000);
+    replay = new SampleBatch(SampleBatch::MAX_SAMPLES, 0);
+    outbox = new Outbox(65536, 32768, 1048576, 60000, 250);
+    TEST_ASSERT_TRUE(outbox->begin());
+}
+
+void tearDown(void) {
+    delete outbox;
+    delete replay;
+    delete batch;
+}
+
+// 断网时开机，3小时后才联网并同步时间：每条样本都按采集时刻补上UTC时间
+void test_outage_from_boot_is_restamped_after_sync(void) {
+    uint64_t firstUptime = uptimeMs + SAMPLE_INTERVAL;
+    int count = sampleOffline(3);
+    TEST_ASSERT_TRUE(outbox->flashBytes() > 0);
+
+    // 联网但还没同步：一条都不发
+    for (int i = 0; i < 20; i++) {
+        advance(250);
+        outbox->service(true, millis(), send);
+    }
+    TEST_ASSERT_EQUAL(0, delivered.size());
+
+    uint64_t syncUptime = uptimeMs;
+    epochMs = SYNC_EPOCH;
+    drainAll();
+    TEST_ASSERT_TRUE(outbox->empty());
+    TEST_ASSERT_EQUAL(0, outbox->dropped());
+    TEST_ASSERT_EQUAL(0, dropped);
+    TEST_ASSERT_EQUAL(count, delivered.size());
+
+    for (int i = 0; i < count; i++) {
+        uint64_t sampledAt = firstUptime + (uint64_t)i * SAMPLE_INTERVAL;
+        uint64_t expected = SYNC_EPOCH - (syncUptime - sampledAt);
+        TEST_ASSERT_TRUE(delivered.count(i) == 1);
+        TEST_ASSERT_TRUE(delivered[i] == expected);
+    }
+}
+
+// 上次开机留下的未定时样本无法换算，补发时丢弃而不是带着错误的时间发出
+void test_untimed_samples_from_previous_boot_are_dropped(void) {
+    static uint8_t buf[4096];
+    PropertyFrame frame = PropertyFrame();
+    batch->add(uptimeMs, frame, SMOKE_MASK, millis());
+    size_t len = batch->save(buf, sizeof(buf), BOOT_ID + 1);
+    outbox->push(UNTIMED_TOPIC, buf, len);
+    batch->clear();
+
+    epochMs = SYNC_EPOCH;
+    drainAll();
+    TEST_ASSERT_TRUE(outbox->empty());
+    TEST_ASSERT_EQUAL(1, dropped);
+    TEST_ASSERT_EQUAL(0, delivered.size());
+}
+
+// 截断的记录读不回来
+void test_load_rejects_truncated_record(void) {
+    static uint8_t buf[4096];
+    PropertyFrame frame = PropertyFrame();
+    batch->add(uptimeMs, frame, SMOKE_MASK, millis());
+    batch->add(uptimeMs + 1000, frame, SMOKE_MASK, millis());
+    size_t len = batch->save(buf, sizeof(buf), BOOT_ID);
+    TEST_ASSERT_FALSE(replay->load(buf, len - 1, BOOT_ID));
+    TEST_ASSERT_FALSE(replay->load(buf, 4, BOOT_ID));
+    TEST_ASSERT_TRUE(replay->load(buf, len, BOOT_ID));
+    TEST_ASSERT_EQUAL(2, replay->count());
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_outage_from_boot_is_restamped_after_sync);
+    RUN_TEST(test_untimed_samples_from_previous_boot_are_dropped);
+    RUN_TEST(test_load_rejects_truncated_record);
+    return UNITY_END();
+}
@@ -0,0 +1,110 @@
+/**
+ * 阿里云物联网平台数据解析脚本（产品数据格式为“透传/自定义”时在控制台上传）
+ *
+ * 设备在定义了TELEMETRY_RAW_FRAME时把实时属性以二进制帧发到 thing/model/up_raw，
+ * 帧格式见 src/PropertyCodec.h（多字节整数均为大端）：
+ *   上报 [0]=0x01 [1..4]=id [5]=属性数 [6..9]=mask，之后按PROPERTIES顺序写出mask中的属性值
+ *   应答 [0]=0x02 [1..4]=id [5..6]=code
+ *
+ * PROPERTIES必须与src/ThingModel.h中THING_FRAME_FIELDS的顺序一致，
+ * 类型和小数位数与tsl/model.json一致。属性数不一致的帧直接拒绝。
+ */
+
+var FRAME_POST = 0x01;
+var FRAME_POST_REPLY = 0x02;
+var METHOD_PROPERTY_POST = 'thing.event.property.post';
+
+// [标识符, 类型, 小数位数]，类型：f=定点小数(int32) i=int32 b=bool(1字节)
+var PROPERTIES = [
+    ['temperature', 'f', 1],
+    ['humidity', 'f', 1],
+    ['light', 'f', 1],
+    ['flame', 'i', 0],
+    ['smoke', 'i', 0],
+    ['noise', 'i', 0],
+    ['lightState', 'b', 0],
+    ['fanState', 'b', 0],
+    ['pumpState', 'b', 0],
+    ['temperatureThreshold', 'f', 1],
+    ['humidityThreshold', 'f', 1],
+    ['lightThreshold', 'f', 1],
+    ['flameThreshold', 'i', 0],
+    ['smokeThreshold', 'i', 0],
+    ['decibelThreshold', 'i', 0]
+];
+
+function readU32(bytes, offset) {
+    return (((bytes[offset] & 0xFF) << 24) >>> 0) + ((bytes[offset + 1] & 0xFF) << 16) +
+        ((bytes[offset + 2] & 0xFF) << 8) + (bytes[offset + 3] & 0xFF);
+}
+
+function readI32(bytes, offset) {
+    return readU32(bytes, offset) | 0;
+}
+
+/**
+ * 设备上行二进制 -> Alink JSON
+ */
+function rawDataToProtocol(bytes) {
+    var frame = [];
+    for (var n = 0; n < bytes.length; n++) {
+        frame.push(bytes[n] & 0xFF);
+    }
+    if (frame.length < 10 || frame[0] !== FRAME_POST) {
+        throw new Error('unknown frame');
+    }
+    if (frame[5] !== PROPERTIES.length) {
+        throw new Error('property layout mismatch: ' + frame[5] + ' != ' + PROPERTIES.length);
+    }
+
+    var id = readU32(frame, 1);
+    var mask = readU32(frame, 6);
+    var params = {};
+    var offset = 10;
+
+    for (var i = 0; i < PROPERTIES.length; i++) {
+        if ((mask & (1 << i)) === 0) continue;
+        var prop = PROPERTIES[i];
+        if (prop[1] === 'b') {
+            if (offset + 1 > frame.length) throw new Error('truncated frame');
+            params[prop[0]] = frame[offset] ? 1 : 0;
+            offset += 1;
+        } else {
+            if (offset + 4 > frame.length) throw new Error('truncated frame');
+            var value = readI32(frame, offset);
+            params[prop[0]] = prop[1] === 'f' ? value / Math.pow(10, prop[2]) : value;
+            offset += 4;
+        }
+    }
+
+    return {
+        id: String(id),
+        version: '1.0',
+        method: METHOD_PROPERTY_POST,
+        params: params
+    };
+}
+
+/**
+ * 平台下行Alink JSON -> 设备二进制
+ * 只转换属性上报的应答，其余下行消息（属性设置等）设备仍通过Alink JSON主题收发。
+ */
+function protocolToRawData(json) {
+    if (json.method !== METHOD_PROPERTY_POST) {
+        return [];
+    }
+    var id = parseInt(json.id, 10) >>> 0;
+    var code = json.code & 0xFFFF;
+    return [
+        FRAME_POST_REPLY,
+        (id >>> 24) & 0xFF, (id >>> 16) & 0xFF, (id >>> 8) & 0xFF, id & 0xFF,
+        (code >> 8) & 0xFF, code & 0xFF
+    ];
+}
+
+/**
+ * 自定义主题消息，不做转换
+ */
+function transformPayload(topic, rawData) {
+    return rawData;
+}